@@ -0,0 +1,304 @@
+/**
+ * Microbenchmarks of per-entry hot path components of elfindo. Reports time and number of heap
+ * allocations per operation, so that regressions get caught before they show up in real scans.
+ *
+ * The elfindo source gets included directly, so that internal functions and classes can be called
+ * without changing the way that elfindo itself gets built.
+ */
+
+#include <new>
+
+#define main elfindoMain
+#include "Main.cpp"
+#undef main
+
+#define MICROBENCH_NAME				EXE_NAME "-microbench"
+
+#define MICROBENCH_MIN_TIME_MS		200 // min measured time per benchmark
+#define MICROBENCH_START_ITERS		1000 // iterations of first calibration round
+#define MICROBENCH_NAME_PATTERNS	200 // number of patterns for "many patterns" name filter
+
+std::atomic_uint64_t numHeapAllocs {0}; // number of calls to operator new
+
+void* operator new(size_t size)
+{
+	numHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+
+	void* ptr = malloc(size ? size : 1);
+	if(!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+// (noinline to keep gcc from warning about free() of memory from inlined operator new)
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t size) noexcept
+{
+	free(ptr);
+}
+
+/**
+ * Prevent the compiler from optimizing away a computed value.
+ */
+template <typename T>
+void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * A single benchmark.
+ */
+struct MicroBench
+{
+	std::string name;
+	std::function<void()> setupFunc; // prepares config; not included in measurement
+	std::function<void(uint64_t numIterations)> benchFunc; // runs the operation numIterations times
+};
+
+/**
+ * Result of a single benchmark.
+ */
+struct MicroBenchResult
+{
+	uint64_t numIterations;
+	double nanoSecsPerOp;
+	double allocsPerOp;
+};
+
+/**
+ * Reset all config values that the benchmarks modify to their defaults.
+ */
+void resetConfig()
+{
+	config.printJSON = false;
+	config.statAll = false;
+	config.nameFilterVec.clear();
+	config.filterSizeAndTime = {};
+}
+
+/**
+ * Run the given benchmark with increasing number of iterations until it takes at least
+ * MICROBENCH_MIN_TIME_MS.
+ */
+MicroBenchResult runMicroBench(const MicroBench& bench)
+{
+	MicroBenchResult result;
+
+	for(uint64_t numIterations = MICROBENCH_START_ITERS; ; numIterations *= 2)
+	{
+		resetConfig();
+
+		if(bench.setupFunc)
+			bench.setupFunc();
+
+		uint64_t numAllocsStart = numHeapAllocs.load();
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+		bench.benchFunc(numIterations);
+
+		std::chrono::nanoseconds elapsedNanoSec = std::chrono::steady_clock::now() - startTime;
+		uint64_t numAllocs = numHeapAllocs.load() - numAllocsStart;
+
+		result.numIterations = numIterations;
+		result.nanoSecsPerOp = (double)elapsedNanoSec.count() / numIterations;
+		result.allocsPerOp = (double)numAllocs / numIterations;
+
+		if(elapsedNanoSec >= std::chrono::milliseconds(MICROBENCH_MIN_TIME_MS) )
+			return result;
+	}
+}
+
+/**
+ * Get a stat buffer of a regular file with typical values.
+ */
+struct stat getBenchStatBuf()
+{
+	struct stat statBuf;
+
+	memset(&statBuf, 0, sizeof(statBuf) );
+
+	statBuf.st_mode = S_IFREG | 0644;
+	statBuf.st_size = 123456;
+	statBuf.st_blocks = 248;
+	statBuf.st_uid = 1000;
+	statBuf.st_gid = 1000;
+	statBuf.st_nlink = 1;
+	statBuf.st_ino = 987654321;
+	statBuf.st_atim.tv_sec = state.startTimeSecs - 3600;
+	statBuf.st_mtim.tv_sec = state.startTimeSecs - 86400;
+	statBuf.st_ctim.tv_sec = state.startTimeSecs - 86400;
+
+	return statBuf;
+}
+
+/**
+ * Push and pop on a single SharedStack from the given number of threads in parallel.
+ *
+ * @numIterations number of push/pop pairs per thread.
+ */
+void benchSharedStack(unsigned numThreads, uint64_t numIterations, const std::string& dirPath)
+{
+	SharedStack stack;
+	std::vector<std::thread> threads;
+
+	for(unsigned i=0; i < numThreads; i++)
+		threads.push_back(std::thread( [&]()
+		{
+			std::string poppedPath;
+			unsigned short poppedDepth;
+
+			for(uint64_t j=0; j < numIterations; j++)
+			{
+				stack.push(dirPath, 1);
+				stack.pop(poppedPath, poppedDepth);
+			}
+		} ) );
+
+	for(std::thread& thread : threads)
+		thread.join();
+}
+
+int main(int argc, char** argv)
+{
+	const std::string benchPath = "/data/project/experiment/run_0042/output/sample_0815.h5";
+	const std::string benchEscapePath = "/data/pro\"ject/tab\there/back\\slash/new\nline.txt";
+	const struct stat benchStatBuf = getBenchStatBuf();
+
+	struct dirent benchDirEntry;
+	memset(&benchDirEntry, 0, sizeof(benchDirEntry) );
+	benchDirEntry.d_type = DT_REG;
+	strcpy(benchDirEntry.d_name, "sample_0815.h5");
+
+	std::string nameFilter = (argc > 1) ? argv[1] : ""; // only run benchmarks containing this
+
+	if( (nameFilter == "-h") || (nameFilter == "--help") )
+	{
+		std::cout << "USAGE: " MICROBENCH_NAME " [NAME_SUBSTRING]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	/* printEntry() writes to stdout, so keep a separate handle for the results and send everything
+		else to /dev/null */
+	FILE* resultsFile = fdopen(dup(STDOUT_FILENO), "w");
+	if(!resultsFile || !freopen("/dev/null", "w", stdout) )
+	{
+		fprintf(stderr, "Failed to redirect stdout; Error: %s\n", strerror(errno) );
+		return EXIT_FAILURE;
+	}
+
+	std::vector<MicroBench> benchVec;
+
+	benchVec.push_back( {"escapeStrforJSON/plain", NULL, [&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			doNotOptimize(escapeStrforJSON(benchPath) );
+	} } );
+
+	benchVec.push_back( {"escapeStrforJSON/special", NULL, [&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			doNotOptimize(escapeStrforJSON(benchEscapePath) );
+	} } );
+
+	benchVec.push_back( {"printEntry/plain", NULL, [&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			printEntry(benchPath, &benchDirEntry, NULL, NULL);
+	} } );
+
+	benchVec.push_back( {"printEntry/json",
+		[]() { config.printJSON = true; },
+		[&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			printEntry(benchPath, &benchDirEntry, NULL, NULL);
+	} } );
+
+	benchVec.push_back( {"printEntry/json-stat",
+		[]() { config.printJSON = true; config.statAll = true; },
+		[&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			printEntry(benchPath, &benchDirEntry, &benchStatBuf, NULL);
+	} } );
+
+	benchVec.push_back( {"filterPrintEntryByName/1-pattern",
+		[]() { config.nameFilterVec.push_back("*.h5"); },
+		[&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			doNotOptimize(filterPrintEntryByName(benchPath, &benchDirEntry, NULL) );
+	} } );
+
+	benchVec.push_back( {"filterPrintEntryByName/" + std::to_string(MICROBENCH_NAME_PATTERNS) +
+		"-patterns",
+		[]()
+		{ // (no pattern matches, so that all patterns get checked)
+			for(unsigned i=0; i < MICROBENCH_NAME_PATTERNS; i++)
+				config.nameFilterVec.push_back("*_" + std::to_string(i) + "_*.dat");
+		},
+		[&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			doNotOptimize(filterPrintEntryByName(benchPath, &benchDirEntry, NULL) );
+	} } );
+
+	benchVec.push_back( {"filterPrintEntryBySizeOrTime",
+		[]()
+		{ // (all filters pass, so that all get checked)
+			config.filterSizeAndTime.filterSizeAndTimeFlags = FILTER_FLAG_SIZE_GREATER |
+				FILTER_FLAG_SIZE_LESS | FILTER_FLAG_MTIME_LESS | FILTER_FLAG_ATIME_LESS;
+			config.filterSizeAndTime.sizeGreater = 1024;
+			config.filterSizeAndTime.sizeLess = 1024 * 1024;
+			config.filterSizeAndTime.mtimeLess = state.startTimeSecs;
+			config.filterSizeAndTime.atimeLess = state.startTimeSecs;
+		},
+		[&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+			doNotOptimize(filterPrintEntryBySizeOrTime(benchPath, &benchDirEntry,
+				&benchStatBuf) );
+	} } );
+
+	benchVec.push_back( {"replacePathPlaceholerWithPath", NULL, [&](uint64_t numIterations)
+	{
+		for(uint64_t i=0; i < numIterations; i++)
+		{
+			std::string subject(EXEC_ARG_PATH_PLACEHOLDER ".bak");
+			replacePathPlaceholerWithPath(subject, benchPath);
+			doNotOptimize(subject);
+		}
+	} } );
+
+	for(unsigned numThreads : {1, 2, 4, 8} )
+		benchVec.push_back( {"SharedStack/push+pop/" + std::to_string(numThreads) + "-threads",
+			NULL, [numThreads, &benchPath](uint64_t numIterations)
+		{ // (total number of push/pop pairs is numIterations)
+			benchSharedStack(numThreads, numIterations / numThreads, benchPath);
+		} } );
+
+	fprintf(resultsFile, "%-40s %12s %10s %10s\n", "BENCHMARK", "ITERATIONS", "NS/OP", "ALLOCS/OP");
+
+	for(const MicroBench& bench : benchVec)
+	{
+		if(bench.name.find(nameFilter) == std::string::npos)
+			continue;
+
+		MicroBenchResult result = runMicroBench(bench);
+
+		fprintf(resultsFile, "%-40s %12" PRIu64 " %10.1f %10.2f\n",
+			bench.name.c_str(), result.numIterations, result.nanoSecsPerOp, result.allocsPerOp);
+		fflush(resultsFile);
+	}
+
+	fclose(resultsFile);
+
+	return EXIT_SUCCESS;
+}
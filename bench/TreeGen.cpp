@@ -0,0 +1,447 @@
+/**
+ * Generator of synthetic directory trees for reproducible benchmarks of elfindo. The same
+ * parameters and seed always result in the same tree.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <iostream>
+#include <limits.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+#define TREEGEN_NAME				EXE_NAME "-treegen"
+
+#define ARG_DEPTH_LONG				"depth"
+#define ARG_FANOUT_LONG				"fanout"
+#define ARG_FILES_LONG				"files"
+#define ARG_HARDLINKS_LONG			"hardlinks"
+#define ARG_HELP_LONG				"help"
+#define ARG_HELP_SHORT				'h'
+#define ARG_NAMELEN_LONG			"namelen"
+#define ARG_SEED_LONG				"seed"
+#define ARG_SIZES_LONG				"sizes"
+
+#define SIZEDIST_FIXED_STR			"fixed"
+#define SIZEDIST_UNIFORM_STR		"uniform"
+#define SIZEDIST_LOGUNIFORM_STR		"loguniform"
+
+#define HARDLINK_CANDIDATES_MAX		1024 // recent files to pick hardlink targets from
+#define WRITE_BUF_SIZE				(1024*1024) // buffer for file contents
+
+enum SizeDist
+{
+	SizeDist_FIXED = 0,
+	SizeDist_UNIFORM,
+	SizeDist_LOGUNIFORM, // uniform distribution of log2(size), so small files dominate
+};
+
+struct Config
+{
+	std::string rootPath; // dir in which the tree gets created; must not exist yet
+	unsigned fanout {10}; // number of subdirs per dir
+	unsigned depth {3}; // number of subdir levels below root
+	unsigned filesPerDir {20}; // number of files in each dir, including root
+	unsigned nameLenMin {8}; // min length of file and dir names
+	unsigned nameLenMax {16}; // max length of file and dir names
+	SizeDist sizeDist {SizeDist_LOGUNIFORM};
+	uint64_t sizeMin {0}; // min file size in bytes
+	uint64_t sizeMax {64*1024}; // max file size in bytes
+	double hardlinkRatio {0}; // fraction of files that are hardlinks to previous files
+	uint64_t seed {1}; // seed for pseudo-random names, sizes and hardlinks
+} config;
+
+struct Statistics
+{
+	uint64_t numDirs {0};
+	uint64_t numFiles {0};
+	uint64_t numHardlinks {0};
+	uint64_t numBytes {0}; // sum of sizes of files, excluding hardlinks
+} statistics;
+
+std::mt19937_64 randGen;
+std::vector<std::string> hardlinkCandidates; // ring buffer of recently created files
+std::vector<char> writeBuf;
+
+void printUsageAndExit()
+{
+	std::cout << TREEGEN_NAME " - Generate synthetic dir trees for " EXE_NAME " benchmarks" <<
+		std::endl;
+	std::cout << std::endl;
+	std::cout << "USAGE: " TREEGEN_NAME " [OPTIONS...] PATH" << std::endl;
+	std::cout << std::endl;
+	std::cout << "PATH must not exist yet. A summary of the created tree gets printed as JSON to" <<
+		std::endl;
+	std::cout << "stdout. The same options always result in the same tree." << std::endl;
+	std::cout << std::endl;
+	std::cout << "OPTIONS:" << std::endl;
+	std::cout << "  --depth NUM       - Number of subdir levels below PATH. (Default: 3)" << std::endl;
+	std::cout << "  --fanout NUM      - Number of subdirs per dir. (Default: 10)" << std::endl;
+	std::cout << "  --files NUM       - Number of files per dir. (Default: 20)" << std::endl;
+	std::cout << "  --hardlinks RATIO - Fraction of files that are hardlinks to previously" << std::endl;
+	std::cout << "                      created files, e.g. \"0.1\". (Default: 0)" << std::endl;
+	std::cout << "  --namelen MIN[-MAX] - Length of file and dir names. (Default: 8-16)" << std::endl;
+	std::cout << "  --seed NUM        - Seed for random names, sizes and hardlinks. (Default: 1)" <<
+		std::endl;
+	std::cout << "  --sizes DIST      - File size distribution: \"" SIZEDIST_FIXED_STR ":SIZE\", " <<
+		std::endl;
+	std::cout << "                      \"" SIZEDIST_UNIFORM_STR ":MIN-MAX\" or \"" SIZEDIST_LOGUNIFORM_STR
+		":MIN-MAX\". Sizes in bytes" << std::endl;
+	std::cout << "                      or with k/M/G suffix. (Default: " SIZEDIST_LOGUNIFORM_STR
+		":0-64k)" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Example:" << std::endl;
+	std::cout << "  $ " TREEGEN_NAME " --fanout 4 --depth 5 --files 100 --sizes " SIZEDIST_FIXED_STR
+		":4k /tmp/tree" << std::endl;
+
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Parse a size with optional k/M/G suffix.
+ */
+uint64_t parseSize(const std::string& sizeStr, const char* argName)
+{
+	char* endPtr;
+
+	uint64_t size = std::strtoull(sizeStr.c_str(), &endPtr, 10);
+
+	if(endPtr == sizeStr.c_str() )
+	{
+		fprintf(stderr, "Aborting because of invalid size for \"--%s\": %s\n",
+			argName, sizeStr.c_str() );
+		exit(EXIT_FAILURE);
+	}
+
+	switch(*endPtr)
+	{
+		case 0: break;
+		case 'k': size *= 1024; break;
+		case 'M': size *= 1024*1024; break;
+		case 'G': size *= 1024*1024*1024; break;
+		default:
+		{
+			fprintf(stderr, "Aborting because of invalid size suffix for \"--%s\": %s\n",
+				argName, sizeStr.c_str() );
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	return size;
+}
+
+/**
+ * Parse a range of the form "MIN-MAX" or a single value "VAL" (in which case min and max are
+ * identical).
+ */
+void parseRange(const std::string& rangeStr, const char* argName, uint64_t& outMin,
+	uint64_t& outMax)
+{
+	size_t dashPos = rangeStr.find('-');
+
+	outMin = parseSize(rangeStr.substr(0, dashPos), argName);
+	outMax = (dashPos == std::string::npos) ?
+		outMin : parseSize(rangeStr.substr(dashPos + 1), argName);
+
+	if(outMin > outMax)
+	{
+		fprintf(stderr, "Aborting because min is greater than max for \"--%s\": %s\n",
+			argName, rangeStr.c_str() );
+		exit(EXIT_FAILURE);
+	}
+}
+
+void parseSizesArg(const std::string& sizesStr)
+{
+	size_t colonPos = sizesStr.find(':');
+	std::string distStr = sizesStr.substr(0, colonPos);
+
+	if(colonPos == std::string::npos)
+	{
+		fprintf(stderr, "Aborting because of missing range for \"--" ARG_SIZES_LONG "\": %s\n",
+			sizesStr.c_str() );
+		exit(EXIT_FAILURE);
+	}
+
+	if(distStr == SIZEDIST_FIXED_STR)
+		config.sizeDist = SizeDist_FIXED;
+	else
+	if(distStr == SIZEDIST_UNIFORM_STR)
+		config.sizeDist = SizeDist_UNIFORM;
+	else
+	if(distStr == SIZEDIST_LOGUNIFORM_STR)
+		config.sizeDist = SizeDist_LOGUNIFORM;
+	else
+	{
+		fprintf(stderr, "Aborting because of invalid distribution for \"--" ARG_SIZES_LONG "\": "
+			"%s\n", distStr.c_str() );
+		exit(EXIT_FAILURE);
+	}
+
+	parseRange(sizesStr.substr(colonPos + 1), ARG_SIZES_LONG, config.sizeMin, config.sizeMax);
+
+	if(config.sizeDist == SizeDist_FIXED)
+		config.sizeMax = config.sizeMin;
+}
+
+void parseArguments(int argc, char** argv)
+{
+	int getOptLongRes;
+
+	static struct option long_options[] =
+	{
+		{ ARG_DEPTH_LONG, required_argument, 0, 0 },
+		{ ARG_FANOUT_LONG, required_argument, 0, 0 },
+		{ ARG_FILES_LONG, required_argument, 0, 0 },
+		{ ARG_HARDLINKS_LONG, required_argument, 0, 0 },
+		{ ARG_HELP_LONG, no_argument, 0, ARG_HELP_SHORT },
+		{ ARG_NAMELEN_LONG, required_argument, 0, 0 },
+		{ ARG_SEED_LONG, required_argument, 0, 0 },
+		{ ARG_SIZES_LONG, required_argument, 0, 0 },
+		{ 0, 0, 0, 0 }
+	};
+
+	while(1)
+	{
+		int option_index = 0;
+
+		getOptLongRes = getopt_long(argc, argv, "h", long_options, &option_index);
+
+		if(getOptLongRes == -1)
+			break; // end of options
+
+		switch(getOptLongRes)
+		{
+			case 0:
+			{
+				const std::string currentOptionName = long_options[option_index].name;
+
+				if(ARG_DEPTH_LONG == currentOptionName)
+					config.depth = std::stoul(optarg);
+				else
+				if(ARG_FANOUT_LONG == currentOptionName)
+					config.fanout = std::stoul(optarg);
+				else
+				if(ARG_FILES_LONG == currentOptionName)
+					config.filesPerDir = std::stoul(optarg);
+				else
+				if(ARG_HARDLINKS_LONG == currentOptionName)
+				{
+					config.hardlinkRatio = std::stod(optarg);
+
+					if( (config.hardlinkRatio < 0) || (config.hardlinkRatio > 1) )
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_HARDLINKS_LONG "\" must be "
+							"between 0 and 1\n");
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
+				if(ARG_NAMELEN_LONG == currentOptionName)
+				{
+					uint64_t nameLenMin;
+					uint64_t nameLenMax;
+
+					parseRange(optarg, ARG_NAMELEN_LONG, nameLenMin, nameLenMax);
+
+					if(!nameLenMin || (nameLenMax > NAME_MAX) )
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_NAMELEN_LONG "\" must be "
+							"between 1 and %d\n", NAME_MAX);
+						exit(EXIT_FAILURE);
+					}
+
+					config.nameLenMin = nameLenMin;
+					config.nameLenMax = nameLenMax;
+				}
+				else
+				if(ARG_SEED_LONG == currentOptionName)
+					config.seed = std::stoull(optarg);
+				else
+				if(ARG_SIZES_LONG == currentOptionName)
+					parseSizesArg(optarg);
+			} break;
+
+			case ARG_HELP_SHORT:
+			default:
+				printUsageAndExit();
+		}
+	}
+
+	if(optind != (argc - 1) )
+		printUsageAndExit();
+
+	config.rootPath = argv[optind];
+}
+
+/**
+ * Generate a unique name of random length within config name length range. Uniqueness within a
+ * dir is ensured by the index, the rest gets filled with random chars.
+ *
+ * @prefix 'd' for dirs, 'f' for files.
+ */
+std::string generateName(char prefix, unsigned index)
+{
+	const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_";
+
+	std::uniform_int_distribution<unsigned> lenDist(config.nameLenMin, config.nameLenMax);
+	std::uniform_int_distribution<unsigned> charDist(0, sizeof(chars) - 2);
+
+	std::string name = prefix + std::to_string(index);
+	unsigned nameLen = lenDist(randGen);
+
+	if(name.length() < nameLen)
+		name += '_';
+
+	while(name.length() < nameLen)
+		name += chars[charDist(randGen)];
+
+	return name;
+}
+
+uint64_t generateFileSize()
+{
+	switch(config.sizeDist)
+	{
+		case SizeDist_UNIFORM:
+		{
+			std::uniform_int_distribution<uint64_t> sizeDist(config.sizeMin, config.sizeMax);
+			return sizeDist(randGen);
+		}
+
+		case SizeDist_LOGUNIFORM:
+		{ // (+1 to make size 0 possible)
+			std::uniform_real_distribution<double> log2Dist(std::log2(config.sizeMin + 1),
+				std::log2(config.sizeMax + 1) );
+			uint64_t size = (uint64_t)std::llround(std::exp2(log2Dist(randGen) ) ) - 1;
+			return std::min(std::max(size, config.sizeMin), config.sizeMax);
+		}
+
+		default:
+			return config.sizeMin;
+	}
+}
+
+void createFile(const std::string& path)
+{
+	std::uniform_real_distribution<double> hardlinkDist(0, 1);
+
+	if(!hardlinkCandidates.empty() && (hardlinkDist(randGen) < config.hardlinkRatio) )
+	{
+		std::uniform_int_distribution<size_t> candidateDist(0, hardlinkCandidates.size() - 1);
+		const std::string& targetPath = hardlinkCandidates[candidateDist(randGen)];
+
+		if(link(targetPath.c_str(), path.c_str() ) == -1)
+		{
+			fprintf(stderr, "Failed to create hardlink: %s -> %s; Error: %s\n",
+				path.c_str(), targetPath.c_str(), strerror(errno) );
+			exit(EXIT_FAILURE);
+		}
+
+		statistics.numFiles++;
+		statistics.numHardlinks++;
+		return;
+	}
+
+	uint64_t fileSize = generateFileSize();
+
+	int fd = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+	if(fd == -1)
+	{
+		fprintf(stderr, "Failed to create file: %s; Error: %s\n", path.c_str(), strerror(errno) );
+		exit(EXIT_FAILURE);
+	}
+
+	/* random contents to avoid compression/dedup effects. each file gets its own generator, seeded
+		by seed and file index, so that equal-sized files differ and randGen for names and sizes is
+		not affected. */
+	std::seed_seq contentSeedSeq{config.seed, statistics.numFiles};
+	std::mt19937_64 contentRandGen(contentSeedSeq);
+
+	for(uint64_t numBytesWritten = 0; numBytesWritten < fileSize; )
+	{
+		size_t writeLen = std::min(fileSize - numBytesWritten, (uint64_t)writeBuf.size() );
+
+		for(size_t i=0; i < writeLen; i += sizeof(uint64_t) )
+		{
+			uint64_t randVal = contentRandGen();
+			memcpy(&writeBuf[i], &randVal, std::min(sizeof(randVal), writeLen - i) );
+		}
+
+		ssize_t writeRes = write(fd, writeBuf.data(), writeLen);
+		if(writeRes <= 0)
+		{
+			fprintf(stderr, "Failed to write file: %s; Error: %s\n",
+				path.c_str(), strerror(errno) );
+			exit(EXIT_FAILURE);
+		}
+
+		numBytesWritten += writeRes;
+	}
+
+	close(fd);
+
+	statistics.numFiles++;
+	statistics.numBytes += fileSize;
+
+	if(config.hardlinkRatio > 0)
+	{ // remember as hardlink candidate
+		if(hardlinkCandidates.size() < HARDLINK_CANDIDATES_MAX)
+			hardlinkCandidates.push_back(path);
+		else
+			hardlinkCandidates[statistics.numFiles % HARDLINK_CANDIDATES_MAX] = path;
+	}
+}
+
+/**
+ * Create the given dir and its files, then recurse into subdirs.
+ *
+ * @dirDepth depth of path relative to config.rootPath.
+ */
+void createDir(const std::string& path, unsigned dirDepth)
+{
+	if(mkdir(path.c_str(), 0755) == -1)
+	{
+		fprintf(stderr, "Failed to create dir: %s; Error: %s\n", path.c_str(), strerror(errno) );
+		exit(EXIT_FAILURE);
+	}
+
+	statistics.numDirs++;
+
+	for(unsigned i=0; i < config.filesPerDir; i++)
+		createFile(path + "/" + generateName('f', i) );
+
+	if(dirDepth >= config.depth)
+		return;
+
+	for(unsigned i=0; i < config.fanout; i++)
+		createDir(path + "/" + generateName('d', i), dirDepth + 1);
+}
+
+int main(int argc, char** argv)
+{
+	parseArguments(argc, argv);
+
+	randGen.seed(config.seed);
+
+	writeBuf.resize(WRITE_BUF_SIZE);
+
+	createDir(config.rootPath, 0);
+
+	printf("{\"dirs\":%" PRIu64 ",\"files\":%" PRIu64 ",\"hardlinks\":%" PRIu64 ","
+		"\"bytes\":%" PRIu64 "}\n",
+		statistics.numDirs, statistics.numFiles, statistics.numHardlinks, statistics.numBytes);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#!/bin/bash
+#
+# Reproducible end-to-end benchmark of elfindo against GNU find (and cp for copies) on a synthetic
+# tree. Each mode gets run BENCH_RUNS times per tool and results are written as JSON, so that
+# they can be compared across commits. This is called by "make bench".
+#
+# Settings via environment variables:
+#   ELFINDO          - Path to elfindo executable. (Default: bin/elfindo)
+#   TREEGEN          - Path to tree generator executable. (Default: bin/elfindo-treegen)
+#   BENCH_DIR        - Dir for generated trees; gets deleted at the end.
+#                      (Default: /tmp/elfindo-bench)
+#   BENCH_TREE_ARGS  - Tree generator args. (Default: "--fanout 10 --depth 3 --files 20")
+#   BENCH_RUNS       - Number of runs per mode and tool. (Default: 3)
+#   BENCH_THREADS    - Number of elfindo threads. (Default: 16)
+#   BENCH_MODES      - Space-separated list of modes.
+#                      (Default: "plain stat json filter copyto unlink")
+#   BENCH_OUTPUT     - Path to JSON results file.
+#                      (Default: bench/results/<date>-<git commit>.json)
+#   BENCH_DROP_CACHES - Set to 1 to drop page cache before each run. (Requires root.)
+
+BENCH_BASE_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO_BASE_DIR="$(dirname "$BENCH_BASE_DIR")"
+
+ELFINDO="${ELFINDO:-$REPO_BASE_DIR/bin/elfindo}"
+TREEGEN="${TREEGEN:-$REPO_BASE_DIR/bin/elfindo-treegen}"
+BENCH_DIR="${BENCH_DIR:-/tmp/elfindo-bench}"
+BENCH_TREE_ARGS="${BENCH_TREE_ARGS:---fanout 10 --depth 3 --files 20}"
+BENCH_RUNS="${BENCH_RUNS:-3}"
+BENCH_THREADS="${BENCH_THREADS:-16}"
+BENCH_MODES="${BENCH_MODES:-plain stat json filter copyto unlink}"
+BENCH_DROP_CACHES="${BENCH_DROP_CACHES:-0}"
+
+GIT_COMMIT="$(git -C "$REPO_BASE_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)"
+BENCH_DATE="$(date -u +%Y%m%dT%H%M%SZ)"
+BENCH_OUTPUT="${BENCH_OUTPUT:-$BENCH_BASE_DIR/results/$BENCH_DATE-$GIT_COMMIT.json}"
+
+TREE_DIR="$BENCH_DIR/tree" # pristine tree for read-only modes
+WORK_DIR="$BENCH_DIR/work" # copy of tree for destructive modes
+COPY_DEST_DIR="$BENCH_DIR/copydest"
+
+# Print error message and exit.
+die()
+{
+	echo "ERROR: $*" >&2
+	exit 1
+}
+
+# Drop page cache if BENCH_DROP_CACHES=1.
+drop_caches()
+{
+	if [ "$BENCH_DROP_CACHES" = "1" ]; then
+		sync && echo 3 > /proc/sys/vm/drop_caches || die "Failed to drop caches"
+	fi
+}
+
+# Prepare a fresh state before a run of the given mode. Not included in the measured time.
+prepare_run()
+{
+	local MODE="$1"
+
+	case "$MODE" in
+		copyto)
+			rm -rf "$COPY_DEST_DIR" && mkdir -p "$COPY_DEST_DIR" || die "Failed to prepare copy dir"
+			;;
+		unlink)
+			rm -rf "$WORK_DIR" && cp -a "$TREE_DIR" "$WORK_DIR" || die "Failed to prepare work dir"
+			;;
+	esac
+
+	drop_caches
+}
+
+# Print the command line for the given mode and tool ("elfindo" or "find"/"cp").
+get_cmd()
+{
+	local MODE="$1"
+	local TOOL="$2"
+	local ELFINDO_CMD="$ELFINDO --threads $BENCH_THREADS --nosummary"
+
+	case "$MODE:$TOOL" in
+		plain:elfindo)  echo "$ELFINDO_CMD $TREE_DIR" ;;
+		plain:find)     echo "find $TREE_DIR" ;;
+		stat:elfindo)   echo "$ELFINDO_CMD --stat $TREE_DIR" ;;
+		stat:find)      echo "find $TREE_DIR -printf %s\n" ;;
+		json:elfindo)   echo "$ELFINDO_CMD --json --stat $TREE_DIR" ;;
+		json:find)      echo "find $TREE_DIR -printf {\"path\":\"%p\",\"size\":%s,\"mtime\":%T@}\n" ;;
+		filter:elfindo) echo "$ELFINDO_CMD --type f --name f1* --size +4k $TREE_DIR" ;;
+		filter:find)    echo "find $TREE_DIR -type f -name f1* -size +4k" ;;
+		copyto:elfindo) echo "$ELFINDO_CMD --copyto $COPY_DEST_DIR $TREE_DIR" ;;
+		copyto:cp)      echo "cp -r $TREE_DIR $COPY_DEST_DIR" ;;
+		unlink:elfindo) echo "$ELFINDO_CMD --type f --unlink $WORK_DIR" ;;
+		unlink:find)    echo "find $WORK_DIR -type f -delete" ;;
+		*)              die "Unknown benchmark mode: $MODE" ;;
+	esac
+}
+
+# Print the tools to compare for the given mode.
+get_tools()
+{
+	if [ "$1" = "copyto" ]; then
+		echo "elfindo cp"
+	else
+		echo "elfindo find"
+	fi
+}
+
+# Run the given mode with the given tool BENCH_RUNS times and print a JSON result object.
+run_mode()
+{
+	local MODE="$1"
+	local TOOL="$2"
+	local CMD
+	local SECS_LIST=""
+	local START_NS
+	local END_NS
+	local NUM_FAILED=0
+
+	CMD="$(get_cmd "$MODE" "$TOOL")"
+
+	for (( i=0; i < BENCH_RUNS; i++ )); do
+		prepare_run "$MODE"
+
+		START_NS="$(date +%s%N)"
+		# (word splitting of CMD is intended; glob chars are protected by "set -f")
+		$CMD > /dev/null 2>&1 || NUM_FAILED=$((NUM_FAILED + 1))
+		END_NS="$(date +%s%N)"
+
+		SECS_LIST="$SECS_LIST $(awk "BEGIN { printf \"%.6f\", ($END_NS - $START_NS) / 1e9 }")"
+	done
+
+	echo "  * $MODE / $TOOL:$SECS_LIST sec" >&2
+
+	echo "$SECS_LIST" | tr ' ' '\n' | grep -v '^$' | sort -n | \
+		awk -v mode="$MODE" -v tool="$TOOL" -v failed="$NUM_FAILED" '
+			{ secs[NR] = $1; list = list (NR > 1 ? "," : "") $1 }
+			END {
+				median = (NR % 2) ? secs[(NR + 1) / 2] : (secs[NR / 2] + secs[NR / 2 + 1]) / 2;
+				printf "{\"mode\":\"%s\",\"tool\":\"%s\",\"failed_runs\":%d,", mode, tool, failed;
+				printf "\"secs\":[%s],\"median_sec\":%.6f}", list, median;
+			}'
+}
+
+set -f # no globbing of patterns in command lines
+
+[ -x "$ELFINDO" ] || die "elfindo executable not found: $ELFINDO"
+[ -x "$TREEGEN" ] || die "Tree generator executable not found: $TREEGEN"
+[ -e "$BENCH_DIR" ] && die "Benchmark dir exists already: $BENCH_DIR"
+mkdir -p "$BENCH_DIR" "$(dirname "$BENCH_OUTPUT")" || die "Failed to create dirs"
+
+echo "Generating tree: $TREE_DIR ($BENCH_TREE_ARGS)" >&2
+
+# (word splitting of BENCH_TREE_ARGS is intended)
+TREE_SUMMARY="$($TREEGEN $BENCH_TREE_ARGS "$TREE_DIR")" || die "Tree generation failed"
+
+echo "Tree: $TREE_SUMMARY" >&2
+echo "Running benchmarks ($BENCH_RUNS runs each)..." >&2
+
+RESULTS=""
+
+for MODE in $BENCH_MODES; do
+	for TOOL in $(get_tools "$MODE"); do
+		RESULTS="$RESULTS${RESULTS:+,}$(run_mode "$MODE" "$TOOL")"
+	done
+done
+
+cat > "$BENCH_OUTPUT" << EOF
+{"date":"$BENCH_DATE","commit":"$GIT_COMMIT","host":"$(hostname)","nproc":$(nproc),\
+"elfindo_version":"$($ELFINDO --version | sed -n 's/.*Version: //p')",\
+"threads":$BENCH_THREADS,"runs":$BENCH_RUNS,"drop_caches":$BENCH_DROP_CACHES,\
+"tree":{"args":"$BENCH_TREE_ARGS","summary":$TREE_SUMMARY},"results":[$RESULTS]}
+EOF
+
+rm -rf "$BENCH_DIR"
+
+echo "Results: $BENCH_OUTPUT" >&2
@@ -8,15 +8,20 @@
  * anyways.)
  */
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <climits>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <dirent.h>
 #include <exception>
 #include <fcntl.h>
 #include <filesystem>
+#include <fstream>
 #include <fnmatch.h>
+#include <functional>
 #include <getopt.h>
 #include <grp.h>
 #include <inttypes.h> // defines PRIu64 for printf uint64_t
@@ -24,33 +29,76 @@
 #include <iomanip>
 #include <libgen.h>
 #include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <pwd.h>
+#include <queue>
+#include <random>
+#include <sched.h>
 #include <signal.h>
 #include <stack>
 #include <sstream>
 #include <string>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
 #include <sys/types.h>
 #include <sys/xattr.h>
 #include <time.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__x86_64__)
+	#include <cpuid.h> // cpu feature detection for hardware-accelerated checksums
+	#include <immintrin.h>
+#elif defined(__aarch64__)
+	#include <arm_acle.h>
+	#include <arm_neon.h>
+	#include <asm/hwcap.h> // cpu feature detection for hardware-accelerated checksums
+	#include <sys/auxv.h>
+#endif
+
+#ifndef CYGWIN_SUPPORT
+	#include <linux/fs.h> // defines FS_IOC_FSGETXATTR for project IDs
+	#include <sys/ioctl.h>
+#endif
+
 
 #define ARG_FILTER_ATIME	"atime"
 #define ARG_ACLCHECK_LONG	"aclcheck"
+#define ARG_BACKGROUND_LONG	"background"
+#define ARG_TOPBY_LONG		"by"
+#define ARG_CHECKSUM_LONG	"checksum"
+#define ARG_CONTAINS_LONG	"contains"
+#define ARG_CONTAINSANY_LONG	"contains-any"
 #define ARG_COPYDEST_LONG	"copyto"
 #define ARG_FILTER_CTIME	"ctime"
+#define ARG_DEVTHREADS_LONG	"dev-threads"
+#define ARG_DUPLICATES_LONG	"duplicates"
+#define ARG_ESTIMATE_LONG	"estimate"
+#define ARG_ESTIMATETIME_LONG	"estimate-time"
 #define ARG_EXEC_LONG		"exec"
 #define ARG_GID_LONG		"gid"
+#define ARG_FSBACKEND_LONG	"fs-backend"
 #define ARG_GODEEP_LONG		"godeep"
 #define ARG_GROUP_LONG		"group"
+#define ARG_HASHIN_LONG		"hash-in"
 #define ARG_HELP_SHORT		'h'
+#define ARG_HISTOGRAM_LONG	"histogram"
 #define ARG_HELP_LONG		"help"
 #define ARG_JSON_LONG		"json"
+#define ARG_LATENCY_LONG	"latency"
+#define ARG_LIMIT_LONG		"limit"
+#define ARG_MAGIC_LONG		"magic"
 #define ARG_MAXDEPTH_LONG	"maxdepth"
+#define ARG_MAXENTRIES_LONG	"max-entries"
+#define ARG_METRICSFILE_LONG	"metrics-file"
+#define ARG_METRICSINTERVAL_LONG	"metrics-interval"
 #define ARG_MOUNT_LONG		"mount"
 #define ARG_FILTER_MTIME	"mtime"
 #define ARG_NAME_LONG		"name"
@@ -62,14 +110,22 @@
 #define ARG_NOTIMEUPD_LONG	"notimeupd"
 #define ARG_PATH_LONG		"path"
 #define ARG_PRINT0_LONG		"print0"
+#define ARG_PROGRESS_LONG	"progress"
 #define ARG_QUITAFTER1_LONG "quit"
+#define ARG_REPORTHOTDIRS_LONG	"report-hotdirs"
 #define ARG_FILTER_SIZE		"size"
 #define ARG_STAT_LONG		"stat"
+#define ARG_SUMMARYJSON_LONG	"summary-json"
 #define ARG_THREADS_SHORT	't'
+#define ARG_TIMELIMIT_LONG	"time-limit"
 #define ARG_THREADS_LONG	"threads"
+#define ARG_TOP_LONG		"top"
+#define ARG_TRACE_LONG		"trace"
+#define ARG_TRACESAMPLE_LONG	"trace-sample"
 #define ARG_SEARCHTYPE_LONG	"type"
 #define ARG_UID_LONG		"uid"
 #define ARG_UNLINK_LONG		"unlink"
+#define ARG_USAGEBY_LONG	"usage-by"
 #define ARG_USER_LONG		"user"
 #define ARG_VERBOSE_LONG	"verbose"
 #define ARG_VERSION_LONG	"version"
@@ -91,13 +147,87 @@
 #define FILTER_FLAG_MTIME_EXACT		(1 << 3)
 #define FILTER_FLAG_MTIME_LESS		(1 << 4)
 #define FILTER_FLAG_MTIME_GREATER	(1 << 5)
-#define FILTER_FLAG_CTIME_EXACT		(1 << 6)
-#define FILTER_FLAG_CTIME_LESS		(1 << 7)
-#define FILTER_FLAG_CTIME_GREATER	(1 << 8)
+// (not "CTIME", because that is a termios macro from sys/ioctl.h)
+#define FILTER_FLAG_CHANGETIME_EXACT	(1 << 6)
+#define FILTER_FLAG_CHANGETIME_LESS		(1 << 7)
+#define FILTER_FLAG_CHANGETIME_GREATER	(1 << 8)
 #define FILTER_FLAG_ATIME_EXACT		(1 << 9)
 #define FILTER_FLAG_ATIME_LESS		(1 << 10)
 #define FILTER_FLAG_ATIME_GREATER	(1 << 11)
 
+#define HISTOGRAM_TYPE_SIZE_STR		"size"
+#define HISTOGRAM_TYPE_ATIME_STR	"atime"
+#define HISTOGRAM_TYPE_MTIME_STR	"mtime"
+#define HISTOGRAM_TYPE_DEPTH_STR	"depth"
+#define HISTOGRAM_LOG2_NUMBUCKETS	65 // bucket 0 for value 0, bucket N for [2^(N-1), 2^N)
+
+#define USAGEBY_TYPE_USER_STR		"user"
+#define USAGEBY_TYPE_GROUP_STR		"group"
+#define USAGEBY_TYPE_PROJECT_STR	"project"
+
+#define PROJID_FILE_PATH			"/etc/projid" // project ID to name mapping for xfs_quota
+#define USAGE_KEY_NONE				(~0ULL) // uid/gid/project ID couldn't be determined
+
+#define TOP_SORTKEY_SIZE_STR	"size"
+#define TOP_SORTKEY_BLOCKS_STR	"blocks"
+#define TOP_SORTKEY_MTIME_STR	"mtime"
+#define TOP_SORTKEY_ATIME_STR	"atime"
+
+#define FILE_READ_BUF_SIZE			(4*1024*1024) // 4MiB buffer for reading file contents
+#define DUPLICATES_PARTIAL_LEN		(64*1024) // hash this much at start & end in partial stage
+#define DUPLICATES_MIN_CHUNK_LEN	(4*1024) // min read size per file in comparison stage
+#define DUPLICATES_MAX_OPEN_FILES	256 // larger groups reopen files for each chunk
+
+#define CHECKSUM_ALGO_SHA256_STR	"sha256"
+#define CHECKSUM_ALGO_XXH3_STR		"xxh3"
+#define CHECKSUM_ALGO_CRC32C_STR	"crc32c"
+#define CHECKSUM_XXH3_PREFIX		"XXH3_" // prefix of xxh3 checksums in "xxhsum" manifests
+
+#define MAGIC_READ_LEN				(4*1024) // read this much from file start for "--magic"
+#define MAGIC_TYPE_ANY_STR			"any" // matches any known type
+
+#define ESTIMATE_TIME_SECS_DEFAULT		10 // time budget for "--estimate"
+#define ESTIMATE_CHECK_INTERVAL_MS		100 // check for end of "--estimate" at this interval
+#define ESTIMATE_MIN_PROBES				100 // min probes before "--estimate" may end early
+#define ESTIMATE_PRECISE_REL_HALFWIDTH	0.001 // end "--estimate" early with intervals this narrow
+#define ESTIMATE_DIRCACHE_MAX_SIZE		(64*1024) // max number of cached dirs for "--estimate"
+
+#define PROGRESS_INTERVAL_SECS_DEFAULT	5 // interval for "--progress" without argument
+#define PROGRESS_CHECK_INTERVAL_MS		200 // check for SIGUSR1 snapshot request at this interval
+
+#define THREADS_AUTO_STR				"auto" // "--threads" value for adaptive concurrency
+#define AUTO_THREADS_MIN_DEFAULT		4 // min active scan threads for "--threads auto"
+#define AUTO_THREADS_MAX_DEFAULT		256 // max active scan threads for "--threads auto"
+#define AUTO_THREADS_START				16 // initial active scan threads for "--threads auto"
+#define CONCURRENCY_CTRL_INTERVAL_MS	250 // interval of active thread limit updates
+#define CONCURRENCY_CTRL_MIN_OPS		16 // min filesystem calls per interval for an update
+#define CONCURRENCY_CTRL_INCREASE		4 // additive increase of active thread limit
+#define CONCURRENCY_CTRL_DECREASE		0.75 // multiplicative decrease of active thread limit
+#define CONCURRENCY_CTRL_LATENCY_FACTOR	2.0 // latency above baseline*factor is congestion
+#define CONCURRENCY_CTRL_GAIN_FACTOR	1.05 // throughput above last by this factor is a gain
+#define CONCURRENCY_CTRL_BASELINE_DRIFT	0.05 // weight of new latency for rising baseline
+#define CONCURRENCY_CTRL_BASELINE_UPDATES	4 // updates to measure "--background" baseline
+
+#ifndef IOPRIO_CLASS_SHIFT // (linux/ioprio.h is not available everywhere)
+	#define IOPRIO_CLASS_SHIFT			13
+	#define IOPRIO_CLASS_IDLE			3
+	#define IOPRIO_WHO_PROCESS			1 // "process" means thread here
+#endif
+
+#define DEV_THREADS_AUTO_STR			"auto" // "--dev-threads" value for auto-detected limits
+#define DEV_THREADS_ROTATIONAL			4 // "--dev-threads auto" limit for rotational disks
+#define DEV_ID_NONE						(~0ULL) // device of dirs that were pushed without dev ID
+
+#define FSBACKEND_POSIX_STR			"posix"
+#define FSBACKEND_SYNTHETIC_STR		"synthetic"
+#define SYNTHETIC_FS_DEV_ID			0x5f5f // st_dev of first root in synthetic filesystem
+#define SYNTHETIC_FS_DIR_SIZE		4096 // st_size of dirs in synthetic filesystem
+
+#define TRACE_RINGBUF_NUM_EVENTS		(64*1024) // max "--trace" events per thread; oldest dropped
+
+#define METRICS_INTERVAL_SECS_DEFAULT	15 // rewrite interval for "--metrics-file"
+#define METRICS_NAME_PREFIX				EXE_NAME "_" // prefix of prometheus metric names
+
 #define EXEC_ARG_PATH_PLACEHOLDER	"{}"
 #define EXEC_ARG_TERMINATOR			";"
 
@@ -106,14 +236,119 @@ typedef std::vector<std::string> StringVec;
 // short-hand macro to either return or exit on fatal errors depending on user config
 #define EXIT_OR_RETURN_CONFIGURABLE(ignoreError)	{ if(ignoreError) return; else exit(1); }
 
+enum TopSortKey
+{
+	TopSortKey_SIZE = 0, // largest st_size first
+	TopSortKey_BLOCKS, // largest st_blocks first
+	TopSortKey_MTIME, // oldest st_mtime first
+	TopSortKey_ATIME, // oldest st_atime first
+};
+
+enum HistogramType
+{
+	HistogramType_SIZE = 0, // st_size in bytes
+	HistogramType_ATIME, // age based on st_atime in days
+	HistogramType_MTIME, // age based on st_mtime in days
+	HistogramType_DEPTH, // dir depth relative to scan path
+};
+
+struct HistogramConfig
+{
+	HistogramType type;
+	std::vector<uint64_t> bucketBounds; // user-defined lower bounds of buckets; empty for log2
+};
+
+enum UsageByType
+{
+	UsageByType_USER = 0, // st_uid
+	UsageByType_GROUP, // st_gid
+	UsageByType_PROJECT, // project ID from FS_IOC_FSGETXATTR
+};
+
+enum ChecksumAlgo
+{
+	ChecksumAlgo_NONE = 0, // no checksum calculation
+	ChecksumAlgo_SHA256,
+	ChecksumAlgo_XXH3, // 64-bit XXH3
+	ChecksumAlgo_CRC32C,
+};
+
+enum EstimateValue
+{
+	EstimateValue_ENTRIES = 0,
+	EstimateValue_DIRS,
+	EstimateValue_FILES,
+	EstimateValue_BYTES, // sum of st_size
+
+	EstimateValue_COUNT, // number of values (not a value itself)
+};
+
+enum SyscallType
+{
+	SyscallType_OPENDIR = 0,
+	SyscallType_READDIR,
+	SyscallType_STAT,
+	SyscallType_OPEN,
+	SyscallType_READ,
+	SyscallType_WRITE,
+	SyscallType_MKDIR,
+	SyscallType_UNLINK,
+	SyscallType_GETXATTR,
+
+	SyscallType_COUNT, // number of types (not a type itself)
+};
+
+enum ThreadTimeType
+{
+	ThreadTimeType_READDIR = 0,
+	ThreadTimeType_STAT,
+	ThreadTimeType_PROCESSING, // processDiscoveredEntry(), including output
+	ThreadTimeType_OUTPUT, // printing of entries
+	ThreadTimeType_WAIT, // waiting for new dirs in popWait()
+
+	ThreadTimeType_COUNT, // number of types (not a type itself)
+};
+
+enum TraceEventType
+{
+	TraceEventType_SCAN = 0, // span of scan() of a single dir (nested for depth recursion)
+	TraceEventType_WAIT, // span of waiting for new dirs in popWait()
+	TraceEventType_COPY, // span of copyEntry()
+	TraceEventType_PUSH, // instant event of dir push to shared stack
+	TraceEventType_POP, // instant event of dir pop from shared stack
+
+	TraceEventType_COUNT, // number of types (not a type itself)
+};
+
 struct ExternalProgExec
 {
 	StringVec cmdLineStrVec; // cmd and args if exec given by user, one of them being {} for path
 };
 
+/**
+ * Parameters of the in-memory synthetic filesystem backend, which simulates a tree of the given
+ * shape on a filesystem with the given latency and error rate.
+ */
+struct SyntheticFsConfig
+{
+	unsigned fanout {10}; // number of subdirs per dir
+	unsigned depth {3}; // number of subdir levels below scan path
+	uint64_t filesPerDir {100}; // number of files per dir
+	uint64_t fileSize {4096}; // size of each file in bytes
+	uint64_t latencyNanoSecs {0}; // delay of each filesystem call
+	uint64_t jitterNanoSecs {0}; // random deviation from latencyNanoSecs
+	double errorRate {0}; // probability of a filesystem call to fail with errorNum
+	int errorNum {EACCES}; // errno of injected errors
+	uint64_t seed {1}; // seed for pseudo-random jitter and errors
+};
+
 struct Config
 {
 	unsigned numThreads {16};
+	bool autoThreads {false}; // true to adapt number of active scan threads ("--threads auto")
+	bool background {false}; // idle priority and back off when latency rises ("--background")
+	unsigned autoThreadsMin {AUTO_THREADS_MIN_DEFAULT}; // min active threads for autoThreads
+	unsigned autoThreadsMax {AUTO_THREADS_MAX_DEFAULT}; // max active threads for autoThreads
 	unsigned depthSearchStartThreshold {0}; // start depth search when this num of dirs is in stack
 	bool printSummary {true}; // print scan summary at the end
 	bool printVerbose {false}; // true to enable verbose output
@@ -138,7 +373,9 @@ struct Config
 	} filterSizeAndTime;
 	uint64_t filterUID {~0ULL}; // numeric user ID
 	uint64_t filterGID {~0ULL}; // numeric group ID
-	uint64_t filterMountID {~0ULL}; // stay on mountpoint
+	bool stayOnDevice {false}; // don't descend into dirs on other devices than their scan path
+	unsigned devThreads {0}; // max threads per device (st_dev) for "--dev-threads" (0 for none)
+	bool devThreadsAuto {false}; // true to detect devThreads per device type
 	std::string copyDestDir; // target dir for file/dir copies
 	bool ignoreCopyErrors {false}; // ignore copy errors
 	bool printEntriesDisabled {false}; // true to disable print of discovered entries
@@ -146,1391 +383,8219 @@ struct Config
 	bool ignoreUnlinkErrors {false}; // ignore unlink errors
 	bool copyTimeUpdate {true}; // update atime/mtime when copying files
 	ExternalProgExec exec; // config to execute external prog for each disovered entry
-	bool quitAfterFirstMatch {false}; // true to quit after first match
+	uint64_t matchLimit {0}; // stop scan after this many matches (0 to disable)
+	uint64_t progressIntervalSecs {0}; // print progress to stderr at this interval (0 to disable)
+	bool measureSyscallLatency {false}; // true to measure latency of filesystem calls
+	bool recordSyscallLatency {false}; // true if latency gets recorded (also for autoThreads)
+	bool measureThreadTimes {false}; // true to measure how scan threads spend their time
+	std::string summaryJSONPath; // file to write summary in JSON format to (empty to disable)
+	bool useSyntheticFs {false}; // true to use synthetic filesystem backend instead of posix
+	SyntheticFsConfig syntheticFs; // parameters of synthetic filesystem backend
+	std::string traceFilePath; // file to write chrome trace events to (empty to disable)
+	uint64_t traceSampleInterval {1}; // record only every Nth trace event of each type
+	std::string metricsFilePath; // prometheus textfile to rewrite periodically (empty to disable)
+	uint64_t metricsIntervalSecs {METRICS_INTERVAL_SECS_DEFAULT}; // rewrite interval of metrics
+	unsigned topNum {0}; // print only the top N matches at the end (0 to disable)
+	unsigned hotDirsNum {0}; // print the N slowest and largest dirs at the end (0 to disable)
+	TopSortKey topSortKey {TopSortKey_SIZE}; // sort key to select top N matches
+	std::vector<HistogramConfig> histogramConfigVec; // histograms of matches to print at the end
+	std::vector<UsageByType> usageByVec; // usage reports of matches to print at the end
+	bool findDuplicates {false}; // find regular files with identical contents among matches
+	ChecksumAlgo checksumAlgo {ChecksumAlgo_NONE}; // checksum of regular files to print
+	StringVec containsLiterals; // or-filter on literal strings in contents of regular files
+	ChecksumAlgo hashInAlgo {ChecksumAlgo_NONE}; // algo of checksums in "--hash-in" file
+	StringVec magicTypes; // or-filter on file types detected by magic bytes
+	bool estimateOnly {false}; // estimate tree size by random probes instead of full scan
+	uint64_t estimateTimeSecs {ESTIMATE_TIME_SECS_DEFAULT}; // time budget for estimate
+	uint64_t timeLimitSecs {0}; // stop scan after this time with partial results (0 to disable)
+	uint64_t maxEntries {0}; // stop scan after this many entries with partial results (0 to disable)
 } config;
 
-struct State
-{
-	std::chrono::steady_clock::time_point startTime {std::chrono::steady_clock::now()};
-
-	std::stack<std::thread> scanThreads;
-} state;
-
-struct Statistics
-{
-	std::atomic_uint64_t numDirsFound {0};
-	std::atomic_uint64_t numFilesFound {0};
-	std::atomic_uint64_t numUnknownFound {0};
-	std::atomic_uint64_t numFilterMatches {0};
-	std::atomic_uint64_t numStatCalls {0};
-	std::atomic_uint64_t numAccessACLsFound {0};
-	std::atomic_uint64_t numDefaultACLsFound {0};
-	std::atomic_uint64_t numErrors {0}; // e.g. permission errors
-	std::atomic_uint64_t numBytesCopied {0};
-	std::atomic_uint64_t numFilesNotCopied {0}; // num skipped because non-regular file type
-} statistics;
-
-class ScanDoneException : public std::exception {};
-
 /**
- * This is the stack for directories that were found by the breadth search threads.
+ * Bounded min-heap to keep only the elements with the highest rank. Elements of type T need to have
+ * an int64_t "rank" member.
+ *
+ * The element with the lowest rank is on top, so that a new candidate only needs to be compared to
+ * the top element to find out whether it makes it into the heap.
  */
-class SharedStack
+template <typename T>
+class BoundedTopHeap
 {
 	private:
-		struct StackElem
+		struct RankGreater
 		{
-			StackElem(const std::string& dirPath, unsigned short dirDepth) :
-				dirPath(dirPath), dirDepth(dirDepth) {}
-
-			std::string dirPath;
-			unsigned short dirDepth; // dirPath depth relative to start path
+			bool operator()(const T& a, const T& b) const { return a.rank > b.rank; }
 		};
 
 	public:
-		SharedStack() {}
+		BoundedTopHeap(size_t maxNumElems) : maxNumElems(maxNumElems) {}
 
 	private:
-		std::stack<StackElem> dirPathStack;
-		std::mutex mutex;
-		std::condition_variable condition; // when new elems are pushed
-		unsigned numWaiters {0}; // detect termination when equal to number of threads
-		std::atomic_uint64_t stackSize {0}; // to get stack size lock-free
+		size_t maxNumElems; // max number of elems to keep
+		std::priority_queue<T, std::vector<T>, RankGreater> heap; // top is elem with lowest rank
 
 	public:
-		void push(const std::string& dirPath, unsigned short dirDepth)
+		/**
+		 * Check if an element with the given rank would make it into the heap. This is intended to
+		 * avoid construction of elements that would immediately get dropped.
+		 */
+		bool isCandidate(int64_t rank) const
 		{
-			std::unique_lock<std::mutex> lock(mutex); // L O C K
+			return (heap.size() < maxNumElems) || (rank > heap.top().rank);
+		}
 
-			dirPathStack.push(StackElem(dirPath, dirDepth) );
+		/**
+		 * Add elem if it is among the max number of elems with the highest rank.
+		 */
+		void push(T&& elem)
+		{
+			if(!isCandidate(elem.rank) )
+				return;
 
-			stackSize++;
+			if(heap.size() >= maxNumElems)
+				heap.pop(); // drop elem with lowest rank to make room
 
-			condition.notify_one();
+			heap.push(std::move(elem) );
 		}
 
 		/**
-		 * If stack is empty, this waits for a new push.
-		 *
-		 * @return false if stack was empty, so outDirPath did not get assigned.
-		 * @throw ScanDoneException when all threads were waiting, so no thread was active anymore
-		 * 		to add more dirs to the queue.
+		 * Move all elems of other heap into this heap. Other heap will be empty afterwards.
 		 */
-		bool popWait(std::string& outDirPath, unsigned short& outDirDepth)
+		void mergeFrom(BoundedTopHeap<T>& other)
 		{
-			std::unique_lock<std::mutex> lock(mutex); // L O C K
+			while(!other.heap.empty() )
+			{
+				// (const_cast is ok because elem gets popped right after the move)
+				push(std::move(const_cast<T&>(other.heap.top() ) ) );
+				other.heap.pop();
+			}
+		}
 
-			numWaiters++;
+		/**
+		 * Get all elems sorted by descending rank. The heap will be empty afterwards.
+		 */
+		std::vector<T> extractSorted()
+		{
+			std::vector<T> sortedVec(heap.size() );
 
-			while(dirPathStack.empty() )
+			for(size_t i = sortedVec.size(); i > 0; i--)
 			{
-				if(numWaiters == config.numThreads)
-				{ // all threads waiting => end of dir tree scan
-					// note: no numWaiters-- here, so that all threads see termination condition
-					condition.notify_all();
-					throw ScanDoneException();
-				}
-
-				condition.wait(lock);
+				sortedVec[i-1] = std::move(const_cast<T&>(heap.top() ) );
+				heap.pop();
 			}
 
-			numWaiters--;
+			return sortedVec;
+		}
+};
 
-			if(dirPathStack.empty() )
-				return false;
+/**
+ * Histogram of filter matches. The index of a bucket in the vectors corresponds to the bucket
+ * index of the HistogramConfig at the same index in config.histogramConfigVec.
+ */
+struct Histogram
+{
+	std::vector<uint64_t> numEntriesVec; // number of entries per bucket
+	std::vector<uint64_t> numBytesVec; // sum of st_size per bucket
+};
 
-			StackElem& topElem = dirPathStack.top();
-			outDirPath = topElem.dirPath;
-			outDirDepth = topElem.dirDepth;
+/**
+ * Accumulated usage of a single user, group or project for the "--usage-by" report.
+ */
+struct UsageCounters
+{
+	uint64_t numEntries {0}; // number of inodes
+	uint64_t numBytes {0}; // sum of st_size
+	uint64_t numAllocatedBytes {0}; // sum of st_blocks in bytes
+};
 
-			dirPathStack.pop();
+typedef std::unordered_map<uint64_t, UsageCounters> UsageMap; // key is uid, gid or project ID
 
-			stackSize--;
+/**
+ * A hardlinked file for the "--usage-by" report. Its bytes only get accounted once at the end of
+ * the scan, because other links to the same inode might have been found by other threads.
+ */
+struct UsageHardlink
+{
+	uint64_t numBytes; // st_size
+	uint64_t numAllocatedBytes; // st_blocks in bytes
+	std::vector<uint64_t> usageKeyVec; // same order as config.usageByVec; USAGE_KEY_NONE on error
+};
 
-			return true;
+typedef std::map<std::pair<uint64_t, uint64_t>, UsageHardlink> UsageHardlinkMap; // st_dev, st_ino
+
+/**
+ * A regular file that is a candidate for "--duplicates".
+ */
+struct DuplicateCandidate
+{
+	std::string path;
+	uint64_t devID; // st_dev to detect hardlinks
+	uint64_t inodeID; // st_ino to detect hardlinks
+	uint64_t hash {0}; // partial or full contents hash, depending on stage of duplicates search
+	bool hashValid {false}; // false if hash is not calculated yet or file read failed
+};
+
+typedef std::vector<DuplicateCandidate> DuplicateCandidateVec;
+typedef std::unordered_map<uint64_t, DuplicateCandidateVec> DuplicateSizeMap; // key is st_size
+
+/**
+ * Candidates for "--duplicates" that are identical as far as the current stage of the duplicates
+ * search can tell.
+ */
+struct DuplicateGroup
+{
+	uint64_t fileSize;
+	DuplicateCandidateVec candidates;
+};
+
+/**
+ * Info about an entry that was gathered by reading its contents.
+ */
+struct EntryContentInfo
+{
+	std::string checksum; // hex string for "--checksum"; empty if not calculated
+	std::string hashInMatch; // hex string of matching checksum for "--hash-in"; empty if none
+	const char* magicType {NULL}; // type detected by magic bytes for "--magic"; NULL if unknown
+};
+
+/**
+ * An entry that is a candidate for the "--top" output.
+ */
+struct TopEntry
+{
+	int64_t rank; // value based on config.topSortKey; higher rank means earlier in output
+	std::string path;
+	struct stat statBuf;
+	EntryContentInfo contentInfo; // e.g. checksum that was calculated by "--hash-in" filter
+};
+
+/**
+ * A dir that is a candidate for the "--report-hotdirs" output.
+ */
+struct HotDirEntry
+{
+	int64_t rank; // wall time or number of entries; higher rank means earlier in output
+	std::string path;
+	uint64_t wallNanoSecs; // time in scan() of this dir, excluding recursive scans of subdirs
+	uint64_t statNanoSecs; // time in stat() calls for entries of this dir
+	uint64_t numEntries; // number of entries in this dir
+};
+
+/**
+ * Log-linear latency histogram in the style of HdrHistogram: Each power of 2 range is split into
+ * 2^SUB_BUCKET_BITS linear sub-buckets, so percentiles have a relative error of about 3% while
+ * the whole uint64_t range fits into a fixed number of buckets.
+ *
+ * Only a single thread may add values, but other threads may read concurrently (e.g. for
+ * "--metrics-file"), hence the relaxed atomics.
+ */
+class LatencyHistogram
+{
+	private:
+		static const unsigned SUB_BUCKET_BITS = 5;
+		static const uint64_t NUM_SUB_BUCKETS = (1ULL << SUB_BUCKET_BITS);
+		static const size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * NUM_SUB_BUCKETS;
+
+		std::vector<std::atomic_uint64_t> bucketCounts =
+			std::vector<std::atomic_uint64_t>(NUM_BUCKETS);
+		std::atomic_uint64_t numValues {0};
+		std::atomic_uint64_t sumValues {0};
+		std::atomic_uint64_t maxValue {0};
+
+		/**
+		 * Add to a counter that no other thread writes to concurrently, so no need for an
+		 * expensive atomic read-modify-write.
+		 */
+		static void addToCounter(std::atomic_uint64_t& counter, uint64_t value)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value,
+				std::memory_order_relaxed);
+		}
+
+		static size_t getBucketIndex(uint64_t value)
+		{
+			if(value < NUM_SUB_BUCKETS)
+				return value; // linear range
+
+			unsigned msbIndex = 63 - __builtin_clzll(value);
+			unsigned shift = msbIndex - SUB_BUCKET_BITS;
+
+			return ( (shift + 1) << SUB_BUCKET_BITS) + ( (value >> shift) & (NUM_SUB_BUCKETS - 1) );
 		}
 
 		/**
-		 * @return false if stack was empty, so outDirPath did not get assigned.
+		 * @return highest value that falls into the given bucket.
 		 */
-		bool pop(std::string& outDirPath, unsigned short& outDirDepth)
+		static uint64_t getBucketMaxValue(size_t bucketIndex)
 		{
-			std::unique_lock<std::mutex> lock(mutex); // L O C K
+			if(bucketIndex < NUM_SUB_BUCKETS)
+				return bucketIndex; // linear range
 
-			if(dirPathStack.empty() )
-				return false;
+			unsigned shift = (bucketIndex >> SUB_BUCKET_BITS) - 1;
+			uint64_t subBucketValue = NUM_SUB_BUCKETS + (bucketIndex & (NUM_SUB_BUCKETS - 1) );
 
-			StackElem& topElem = dirPathStack.top();
-			outDirPath = topElem.dirPath;
-			outDirDepth = topElem.dirDepth;
+			return ( (subBucketValue + 1) << shift) - 1;
+		}
 
-			dirPathStack.pop();
+	public:
+		void add(uint64_t value)
+		{
+			addToCounter(bucketCounts[getBucketIndex(value) ], 1);
+			addToCounter(numValues, 1);
+			addToCounter(sumValues, value);
 
-			stackSize--;
+			if(value > maxValue.load(std::memory_order_relaxed) )
+				maxValue.store(value, std::memory_order_relaxed);
+		}
 
-			return true;
+		/**
+		 * Add values of other histogram to this histogram. (This histogram must not be modified by
+		 * other threads concurrently.)
+		 */
+		void mergeFrom(const LatencyHistogram& other)
+		{
+			for(size_t i=0; i < NUM_BUCKETS; i++)
+				addToCounter(bucketCounts[i],
+					other.bucketCounts[i].load(std::memory_order_relaxed) );
+
+			addToCounter(numValues, other.numValues.load(std::memory_order_relaxed) );
+			addToCounter(sumValues, other.sumValues.load(std::memory_order_relaxed) );
+
+			uint64_t otherMaxValue = other.maxValue.load(std::memory_order_relaxed);
+
+			if(otherMaxValue > maxValue.load(std::memory_order_relaxed) )
+				maxValue.store(otherMaxValue, std::memory_order_relaxed);
+		}
+
+		uint64_t getNumValues() const
+		{
+			return numValues;
+		}
+
+		uint64_t getSumValues() const
+		{
+			return sumValues;
 		}
 
 		/**
-		 * Lock-free getter of current stack size.
+		 * @return number of values that are not greater than the given bound. (Bucket
+		 * 		resolution applies, i.e. a bucket is counted if its max value is not greater than
+		 * 		the bound.)
 		 */
-		uint64_t getSize()
+		uint64_t getNumValuesUpTo(uint64_t bound) const
 		{
-			return stackSize;
+			uint64_t numValuesUpTo = 0;
+
+			for(size_t i=0; (i < NUM_BUCKETS) && (getBucketMaxValue(i) <= bound); i++)
+				numValuesUpTo += bucketCounts[i].load(std::memory_order_relaxed);
+
+			return numValuesUpTo;
 		}
 
-} sharedStack;
+		uint64_t getMaxValue() const
+		{
+			return maxValue;
+		}
 
-/**
- * Check ACL of given file or dir.
- *
- * @path: path to entry for which ACLs should be checked.
- * @isDirectory: true of given entry is a directory.
- */
-void checkACLs(const char* path, bool isDirectory)
-{
-	if(!config.checkACLs)
-		return; // nothing to do
+		/**
+		 * @percentile in range (0, 100].
+		 * @return value (upper bound of bucket) that is not exceeded by the given percentage of
+		 * 		all values.
+		 */
+		uint64_t getPercentileValue(double percentile) const
+		{
+			uint64_t targetCount = std::ceil(numValues * (percentile / 100) );
+			uint64_t currentCount = 0;
 
-	ssize_t getAccessRes = lgetxattr(path, "system.posix_acl_access", NULL, 0);
+			for(size_t i=0; i < NUM_BUCKETS; i++)
+			{
+				currentCount += bucketCounts[i];
 
-	if(getAccessRes >= 0)
-		statistics.numAccessACLsFound++;
-	else
-	if( (errno != ENODATA) && (errno != ENOTSUP) )
-		fprintf(stderr, "Failed to get Access ACL for entry: %s; Error: %s\n",
-			path, strerror(errno) );
+				if(currentCount && (currentCount >= targetCount) )
+					return std::min(getBucketMaxValue(i), maxValue.load() );
+			}
 
-	// dirs have additional default ACL check
-	if(isDirectory)
-	{
-		ssize_t getDefaultRes = lgetxattr(path, "system.posix_acl_default", NULL, 0);
+			return maxValue;
+		}
+};
 
-		if(getDefaultRes >= 0)
-			statistics.numAccessACLsFound++;
-		else
-		if( (errno != ENODATA) && (errno != ENOTSUP) )
-			fprintf(stderr, "Failed to get Default ACL for dir: %s; Error: %s\n",
-				path, strerror(errno) );
-	}
-}
+/**
+ * Counts of a single dir visited by "--estimate".
+ */
+struct EstimateDirSample
+{
+	uint64_t numDirs {0};
+	uint64_t numFiles {0}; // all entries that are not dirs
+	uint64_t numBytes {0}; // sum of st_size of all entries
+	StringVec subdirNames; // subdirs that a full scan would descend into
+};
 
 /**
- * Add escape characters to make a string usable in JSON.
- *
- * @string input string to convert
- * @return copy of input string with escaped
+ * Accumulated probe results of "--estimate". Arrays are indexed by EstimateValue_....
  */
-std::string escapeStrforJSON(const std::string &string)
+struct EstimateResult
 {
-	std::ostringstream stringStream;
+	uint64_t numProbes {0};
+	double sums[EstimateValue_COUNT] {};
+	double sumsOfSquares[EstimateValue_COUNT] {}; // to calculate variance
+};
 
-	for (const auto& currentChar : string)
-	{
-		/* the case statments are the typical shortcut escapes, the "default" statment handles
-			generic escapes */
-		switch (currentChar)
-		{
-			case '"':
-				stringStream << "\\\"";
-			break;
-			case '\\':
-				stringStream << "\\\\";
-			break;
-			case '\b':
-				stringStream << "\\b";
-			break;
-			case '\f':
-				stringStream << "\\f";
-			break;
-			case '\n':
-				stringStream << "\\n";
-			break;
-			case '\r':
-				stringStream << "\\r";
-			break;
-			case '\t':
-				stringStream << "\\t";
-			break;
-
-			default:
-				if('\x00' <= currentChar && currentChar <= '\x1f')
-				{ // escape this character
-					stringStream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
-							<< static_cast<int>(currentChar);
-				}
-				else
-				{ // nothing to escape
-					stringStream << currentChar;
-				}
-		}
-	}
-
-	return stringStream.str();
-}
+/**
+ * Statistics counters of a single thread. Only the owning thread writes, other threads only read
+ * to aggregate. Cache line alignment ensures that counting on the hot path causes no cross-core
+ * traffic.
+ */
+struct alignas(64) StatisticsCounterBlock
+{
+	std::atomic_uint64_t numDirsFound {0};
+	std::atomic_uint64_t numFilesFound {0};
+	std::atomic_uint64_t numUnknownFound {0};
+	std::atomic_uint64_t numFilterMatches {0};
+	std::atomic_uint64_t numStatCalls {0};
+	std::atomic_uint64_t numAccessACLsFound {0};
+	std::atomic_uint64_t numDefaultACLsFound {0};
+	std::atomic_uint64_t numErrors {0}; // e.g. permission errors
+	std::atomic_uint64_t numBytesCopied {0};
+	std::atomic_uint64_t numFilesNotCopied {0}; // num skipped because non-regular file type
+	std::atomic_uint64_t numBytesRead {0}; // file contents read e.g. for checksums
+};
 
 /**
- * Filter printed entries by user-defined entry type.
- *
- * If entry type cannot be determined and a user-defined filter is set then this returns false.
- *
- * @return true if entry passes the filter and should be printed, false otherwise.
+ * A single event for "--trace". Spans have endTime after startTime, instant events have both
+ * times equal.
  */
-bool filterPrintEntryByType(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+struct TraceEvent
 {
-	if(!config.searchType)
-		return true; // no filter defined by user => always passes
+	TraceEventType eventType;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point endTime;
+	std::string path; // dir or file that the event refers to; may be empty
+	uint64_t value; // type-specific, e.g. number of dir entries for TraceEventType_SCAN
+};
 
-	if(dirEntry && (dirEntry->d_type != DT_UNKNOWN) )
-	{
-		char matchType = 0; // values taken from "man find(1)"
+/**
+ * Per-thread ring buffer of events for "--trace". When the buffer is full, the oldest events get
+ * overwritten, so memory usage is bounded independent of scan duration.
+ */
+class TraceRingBuffer
+{
+	private:
+		std::vector<TraceEvent> events; // TRACE_RINGBUF_NUM_EVENTS; lazy alloc
+		uint64_t numEventsAdded {0};
+		uint64_t numSampleCandidates[TraceEventType_COUNT] {}; // indexed by TraceEventType
 
-		switch(dirEntry->d_type)
+	public:
+		/**
+		 * Decide whether the next event of the given type should be recorded based on
+		 * config.traceSampleInterval.
+		 */
+		bool sampleNext(TraceEventType eventType)
 		{
-			case DT_BLK: 	matchType = 'b'; break;
-			case DT_CHR: 	matchType = 'c'; break;
-			case DT_DIR: 	matchType = 'd'; break;
-			case DT_FIFO: 	matchType = 'p'; break;
-			case DT_LNK: 	matchType = 'l'; break;
-			case DT_REG: 	matchType = 'f'; break;
-			case DT_SOCK: 	matchType = 's'; break;
+			return !(numSampleCandidates[eventType]++ % config.traceSampleInterval);
 		}
 
-		if(matchType == config.searchType)
-			return true;
+		void add(TraceEventType eventType, std::chrono::steady_clock::time_point startTime,
+			std::chrono::steady_clock::time_point endTime, const std::string& path,
+			uint64_t value)
+		{
+			if(events.empty() )
+				events.resize(TRACE_RINGBUF_NUM_EVENTS);
 
-		return false;
-	}
+			TraceEvent& event = events[numEventsAdded % events.size()];
 
-	if(statBuf)
-	{
-		char matchType = 0; // values taken from "man find(1)"
+			event.eventType = eventType;
+			event.startTime = startTime;
+			event.endTime = endTime;
+			event.path = path; // (reuses string capacity after wrap-around)
+			event.value = value;
 
-		if(S_ISBLK(statBuf->st_mode) )
-			matchType = 'b';
-		else
-		if(S_ISCHR(statBuf->st_mode) )
-			matchType = 'c';
-		else
-		if(S_ISDIR(statBuf->st_mode) )
-			matchType = 'd';
-		else
-		if(S_ISFIFO(statBuf->st_mode) )
-			matchType = 'p';
-		else
-		if(S_ISLNK(statBuf->st_mode) )
-			matchType = 'l';
-		else
-		if(S_ISREG(statBuf->st_mode) )
-			matchType = 'f';
-		else
-		if(S_ISSOCK(statBuf->st_mode) )
-			matchType = 's';
+			numEventsAdded++;
+		}
 
-		if(matchType == config.searchType)
-			return true;
+		/**
+		 * @return number of events that are currently in the buffer.
+		 */
+		size_t getNumEvents() const
+		{
+			return std::min(numEventsAdded, (uint64_t)events.size() );
+		}
 
-		return false;
-	}
+		/**
+		 * @return number of events that got overwritten because the buffer was full.
+		 */
+		uint64_t getNumDropped() const
+		{
+			return numEventsAdded - getNumEvents();
+		}
 
-	// we have neither d_type nor statBuf and a filter has been definded
-	fprintf(stderr, "Cannot identify type of entry. Path: %s\n", entryPath.c_str() );
+		/**
+		 * @index 0 is the oldest event in the buffer, (getNumEvents() - 1) the newest.
+		 */
+		const TraceEvent& getEvent(size_t index) const
+		{
+			return events[ (getNumDropped() + index) % events.size()];
+		}
+};
 
-	return false;
-}
+/**
+ * Data that each thread collects independently, so that it can be merged at the end of the scan
+ * without any locking in the scan loop.
+ */
+struct ThreadData
+{
+	StatisticsCounterBlock statisticsCounters; // this thread's shard of global statistics
+	BoundedTopHeap<TopEntry> topEntries {config.topNum}; // candidates for "--top" output
+	std::vector<Histogram> histogramVec; // same order as config.histogramConfigVec
+	std::vector<UsageMap> usageMapVec; // same order as config.usageByVec
+	UsageHardlinkMap usageHardlinkMap; // hardlinked files for "--usage-by"
+	DuplicateSizeMap duplicateSizeMap; // candidates for "--duplicates" grouped by file size
+	std::unique_ptr<char[]> fileReadBuf; // FILE_READ_BUF_SIZE buffer for file contents; lazy alloc
+	std::vector<LatencyHistogram> syscallLatencyVec; // indexed by SyscallType; empty if disabled
+	uint64_t threadTimeNanoSecs[ThreadTimeType_COUNT] {}; // indexed by ThreadTimeType
+	uint64_t numBreadthPushes {0}; // dirs pushed to shared stack for other threads
+	uint64_t numDepthRecursions {0}; // dirs scanned directly by recursive scan() call
+	TraceRingBuffer traceRingBuf; // events for "--trace"
+	BoundedTopHeap<HotDirEntry> hotDirsByTime {config.hotDirsNum}; // for "--report-hotdirs"
+	BoundedTopHeap<HotDirEntry> hotDirsByEntries {config.hotDirsNum}; // for "--report-hotdirs"
+};
 
 /**
- * Filter printed files by user-defined filename pattern.
- *
- * If entry type cannot be determined and a user-defined filter is set then this returns false.
- *
- * @return true if entry passes the filter and should be printed, false otherwise.
+ * Statistics of the active thread limit for "--threads auto".
  */
-bool filterPrintEntryByName(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+struct ConcurrencyControlStats
 {
-	if(config.nameFilterVec.empty() )
-		return true; // no filter defined by user => always passes
+	unsigned finalLimit {0};
+	unsigned maxLimit {0};
+	double avgLimit {0}; // time-weighted average
+	uint64_t numIncreases {0};
+	uint64_t numDecreases {0};
+};
 
-	// check whether any of the given filter names matches
+struct State
+{
+	std::chrono::steady_clock::time_point startTime {std::chrono::steady_clock::now()};
+	std::chrono::steady_clock::time_point scanStartTime; // when scan threads got started
+	std::chrono::steady_clock::time_point scanEndTime; // when all scan threads terminated
+	time_t startTimeSecs {time(NULL)}; // reference time to calculate age of entries
 
-	std::string currentFilename = std::filesystem::path(entryPath).filename().string();
+	std::stack<std::thread> scanThreads;
 
-	for(std::string& nameFilter : config.nameFilterVec)
-	{
-		int matchRes = fnmatch(nameFilter.c_str(), currentFilename.c_str(), 0 /* flags */);
+	std::list<ThreadData> threadDataList; // data of all threads that processed entries
+	std::mutex threadDataListMutex; // protects threadDataList
 
-		if(!matchRes)
-			return true; // we have a match
-	}
+	// dirs visited by "--estimate" probes; key is dir path
+	std::unordered_map<std::string, std::shared_ptr<const EstimateDirSample> > estimateDirCache;
+	std::mutex estimateDirCacheMutex; // protects estimateDirCache
 
-	return false;
-}
+	std::atomic_uint64_t numEntriesReserved {0}; // entries that passed the "--max-entries" check
+	std::atomic_uint64_t numMatchesReserved {0}; // match slots taken for "--limit"
+	std::atomic<const char*> scanPartialReason {NULL}; // non-NULL if scan was stopped early
+
+	std::atomic_bool progressSnapshotRequested {false}; // set by SIGUSR1 handler
+
+	ConcurrencyControlStats concurrencyControlStats; // set when concurrency control thread ends
+
+	bool scanThreadsDone {false}; // true after all scan threads terminated
+	std::mutex scanThreadsDoneMutex; // protects scanThreadsDone
+	std::condition_variable scanThreadsDoneCondition; // when scanThreadsDone gets set
+} state;
+
+thread_local ThreadData* threadDataPtr = NULL; // this thread's elem in state.threadDataList
 
 /**
- * Filter printed files by user-defined path pattern.
- *
- * If entry type cannot be determined and a user-defined filter is set then this returns false.
- *
- * @return true if entry passes the filter and should be printed, false otherwise.
+ * Get data of the calling thread. The data gets allocated on first call by the calling thread.
  */
-bool filterPrintEntryByPath(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+ThreadData& getThreadData()
 {
-	if(config.pathFilter.empty() )
-		return true; // no filter defined by user => always passes
-
-	bool isFile =
-		(dirEntry && (dirEntry->d_type != DT_UNKNOWN) && (dirEntry->d_type != DT_DIR) ) ||
-		(statBuf && !S_ISDIR(statBuf->st_mode) );
+	if(threadDataPtr)
+		return *threadDataPtr;
 
-	if(!isFile)
-		return false; // anything that's not a file can't match
+	std::unique_lock<std::mutex> lock(state.threadDataListMutex); // L O C K
 
-	int matchRes = fnmatch(config.pathFilter.c_str(), entryPath.c_str(), 0 /* flags */);
+	threadDataPtr = &state.threadDataList.emplace_back();
 
-	if(!matchRes)
-		return true; // we have a match
+	// (allocated here instead of on first use, because other threads may read them concurrently)
+	if(config.recordSyscallLatency)
+		threadDataPtr->syscallLatencyVec = std::vector<LatencyHistogram>(SyscallType_COUNT);
 
-	return false;
+	return *threadDataPtr;
 }
 
 /**
- * Check for size or timestamp exact/less/greater match.
- * This returns false if a filter is defined that doesn't match. Otherwise it will run through
- * without calling "return".
- * Note that there can be more than one filter defined, so this can't return true on first match.
- * Example: CHECK_EXACT_LESS_GREATER_VAL(atime, ATIME, atim.tv_sec)
+ * A statistics counter that is sharded into the StatisticsCounterBlock of each thread: Increments
+ * only touch the calling thread's block, reads sum up the blocks of all threads.
  */
-#define _CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField) \
-		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _EXACT) \
-			if( (uint64_t)statBuf->st_ ## statBufField != config.filterSizeAndTime.lowercaseCfgName ## Exact) \
-				return false; \
-		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _LESS) \
-			if( (uint64_t)statBuf->st_ ## statBufField >= config.filterSizeAndTime.lowercaseCfgName ## Less) \
-				return false; \
-		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _GREATER) \
-			if( (uint64_t)statBuf->st_ ## statBufField <= config.filterSizeAndTime.lowercaseCfgName ## Greater) \
-				return false;
-#define CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField) \
-		_CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField)
+class StatisticsCounter
+{
+	public:
+		typedef std::atomic_uint64_t StatisticsCounterBlock::*CounterMember;
 
+		StatisticsCounter(CounterMember counterMember) : counterMember(counterMember) {}
 
-/**
- * Filter printed files by user-defined size or timestamp.
- *
- * This requires stat() info.
- *
- * If entry type cannot be determined and a user-defined filter is set then this returns false.
- *
- * @return true if entry passes the filter and should be printed, false otherwise.
- */
-bool filterPrintEntryBySizeOrTime(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
-{
-	if(!config.filterSizeAndTime.filterSizeAndTimeFlags)
-		return true; // no filter defined by user => always passes
+	private:
+		CounterMember counterMember; // counter within StatisticsCounterBlock
 
-	bool isFile =
-		(dirEntry && (dirEntry->d_type != DT_UNKNOWN) && (dirEntry->d_type != DT_DIR) ) ||
-		(statBuf && !S_ISDIR(statBuf->st_mode) );
+	public:
+		void operator+=(uint64_t value)
+		{
+			std::atomic_uint64_t& counter = getThreadData().statisticsCounters.*counterMember;
 
-	if(!isFile)
-		return false; // anything that's not a file can't match
+			// only this thread writes, so no need for an expensive atomic read-modify-write
+			counter.store(counter.load(std::memory_order_relaxed) + value,
+				std::memory_order_relaxed);
+		}
 
-	if(!statBuf)
-		return false; // can't filter without stat() info
+		void operator++(int)
+		{
+			*this += 1;
+		}
 
-	// the macro will return false if a defined filter doesn't match, otherwise it runs through.
-	CHECK_EXACT_LESS_GREATER_VAL(size, SIZE, size);
-	CHECK_EXACT_LESS_GREATER_VAL(atime, ATIME, atim.tv_sec);
-	CHECK_EXACT_LESS_GREATER_VAL(ctime, CTIME, ctim.tv_sec);
-	CHECK_EXACT_LESS_GREATER_VAL(mtime, MTIME, mtim.tv_sec);
+		/**
+		 * Aggregate counter over all threads.
+		 */
+		operator uint64_t() const
+		{
+			std::unique_lock<std::mutex> lock(state.threadDataListMutex); // L O C K
 
-	return true; // all filters passed
-}
+			uint64_t sum = 0;
+
+			for(const ThreadData& threadData : state.threadDataList)
+				sum += (threadData.statisticsCounters.*counterMember).load(
+					std::memory_order_relaxed);
+
+			return sum;
+		}
+};
 
 /**
- * Filter printed files by user-defined UID and GID.
- *
- * This requires stat() info.
- *
- * @return true if entry passes the filter and should be printed, false otherwise.
+ * Get the calling thread's buffer of FILE_READ_BUF_SIZE for reading file contents. The buffer gets
+ * allocated on first call by the calling thread and is reused afterwards.
  */
-bool filterPrintEntryByUIDAndGID(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+char* getThreadFileReadBuf()
 {
-	// filter UID
-	if(config.filterUID != ~0ULL)
-	{
-		if(!statBuf || (statBuf->st_uid != config.filterUID) )
-			return false; // either no statBuf or UID mismatch
-	}
+	ThreadData& threadData = getThreadData();
 
-	// filter GID
-	if(config.filterGID != ~0ULL)
-	{
-		if(!statBuf || (statBuf->st_gid != config.filterGID) )
-			return false; // either no statBuf or GID mismatch
-	}
+	if(!threadData.fileReadBuf)
+		threadData.fileReadBuf.reset(new char[FILE_READ_BUF_SIZE] );
 
-	return true;
+	return threadData.fileReadBuf.get();
 }
 
-
 /**
- * Replace all occurrences of EXEC_ARG_PATH_PLACEHOLDER in "subject" string with the given "path"
- * string.
+ * Measure the latency of a single filesystem call for "--latency" and add it to the calling
+ * thread's histogram of the given type. Does nothing if "--latency" is not given. Usage: Create
+ * timer right before the call and call stop() right after it.
  */
-void replacePathPlaceholerWithPath(std::string& subject, const std::string& path)
+class SyscallTimer
 {
-    size_t pos = 0;
+	public:
+		SyscallTimer(SyscallType syscallType) : syscallType(syscallType)
+		{
+			if(config.recordSyscallLatency)
+				startTime = std::chrono::steady_clock::now();
+		}
 
-    while( (pos = subject.find(EXEC_ARG_PATH_PLACEHOLDER, pos) ) != std::string::npos)
-    {
-         subject.replace(pos, strlen(EXEC_ARG_PATH_PLACEHOLDER), path);
-         pos += path.length();
-    }
-}
+	private:
+		SyscallType syscallType;
+		std::chrono::steady_clock::time_point startTime;
+
+	public:
+		void stop()
+		{
+			if(!config.recordSyscallLatency)
+				return;
+
+			std::chrono::nanoseconds latencyNanoSec = std::chrono::steady_clock::now() - startTime;
+
+			int errnoBackup = errno; // callers check errno of the measured call after stop()
+
+			getThreadData().syscallLatencyVec[syscallType].add(latencyNanoSec.count() );
+
+			errno = errnoBackup;
+		}
+};
 
 /**
- * Execute user-given system command for discovered entry.
+ * Measure time of the calling thread for "--verbose" thread utilization stats and add it to the
+ * given type in the thread's data. Measurement ends with stop() or when the timer goes out of
+ * scope. Does nothing if thread times are not measured.
  */
-void execSystemCommand(const std::string& entryPath)
+class ThreadTimeTimer
 {
-	if(config.exec.cmdLineStrVec.empty() )
-		return; // nothing to do
+	public:
+		ThreadTimeTimer(ThreadTimeType threadTimeType) : threadTimeType(threadTimeType)
+		{
+			if(config.measureThreadTimes)
+				startTime = std::chrono::steady_clock::now();
+		}
 
-	std::string commandStr;
+		~ThreadTimeTimer()
+		{
+			stop();
+		}
 
-	// add executable
-	commandStr.append("'");
-	commandStr.append(config.exec.cmdLineStrVec[0] );
-	commandStr.append("' ");
+	private:
+		ThreadTimeType threadTimeType;
+		std::chrono::steady_clock::time_point startTime;
+		bool isStopped {false};
 
-	// add args and replace placeholder with path
-	for(size_t i=1; i < config.exec.cmdLineStrVec.size(); i++)
-	{
-		std::string argStr(config.exec.cmdLineStrVec[i] );
+	public:
+		void stop()
+		{
+			if(!config.measureThreadTimes || isStopped)
+				return;
 
-		replacePathPlaceholerWithPath(argStr, entryPath);
+			isStopped = true;
 
-		commandStr.append("'");
-		commandStr.append(argStr);
-		commandStr.append("' ");
-	}
+			std::chrono::nanoseconds elapsedNanoSec = std::chrono::steady_clock::now() - startTime;
 
-	// flush is necessary for cases where stdout is not line-buffered, e.g. because it's not a tty.
-	fflush(stdout);
+			getThreadData().threadTimeNanoSecs[threadTimeType] += elapsedNanoSec.count();
+		}
+};
 
-	int sysRes = std::system(commandStr.c_str() );
-	if(WIFSIGNALED(sysRes) )
-	{
-		fprintf(stderr, "Aborting because exec command terminated on signal. "
-			"Signal: %d; Path: %s\n", (int)WTERMSIG(sysRes), entryPath.c_str() );
+/**
+ * Record a span event of the calling thread for "--trace". The span ends with stop() or when the
+ * object goes out of scope. Does nothing if "--trace" is not given or if this event is not
+ * selected by sampling.
+ */
+class TraceSpan
+{
+	public:
+		/**
+		 * @path must remain valid until the span ends; may be modified in the meantime.
+		 */
+		TraceSpan(TraceEventType eventType, const std::string& path) :
+			eventType(eventType), path(path)
+		{
+			if(config.traceFilePath.empty() )
+				return;
 
-		// note: we really need SIGTERM here, as SIGINT does not reliably kill running system cmds
-		kill(0, SIGTERM);
-	}
-}
+			isSampled = getThreadData().traceRingBuf.sampleNext(eventType);
+
+			if(isSampled)
+				startTime = std::chrono::steady_clock::now();
+		}
+
+		~TraceSpan()
+		{
+			stop();
+		}
+
+	private:
+		TraceEventType eventType;
+		const std::string& path;
+		std::chrono::steady_clock::time_point startTime;
+		bool isSampled {false};
+		uint64_t value {0};
+
+	public:
+		void stop()
+		{
+			if(!isSampled)
+				return;
+
+			isSampled = false;
+
+			getThreadData().traceRingBuf.add(eventType, startTime,
+				std::chrono::steady_clock::now(), path, value);
+		}
+
+		void addToValue(uint64_t addValue)
+		{
+			value += addValue;
+		}
+};
 
 /**
- * Copy entry if it's a regular file, dir or symlink; skip others.
- * This won't preserve hardlinks.
+ * Record an instant event of the calling thread for "--trace". Does nothing if "--trace" is not
+ * given or if this event is not selected by sampling.
  */
-void copyEntry(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+void traceInstantEvent(TraceEventType eventType, const std::string& path, uint64_t value)
 {
-	if(config.copyDestDir.empty() )
+	if(config.traceFilePath.empty() )
 		return;
 
-	std::string relativeEntryPath = entryPath.substr(config.scanPaths.front().length() );
-	std::string destPath = config.copyDestDir + "/" + relativeEntryPath;
+	ThreadData& threadData = getThreadData();
 
-	if(config.printVerbose)
-		fprintf(stderr, "Copying: %s -> %s\n", entryPath.c_str(), destPath.c_str() );
+	if(!threadData.traceRingBuf.sampleNext(eventType) )
+		return;
 
-	// config.statAll is forced to true when config.copyDestDir is set
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
 
-	if(S_ISDIR(statBuf->st_mode) )
-	{ // create directory
-		int mkRes = mkdir(destPath.c_str(),
-				(statBuf->st_mode & 0777) | ( S_IRUSR | S_IWUSR | S_IXUSR) ); // user always rwx
-		if( (mkRes == -1) && (errno != EEXIST) )
+	threadData.traceRingBuf.add(eventType, now, now, path, value);
+}
+
+/**
+ * Measure wall time, stat time and number of entries of a single dir in scan() for
+ * "--report-hotdirs". The dir gets added to the calling thread's top dirs when the object goes out
+ * of scope. Does nothing if "--report-hotdirs" is not given.
+ */
+class HotDirRecorder
+{
+	public:
+		/**
+		 * @path must remain valid until the object goes out of scope.
+		 */
+		HotDirRecorder(const std::string& path) : path(path)
 		{
-			fprintf(stderr, "Failed to create dir: %s; Error: %s\n",
-				destPath.c_str(), strerror(errno) );
+			if(config.hotDirsNum)
+				startTime = std::chrono::steady_clock::now();
+		}
 
-			statistics.numErrors++;
+		~HotDirRecorder()
+		{
+			if(!config.hotDirsNum)
+				return;
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
-		}
+			std::chrono::nanoseconds elapsedNanoSec = std::chrono::steady_clock::now() - startTime;
 
-		if(config.copyTimeUpdate)
-		{ // update timestamps
-			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+			uint64_t wallNanoSecs = elapsedNanoSec.count() - subdirNanoSecs;
 
-			int updateTimeRes = utimensat(AT_FDCWD, destPath.c_str(), newTimes, 0);
-			if(updateTimeRes == -1)
-			{
-				fprintf(stderr, "Failed to update timestamps of copy destination dir: %s; "
-					"Error: %s\n", destPath.c_str(), strerror(errno) );
+			ThreadData& threadData = getThreadData();
 
-				statistics.numErrors++;
-			}
+			// check before constructing the elem to avoid path string copy for the common case
+
+			if(threadData.hotDirsByTime.isCandidate(wallNanoSecs) )
+				threadData.hotDirsByTime.push(HotDirEntry{ (int64_t)wallNanoSecs, path,
+					wallNanoSecs, statNanoSecs, numEntries} );
+
+			if(threadData.hotDirsByEntries.isCandidate(numEntries) )
+				threadData.hotDirsByEntries.push(HotDirEntry{ (int64_t)numEntries, path,
+					wallNanoSecs, statNanoSecs, numEntries} );
 		}
-	}
-	else
-	if(S_ISLNK(statBuf->st_mode) )
-	{ // copy symlink
-		const unsigned bufSize = 16*1024; // 16KiB copy buffer
-		char* buf = (char*)malloc(bufSize);
 
-		if(!buf)
+	private:
+		const std::string& path;
+		std::chrono::steady_clock::time_point startTime;
+		std::chrono::steady_clock::time_point intervalStartTime; // of current stat or subdir scan
+		uint64_t statNanoSecs {0};
+		uint64_t subdirNanoSecs {0}; // recursive scans of subdirs, excluded from wall time
+		uint64_t numEntries {0};
+
+		uint64_t getIntervalNanoSecs() const
 		{
-			fprintf(stderr, "Failed to allocate memory buffer for symlink copy. Alloc size: %u\n",
-				bufSize);
+			std::chrono::nanoseconds elapsedNanoSec =
+				std::chrono::steady_clock::now() - intervalStartTime;
 
-			exit(EXIT_FAILURE);
+			return elapsedNanoSec.count();
 		}
 
-		ssize_t readRes = readlink(entryPath.c_str(), buf, bufSize);
-		if(readRes == bufSize)
+	public:
+		void addEntry()
 		{
-			fprintf(stderr, "Failed to copy symlink due to long target path: %s; Max: %u\n",
-				entryPath.c_str(), bufSize);
-
-			statistics.numErrors++;
-			free(buf);
+			numEntries++;
+		}
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		void startStat()
+		{
+			if(config.hotDirsNum)
+				intervalStartTime = std::chrono::steady_clock::now();
 		}
-		else
-		if(readRes == -1)
+
+		void stopStat()
 		{
-			fprintf(stderr, "Failed to read symlink for copying: %s; Error: %s\n",
-				entryPath.c_str(), strerror(errno) );
+			if(config.hotDirsNum)
+				statNanoSecs += getIntervalNanoSecs();
+		}
 
-			statistics.numErrors++;
-			free(buf);
+		void startSubdirScan()
+		{
+			if(config.hotDirsNum)
+				intervalStartTime = std::chrono::steady_clock::now();
+		}
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		void stopSubdirScan()
+		{
+			if(config.hotDirsNum)
+				subdirNanoSecs += getIntervalNanoSecs();
 		}
+};
 
-		// readlink() does not zero-terminate the string in buf
-		buf[readRes] = 0;
+/**
+ * Lower the I/O and CPU priority of the calling thread for "--background": Idle I/O class, so that
+ * the I/O scheduler only serves this thread when the disk is otherwise idle; and SCHED_IDLE or max
+ * nice value if that is not allowed. Priorities are inherited by child processes of "--exec".
+ *
+ * This needs to be called by all threads that access the filesystem, i.e. scan threads and
+ * also the workers of runParallelJobs() and "--estimate" probes.
+ */
+void setBackgroundPriority()
+{
+	// print each warning only once, not per thread
+	static std::atomic_bool ioWarningPrinted {false};
+	static std::atomic_bool cpuWarningPrinted {false};
 
-		int linkRes = symlink(buf, destPath.c_str() );
-		if( (linkRes == -1) && (errno == EEXIST) )
-		{ // symlink() can't overwrite existing file, so unlink and try again
-			unlink(destPath.c_str() );
+	if(syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) &&
+		!ioWarningPrinted.exchange(true) )
+		fprintf(stderr, "WARNING: Failed to set idle I/O priority; Error: %s\n",
+			strerror(errno) );
 
-			linkRes = symlink(buf, destPath.c_str() );
-		}
+	struct sched_param schedParam;
+	memset(&schedParam, 0, sizeof(schedParam) );
 
-		if(linkRes == -1)
-		{
-			fprintf(stderr, "Failed to create symlink for copying: %s; Error: %s\n",
-				destPath.c_str(), strerror(errno) );
+	if(!sched_setscheduler(0, SCHED_IDLE, &schedParam) )
+		return;
 
-			statistics.numErrors++;
-			free(buf);
+	// (on linux, PRIO_PROCESS with a thread ID only applies to this thread)
+	if(setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19) && !cpuWarningPrinted.exchange(true) )
+		fprintf(stderr, "WARNING: Failed to set idle CPU priority; Error: %s\n",
+			strerror(errno) );
+}
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+/**
+ * Worker threads for runParallelJobs(), e.g. for the stages of "--duplicates". The threads get
+ * started on first use and are reused for all following calls, so that each worker allocates its
+ * ThreadData (incl. file read buffer) only once.
+ */
+class ParallelJobsPool
+{
+	public:
+		~ParallelJobsPool()
+		{
+			stop();
 		}
 
-		if(config.copyTimeUpdate)
-		{ // update timestamps
-			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+	private:
+		std::vector<std::thread> workerThreads;
+		std::mutex mutex; // protects all members below
+		std::condition_variable jobsCondition; // when new jobs were given or stop was requested
+		std::condition_variable jobsDoneCondition; // when numBusyWorkers reached 0
+		std::function<void(size_t jobIndex)> jobFunc;
+		size_t numJobs {0};
+		std::atomic_size_t nextJobIndex {0};
+		uint64_t jobsGeneration {0}; // incremented for each run() to wake up the workers
+		unsigned numBusyWorkers {0}; // workers that didn't finish the current jobs yet
+		bool stopRequested {false};
+
+		void workerLoop()
+		{
+			uint64_t lastJobsGeneration = 0;
 
-			int updateTimeRes = utimensat(AT_FDCWD, destPath.c_str(), newTimes, AT_SYMLINK_NOFOLLOW);
-			if(updateTimeRes == -1)
+			if(config.background)
+				setBackgroundPriority();
+
+			for( ; ; )
 			{
-				fprintf(stderr, "Failed to update timestamps of copy destination symlink: %s; "
-					"Error: %s\n", destPath.c_str(), strerror(errno) );
+				{
+					std::unique_lock<std::mutex> lock(mutex); // L O C K
 
-				statistics.numErrors++;
-			}
-		}
+					jobsCondition.wait(lock, [&]()
+						{ return stopRequested || (jobsGeneration != lastJobsGeneration); } );
 
-		// symlink copy done => cleanup
-		free(buf);
-	}
-	else
-	if(S_ISREG(statBuf->st_mode) )
-	{ // copy regular file
-		// (no atime update simiar to "cp -a" behavior)
-		int sourceFD = open(entryPath.c_str(), O_RDONLY | O_NOATIME);
-		if(sourceFD == -1)
-		{
-			fprintf(stderr, "Failed to open copy source file for reading: %s; Error: %s\n",
-				entryPath.c_str(), strerror(errno) );
+					if(stopRequested)
+						return;
 
-			statistics.numErrors++;
+					lastJobsGeneration = jobsGeneration;
+				}
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+				for(size_t jobIndex = nextJobIndex++; jobIndex < numJobs;
+					jobIndex = nextJobIndex++)
+					jobFunc(jobIndex);
+
+				std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+				if(!--numBusyWorkers)
+					jobsDoneCondition.notify_all();
+			}
 		}
 
-		int destFD = open(destPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY,
-			(statBuf->st_mode & 0777) | ( S_IRUSR | S_IWUSR) ); // user/owner can always read+write
-		if(destFD == -1)
+	public:
+		/**
+		 * Run the given function for each job index in the range [0, numJobs) on the worker
+		 * threads and wait for completion.
+		 *
+		 * @numThreads number of worker threads to start on first call.
+		 */
+		void run(size_t numJobs, std::function<void(size_t jobIndex)> jobFunc,
+			unsigned numThreads)
 		{
-			fprintf(stderr, "Failed to open copy destination file for writing: %s; Error: %s\n",
-				destPath.c_str(), strerror(errno) );
+			if(!numJobs)
+				return; // nothing to do
 
-			statistics.numErrors++;
-			close(sourceFD);
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
 
-			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
-		}
+			for(unsigned i = workerThreads.size(); i < numThreads; i++)
+				workerThreads.push_back(std::thread(&ParallelJobsPool::workerLoop, this) );
 
-		const unsigned bufSize = 4*1024*1024; // 4MiB copy buffer
-		char* buf = (char*)malloc(bufSize);
-		ssize_t readRes;
+			this->jobFunc = jobFunc;
+			this->numJobs = numJobs;
+			nextJobIndex = 0;
+			numBusyWorkers = workerThreads.size();
+			jobsGeneration++;
 
-		if(!buf)
-		{
-			fprintf(stderr, "Failed to allocate memory buffer for file copy. Alloc size: %u\n",
-				bufSize);
+			jobsCondition.notify_all();
 
-			exit(EXIT_FAILURE);
+			jobsDoneCondition.wait(lock, [&]() { return !numBusyWorkers; } );
 		}
 
-		// copy file contents
-		for( ; ; )
+		/**
+		 * Stop and join the worker threads.
+		 */
+		void stop()
 		{
-			readRes = read(sourceFD, buf, bufSize);
-			if(!readRes)
-				break;
-			else
-			if(readRes == -1)
 			{
-				fprintf(stderr, "Failed to read from copy source file: %s; Error: %s\n",
-					entryPath.c_str(), strerror(errno) );
-
-				statistics.numErrors++;
-				close(sourceFD);
-				close(destFD);
-				free(buf);
-
-				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+				std::unique_lock<std::mutex> lock(mutex); // L O C K
+				stopRequested = true;
 			}
 
-			ssize_t writeRes = write(destFD, buf, readRes);
-			if(writeRes == -1)
+			jobsCondition.notify_all();
+
+			for(std::thread& workerThread : workerThreads)
 			{
-				fprintf(stderr, "Failed to write to copy destination file: %s; Error: %s\n",
-					destPath.c_str(), strerror(errno) );
+				if(workerThread.get_id() == std::this_thread::get_id() )
+					workerThread.detach(); // e.g. exit() called by a job
+				else
+					workerThread.join();
+			}
 
-				statistics.numErrors++;
-				close(sourceFD);
-				close(destFD);
-				free(buf);
+			workerThreads.clear();
+		}
+} parallelJobsPool;
 
-				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
-			}
+/**
+ * Get the initial active scan threads limit for "--threads auto".
+ */
+unsigned getAutoThreadsStartLimit()
+{
+	return std::min(config.autoThreadsMax,
+		std::max(config.autoThreadsMin, (unsigned)AUTO_THREADS_START) );
+}
+
+/**
+ * Get the number of threads for work outside of the scan threads, e.g. "--duplicates" stages and
+ * "--estimate" probes. The concurrency controller doesn't run for these and config.numThreads is
+ * only the upper bound with "--threads auto", so the final limit of the controller is used or the
+ * initial limit if the controller didn't run.
+ */
+unsigned getNumWorkerThreads()
+{
+	if(state.concurrencyControlStats.finalLimit)
+		return state.concurrencyControlStats.finalLimit;
+
+	return config.autoThreads ? getAutoThreadsStartLimit() : config.numThreads;
+}
+
+/**
+ * Run the given function for each job index in the range [0, numJobs) on getNumWorkerThreads()
+ * parallel worker threads and wait for completion.
+ */
+void runParallelJobs(size_t numJobs, std::function<void(size_t jobIndex)> jobFunc)
+{
+	parallelJobsPool.run(numJobs, jobFunc, getNumWorkerThreads() );
+}
+
+/**
+ * Streaming implementation of the xxHash XXH64 algorithm, a fast non-cryptographic hash.
+ * (See https://github.com/Cyan4973/xxHash for the specification.)
+ */
+class Xxh64Hasher
+{
+	private:
+		static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+		static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+		static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+		static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+		static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+	public:
+		Xxh64Hasher(uint64_t seed = 0) :
+			accs{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1}, seed(seed) {}
+
+	private:
+		uint64_t accs[4]; // accumulators for the 4 stripe lanes
+		uint64_t seed;
+		uint64_t totalLen {0}; // number of bytes given to update() so far
+		unsigned char stripeBuf[32]; // buffered bytes that didn't fill a full stripe yet
+		size_t stripeBufLen {0}; // number of used bytes in stripeBuf
+
+		static uint64_t rotl(uint64_t value, unsigned numBits)
+		{
+			return (value << numBits) | (value >> (64 - numBits) );
+		}
+
+		static uint64_t read64(const unsigned char* buf)
+		{
+			uint64_t value;
+			memcpy(&value, buf, sizeof(value) ); // (memcpy for unaligned access)
+			return value;
+		}
+
+		static uint32_t read32(const unsigned char* buf)
+		{
+			uint32_t value;
+			memcpy(&value, buf, sizeof(value) ); // (memcpy for unaligned access)
+			return value;
+		}
+
+		static uint64_t round(uint64_t acc, uint64_t input)
+		{
+			acc += input * PRIME2;
+			acc = rotl(acc, 31);
+			return acc * PRIME1;
+		}
+
+		static uint64_t mergeRound(uint64_t acc, uint64_t value)
+		{
+			acc ^= round(0, value);
+			return acc * PRIME1 + PRIME4;
+		}
+
+		void consumeStripe(const unsigned char* stripe)
+		{
+			for(unsigned i=0; i < 4; i++)
+				accs[i] = round(accs[i], read64(stripe + (i * 8) ) );
+		}
+
+	public:
+		void update(const void* data, size_t len)
+		{
+			const unsigned char* dataPos = (const unsigned char*)data;
+			const unsigned char* const dataEnd = dataPos + len;
+
+			totalLen += len;
+
+			if(stripeBufLen)
+			{ // fill up previously buffered partial stripe
+				size_t copyLen = std::min(len, sizeof(stripeBuf) - stripeBufLen);
+
+				memcpy(stripeBuf + stripeBufLen, dataPos, copyLen);
+				stripeBufLen += copyLen;
+				dataPos += copyLen;
+
+				if(stripeBufLen < sizeof(stripeBuf) )
+					return; // still not a full stripe
+
+				consumeStripe(stripeBuf);
+				stripeBufLen = 0;
+			}
+
+			for( ; (dataEnd - dataPos) >= (ssize_t)sizeof(stripeBuf); dataPos += sizeof(stripeBuf) )
+				consumeStripe(dataPos);
+
+			// buffer remainder for next update() or digest()
+			memcpy(stripeBuf, dataPos, dataEnd - dataPos);
+			stripeBufLen = dataEnd - dataPos;
+		}
+
+		uint64_t digest() const
+		{
+			uint64_t hash;
+
+			if(totalLen >= sizeof(stripeBuf) )
+			{
+				hash = rotl(accs[0], 1) + rotl(accs[1], 7) + rotl(accs[2], 12) + rotl(accs[3], 18);
+
+				for(unsigned i=0; i < 4; i++)
+					hash = mergeRound(hash, accs[i] );
+			}
 			else
-			if(readRes != writeRes)
+				hash = seed + PRIME5;
+
+			hash += totalLen;
+
+			// process remaining buffered bytes
+
+			const unsigned char* bufPos = stripeBuf;
+			const unsigned char* const bufEnd = stripeBuf + stripeBufLen;
+
+			for( ; (bufEnd - bufPos) >= 8; bufPos += 8)
 			{
-				fprintf(stderr, "Failed to write to copy destination file: %s; "
-					"Expected write size: %zd; Actual write size: %zd\n",
-					destPath.c_str(), readRes, writeRes);
+				hash ^= round(0, read64(bufPos) );
+				hash = rotl(hash, 27) * PRIME1 + PRIME4;
+			}
 
-				statistics.numErrors++;
-				close(sourceFD);
-				close(destFD);
-				free(buf);
+			if( (bufEnd - bufPos) >= 4)
+			{
+				hash ^= (uint64_t)read32(bufPos) * PRIME1;
+				hash = rotl(hash, 23) * PRIME2 + PRIME3;
+				bufPos += 4;
+			}
 
-				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+			for( ; bufPos < bufEnd; bufPos++)
+			{
+				hash ^= (*bufPos) * PRIME5;
+				hash = rotl(hash, 11) * PRIME1;
 			}
 
-			statistics.numBytesCopied += writeRes;
+			// final avalanche
+			hash ^= hash >> 33;
+			hash *= PRIME2;
+			hash ^= hash >> 29;
+			hash *= PRIME3;
+			hash ^= hash >> 32;
+
+			return hash;
+		}
+};
+
+/**
+ * Get hex string of the given binary data.
+ */
+std::string binaryToHexStr(const unsigned char* data, size_t len)
+{
+	static const char hexChars[] = "0123456789abcdef";
+
+	std::string hexStr(len * 2, '0');
+
+	for(size_t i=0; i < len; i++)
+	{
+		hexStr[i * 2] = hexChars[data[i] >> 4];
+		hexStr[(i * 2) + 1] = hexChars[data[i] & 0xF];
+	}
+
+	return hexStr;
+}
+
+/**
+ * Streaming implementation of the xxHash XXH3 64-bit algorithm with seed 0 and the default
+ * secret. (See https://github.com/Cyan4973/xxHash for the specification.)
+ */
+class Xxh3Hasher
+{
+	private:
+		static const uint32_t PRIME32_1 = 0x9E3779B1U;
+		static const uint32_t PRIME32_2 = 0x85EBCA77U;
+		static const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+		static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+		static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+		static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+		static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+		static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+		static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+		static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+		static const size_t STRIPE_LEN = 64;
+		static const size_t SECRET_SIZE = 192;
+		static const size_t SECRET_CONSUME_RATE = 8; // secret offset advance per stripe
+		static const size_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+		static const size_t MIDSIZE_MAX = 240; // longer inputs use the stripe accumulators
+		static const size_t BUF_SIZE = 256; // internal buffer for streaming
+		static const size_t BUF_STRIPES = BUF_SIZE / STRIPE_LEN;
+
+		static const unsigned char secret[SECRET_SIZE];
+
+	private:
+		uint64_t accs[8] {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+			PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+		unsigned char buf[BUF_SIZE];
+		size_t bufLen {0}; // number of used bytes in buf
+		size_t numStripesInBlock {0}; // number of stripes consumed in current block
+		uint64_t totalLen {0}; // number of bytes given to update() so far
+
+		static uint64_t read64(const unsigned char* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value) ); // (memcpy for unaligned access)
+			return value;
+		}
+
+		static uint32_t read32(const unsigned char* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value) ); // (memcpy for unaligned access)
+			return value;
+		}
+
+		static uint64_t rotl(uint64_t value, unsigned numBits)
+		{
+			return (value << numBits) | (value >> (64 - numBits) );
+		}
+
+		static uint64_t mul128Fold64(uint64_t a, uint64_t b)
+		{
+			unsigned __int128 product = (unsigned __int128)a * b;
+			return (uint64_t)product ^ (uint64_t)(product >> 64);
+		}
+
+		static uint64_t xxh64Avalanche(uint64_t hash)
+		{
+			hash ^= hash >> 33;
+			hash *= PRIME64_2;
+			hash ^= hash >> 29;
+			hash *= PRIME64_3;
+			return hash ^ (hash >> 32);
+		}
+
+		static uint64_t avalanche(uint64_t hash)
+		{
+			hash ^= hash >> 37;
+			hash *= PRIME_MX1;
+			return hash ^ (hash >> 32);
+		}
+
+		static uint64_t rrmxmx(uint64_t hash, uint64_t len)
+		{
+			hash ^= rotl(hash, 49) ^ rotl(hash, 24);
+			hash *= PRIME_MX2;
+			hash ^= (hash >> 35) + len;
+			hash *= PRIME_MX2;
+			return hash ^ (hash >> 28);
+		}
+
+		static uint64_t mix16B(const unsigned char* data, const unsigned char* secretPos)
+		{
+			return mul128Fold64(read64(data) ^ read64(secretPos),
+				read64(data + 8) ^ read64(secretPos + 8) );
+		}
+
+		static void accumulateStripe(uint64_t* accs, const unsigned char* stripe,
+			const unsigned char* secretPos)
+		{
+			for(unsigned i=0; i < 8; i++)
+			{
+				uint64_t dataVal = read64(stripe + (i * 8) );
+				uint64_t dataKey = dataVal ^ read64(secretPos + (i * 8) );
+
+				accs[i ^ 1] += dataVal;
+				accs[i] += (dataKey & 0xFFFFFFFF) * (dataKey >> 32);
+			}
+		}
+
+		static void scrambleAccs(uint64_t* accs)
+		{
+			const unsigned char* secretPos = secret + SECRET_SIZE - STRIPE_LEN;
+
+			for(unsigned i=0; i < 8; i++)
+			{
+				uint64_t acc = accs[i];
+				acc ^= acc >> 47;
+				acc ^= read64(secretPos + (i * 8) );
+				accs[i] = acc * PRIME32_1;
+			}
+		}
+
+		/**
+		 * Accumulate the given number of stripes and scramble at the end of each block.
+		 */
+		static void consumeStripes(uint64_t* accs, size_t& numStripesInBlock,
+			const unsigned char* data, size_t numStripes)
+		{
+			for( ; numStripes; numStripes--, data += STRIPE_LEN)
+			{
+				accumulateStripe(accs, data, secret + (numStripesInBlock * SECRET_CONSUME_RATE) );
+
+				if(++numStripesInBlock == STRIPES_PER_BLOCK)
+				{
+					scrambleAccs(accs);
+					numStripesInBlock = 0;
+				}
+			}
+		}
+
+		static uint64_t mergeAccs(const uint64_t* accs, uint64_t len)
+		{
+			const unsigned char* secretPos = secret + 11;
+			uint64_t hash = len * PRIME64_1;
+
+			for(unsigned i=0; i < 4; i++)
+				hash += mul128Fold64(accs[i * 2] ^ read64(secretPos + (i * 16) ),
+					accs[(i * 2) + 1] ^ read64(secretPos + (i * 16) + 8) );
+
+			return avalanche(hash);
+		}
+
+		/**
+		 * Hash of inputs up to MIDSIZE_MAX bytes, which don't use the stripe accumulators.
+		 */
+		static uint64_t digestShort(const unsigned char* data, size_t len)
+		{
+			if(!len)
+				return xxh64Avalanche(read64(secret + 56) ^ read64(secret + 64) );
+
+			if(len <= 3)
+			{
+				uint32_t combined = ( (uint32_t)data[0] << 16) | ( (uint32_t)data[len >> 1] << 24) |
+					(uint32_t)data[len - 1] | ( (uint32_t)len << 8);
+				uint64_t bitflip = read32(secret) ^ read32(secret + 4);
+
+				return xxh64Avalanche(combined ^ bitflip);
+			}
+
+			if(len <= 8)
+			{
+				uint64_t bitflip = read64(secret + 8) ^ read64(secret + 16);
+				uint64_t input = read32(data + len - 4) + ( (uint64_t)read32(data) << 32);
+
+				return rrmxmx(input ^ bitflip, len);
+			}
+
+			if(len <= 16)
+			{
+				uint64_t inputLow = read64(data) ^ read64(secret + 24) ^ read64(secret + 32);
+				uint64_t inputHigh = read64(data + len - 8) ^ read64(secret + 40) ^
+					read64(secret + 48);
+				uint64_t acc = len + __builtin_bswap64(inputLow) + inputHigh +
+					mul128Fold64(inputLow, inputHigh);
+
+				return avalanche(acc);
+			}
+
+			uint64_t acc = len * PRIME64_1;
+
+			if(len <= 128)
+			{
+				if(len > 32)
+				{
+					if(len > 64)
+					{
+						if(len > 96)
+						{
+							acc += mix16B(data + 48, secret + 96);
+							acc += mix16B(data + len - 64, secret + 112);
+						}
+
+						acc += mix16B(data + 32, secret + 64);
+						acc += mix16B(data + len - 48, secret + 80);
+					}
+
+					acc += mix16B(data + 16, secret + 32);
+					acc += mix16B(data + len - 32, secret + 48);
+				}
+
+				acc += mix16B(data, secret);
+				acc += mix16B(data + len - 16, secret + 16);
+
+				return avalanche(acc);
+			}
+
+			// 129 to MIDSIZE_MAX bytes
+
+			const size_t numRounds = len / 16;
+
+			for(size_t i=0; i < 8; i++)
+				acc += mix16B(data + (i * 16), secret + (i * 16) );
+
+			acc = avalanche(acc);
+
+			for(size_t i=8; i < numRounds; i++)
+				acc += mix16B(data + (i * 16), secret + ( (i - 8) * 16) + 3);
+
+			acc += mix16B(data + len - 16, secret + 136 - 17);
+
+			return avalanche(acc);
+		}
+
+	public:
+		void update(const void* data, size_t len)
+		{
+			const unsigned char* dataPos = (const unsigned char*)data;
+			const unsigned char* const dataEnd = dataPos + len;
+
+			totalLen += len;
+
+			if( (bufLen + len) <= BUF_SIZE)
+			{ // not enough data to consume anything yet
+				memcpy(buf + bufLen, dataPos, len);
+				bufLen += len;
+				return;
+			}
+
+			if(bufLen)
+			{ // fill up and consume buffer
+				size_t copyLen = BUF_SIZE - bufLen;
+
+				memcpy(buf + bufLen, dataPos, copyLen);
+				dataPos += copyLen;
+
+				consumeStripes(accs, numStripesInBlock, buf, BUF_STRIPES);
+				bufLen = 0;
+			}
+
+			/* consume directly from input, but always keep some data for the buffer, because
+				digest() needs the last stripe */
+			if( (dataEnd - dataPos) > (ssize_t)BUF_SIZE)
+			{
+				size_t numStripes = ( (dataEnd - dataPos) - 1) / STRIPE_LEN;
+
+				consumeStripes(accs, numStripesInBlock, dataPos, numStripes);
+				dataPos += numStripes * STRIPE_LEN;
+
+				// digest() might need bytes of the previous stripe if buffer has less than a stripe
+				memcpy(buf + BUF_SIZE - STRIPE_LEN, dataPos - STRIPE_LEN, STRIPE_LEN);
+			}
+
+			memcpy(buf, dataPos, dataEnd - dataPos);
+			bufLen = dataEnd - dataPos;
+		}
+
+		uint64_t digest() const
+		{
+			if(totalLen <= MIDSIZE_MAX)
+				return digestShort(buf, totalLen); // all data is still in buf
+
+			// consume buffered data on a copy of the state, so that update() could continue
+
+			uint64_t accsCopy[8];
+			size_t numStripesInBlockCopy = numStripesInBlock;
+			unsigned char lastStripe[STRIPE_LEN];
+			const unsigned char* lastStripePos;
+
+			memcpy(accsCopy, accs, sizeof(accs) );
+
+			if(bufLen >= STRIPE_LEN)
+			{
+				size_t numStripes = (bufLen - 1) / STRIPE_LEN;
+
+				consumeStripes(accsCopy, numStripesInBlockCopy, buf, numStripes);
+
+				lastStripePos = buf + bufLen - STRIPE_LEN;
+			}
+			else
+			{ // last stripe consists of end of previous data and the buffered data
+				size_t catchupLen = STRIPE_LEN - bufLen;
+
+				memcpy(lastStripe, buf + BUF_SIZE - catchupLen, catchupLen);
+				memcpy(lastStripe + catchupLen, buf, bufLen);
+
+				lastStripePos = lastStripe;
+			}
+
+			accumulateStripe(accsCopy, lastStripePos, secret + SECRET_SIZE - STRIPE_LEN - 7);
+
+			return mergeAccs(accsCopy, totalLen);
+		}
+};
+
+const unsigned char Xxh3Hasher::secret[Xxh3Hasher::SECRET_SIZE] =
+{
+	0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+	0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+	0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+	0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+	0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+	0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+	0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+	0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+	0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+	0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+	0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+	0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/**
+ * Streaming implementation of SHA-256 (FIPS 180-4). The block compression function uses the
+ * x86 SHA extensions or the ARMv8 crypto extensions if the CPU supports them (detected at
+ * runtime) and falls back to a portable implementation otherwise.
+ */
+class Sha256Hasher
+{
+	public:
+		static const size_t DIGEST_LEN = 32;
+
+	private:
+		static const size_t BLOCK_LEN = 64;
+
+		static const uint32_t roundConstants[64];
+
+		typedef void (*CompressFunc)(uint32_t* state, const unsigned char* data, size_t numBlocks);
+
+		static const CompressFunc compressFunc; // selected once based on CPU features
+
+	private:
+		uint32_t state[8] {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+			0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+		unsigned char buf[BLOCK_LEN];
+		size_t bufLen {0}; // number of used bytes in buf
+		uint64_t totalLen {0}; // number of bytes given to update() so far
+
+		static uint32_t rotr(uint32_t value, unsigned numBits)
+		{
+			return (value >> numBits) | (value << (32 - numBits) );
+		}
+
+		static void compressPortable(uint32_t* state, const unsigned char* data,
+			size_t numBlocks)
+		{
+			for( ; numBlocks; numBlocks--, data += BLOCK_LEN)
+			{
+				uint32_t schedule[64];
+
+				for(unsigned i=0; i < 16; i++)
+					schedule[i] = ( (uint32_t)data[i * 4] << 24) |
+						( (uint32_t)data[(i * 4) + 1] << 16) |
+						( (uint32_t)data[(i * 4) + 2] << 8) |
+						(uint32_t)data[(i * 4) + 3];
+
+				for(unsigned i=16; i < 64; i++)
+				{
+					uint32_t s0 = rotr(schedule[i - 15], 7) ^ rotr(schedule[i - 15], 18) ^
+						(schedule[i - 15] >> 3);
+					uint32_t s1 = rotr(schedule[i - 2], 17) ^ rotr(schedule[i - 2], 19) ^
+						(schedule[i - 2] >> 10);
+
+					schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+				}
+
+				uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+				uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+				for(unsigned i=0; i < 64; i++)
+				{
+					uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+					uint32_t choice = (e & f) ^ (~e & g);
+					uint32_t temp1 = h + s1 + choice + roundConstants[i] + schedule[i];
+					uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+					uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+					uint32_t temp2 = s0 + majority;
+
+					h = g;
+					g = f;
+					f = e;
+					e = d + temp1;
+					d = c;
+					c = b;
+					b = a;
+					a = temp1 + temp2;
+				}
+
+				state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+				state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+			}
+		}
+
+#if defined(__x86_64__)
+		__attribute__((target("sha,sse4.1") ) )
+		static void compressX86SHA(uint32_t* state, const unsigned char* data, size_t numBlocks)
+		{
+			const __m128i byteSwapMask =
+				_mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			// the SHA instructions need state in ABEF/CDGH order instead of ABCD/EFGH
+
+			__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128( (const __m128i*)&state[0] ), 0xB1);
+			__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128( (const __m128i*)&state[4] ), 0x1B);
+			__m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+			state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+
+			for( ; numBlocks; numBlocks--, data += BLOCK_LEN)
+			{
+				const __m128i state0Save = state0;
+				const __m128i state1Save = state1;
+				__m128i msgs[4]; // message schedule, 4 words per elem
+
+				// each iteration does 4 rounds
+				for(unsigned i=0; i < 16; i++)
+				{
+					if(i < 4)
+						msgs[i] = _mm_shuffle_epi8(
+							_mm_loadu_si128( (const __m128i*)(data + (i * 16) ) ), byteSwapMask);
+
+					__m128i msg = _mm_add_epi32(msgs[i % 4],
+						_mm_loadu_si128( (const __m128i*)&roundConstants[i * 4] ) );
+
+					state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+					if( (i >= 3) && (i <= 14) )
+					{ // complete schedule words for the next iteration
+						tmp = _mm_alignr_epi8(msgs[i % 4], msgs[(i + 3) % 4], 4);
+						msgs[(i + 1) % 4] = _mm_add_epi32(msgs[(i + 1) % 4], tmp);
+						msgs[(i + 1) % 4] = _mm_sha256msg2_epu32(msgs[(i + 1) % 4], msgs[i % 4] );
+					}
+
+					msg = _mm_shuffle_epi32(msg, 0x0E);
+					state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+					if( (i >= 1) && (i <= 12) ) // prepare schedule words for 3 iterations ahead
+						msgs[(i + 3) % 4] = _mm_sha256msg1_epu32(msgs[(i + 3) % 4], msgs[i % 4] );
+				}
+
+				state0 = _mm_add_epi32(state0, state0Save);
+				state1 = _mm_add_epi32(state1, state1Save);
+			}
+
+			// back to ABCD/EFGH order
+
+			tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+			state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+			state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+			state1 = _mm_alignr_epi8(state1, tmp, 8); // ABEF
+
+			_mm_storeu_si128( (__m128i*)&state[0], state0);
+			_mm_storeu_si128( (__m128i*)&state[4], state1);
+		}
+#endif // __x86_64__
+
+#if defined(__aarch64__)
+		__attribute__((target("+crypto") ) )
+		static void compressArmSHA2(uint32_t* state, const unsigned char* data, size_t numBlocks)
+		{
+			uint32x4_t state0 = vld1q_u32(&state[0] );
+			uint32x4_t state1 = vld1q_u32(&state[4] );
+
+			for( ; numBlocks; numBlocks--, data += BLOCK_LEN)
+			{
+				const uint32x4_t state0Save = state0;
+				const uint32x4_t state1Save = state1;
+				uint32x4_t msgs[4]; // message schedule, 4 words per elem
+
+				for(unsigned i=0; i < 4; i++)
+					msgs[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + (i * 16) ) ) );
+
+				// each iteration does 4 rounds
+				for(unsigned i=0; i < 16; i++)
+				{
+					uint32x4_t msg = vaddq_u32(msgs[i % 4], vld1q_u32(&roundConstants[i * 4] ) );
+
+					if(i < 12)
+						msgs[i % 4] = vsha256su0q_u32(msgs[i % 4], msgs[(i + 1) % 4] );
+
+					uint32x4_t state0Prev = state0;
+					state0 = vsha256hq_u32(state0, state1, msg);
+					state1 = vsha256h2q_u32(state1, state0Prev, msg);
+
+					if(i < 12) // schedule words for 4 iterations ahead
+						msgs[i % 4] = vsha256su1q_u32(msgs[i % 4], msgs[(i + 2) % 4],
+							msgs[(i + 3) % 4] );
+				}
+
+				state0 = vaddq_u32(state0, state0Save);
+				state1 = vaddq_u32(state1, state1Save);
+			}
+
+			vst1q_u32(&state[0], state0);
+			vst1q_u32(&state[4], state1);
+		}
+#endif // __aarch64__
+
+		static CompressFunc selectCompressFunc()
+		{
+#if defined(__x86_64__)
+			unsigned eax, ebx, ecx, edx;
+
+			if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA) &&
+				__builtin_cpu_supports("sse4.1") )
+				return compressX86SHA;
+#elif defined(__aarch64__)
+			if(getauxval(AT_HWCAP) & HWCAP_SHA2)
+				return compressArmSHA2;
+#endif
+
+			return compressPortable;
+		}
+
+	public:
+		static bool isHardwareAccelerated()
+		{
+			return compressFunc != compressPortable;
+		}
+
+		void update(const void* data, size_t len)
+		{
+			const unsigned char* dataPos = (const unsigned char*)data;
+
+			totalLen += len;
+
+			if(bufLen)
+			{ // fill up previously buffered partial block
+				size_t copyLen = std::min(len, BLOCK_LEN - bufLen);
+
+				memcpy(buf + bufLen, dataPos, copyLen);
+				bufLen += copyLen;
+				dataPos += copyLen;
+				len -= copyLen;
+
+				if(bufLen < BLOCK_LEN)
+					return; // still not a full block
+
+				compressFunc(state, buf, 1);
+				bufLen = 0;
+			}
+
+			size_t numBlocks = len / BLOCK_LEN;
+
+			if(numBlocks)
+			{
+				compressFunc(state, dataPos, numBlocks);
+				dataPos += numBlocks * BLOCK_LEN;
+				len -= numBlocks * BLOCK_LEN;
+			}
+
+			memcpy(buf, dataPos, len);
+			bufLen = len;
+		}
+
+		/**
+		 * Finalize the hash. This may only be called once.
+		 */
+		void digest(unsigned char* outDigest)
+		{
+			const uint64_t totalBits = totalLen * 8;
+			unsigned char padding[BLOCK_LEN + 8] = {0x80};
+			size_t paddingLen = ( (bufLen < 56) ? 56 : (56 + BLOCK_LEN) ) - bufLen;
+
+			for(unsigned i=0; i < 8; i++)
+				padding[paddingLen + i] = (unsigned char)(totalBits >> (56 - (i * 8) ) );
+
+			update(padding, paddingLen + 8);
+
+			for(unsigned i=0; i < 8; i++)
+				for(unsigned j=0; j < 4; j++)
+					outDigest[(i * 4) + j] = (unsigned char)(state[i] >> (24 - (j * 8) ) );
+		}
+};
+
+const uint32_t Sha256Hasher::roundConstants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const Sha256Hasher::CompressFunc Sha256Hasher::compressFunc = Sha256Hasher::selectCompressFunc();
+
+/**
+ * Streaming implementation of CRC-32C (Castagnoli polynomial, as used e.g. by iSCSI and ext4).
+ * Uses the SSE4.2 or ARMv8 CRC32 instructions if the CPU supports them (detected at runtime) and
+ * falls back to a portable table-based implementation otherwise.
+ */
+class Crc32cHasher
+{
+	private:
+		static const uint32_t POLYNOMIAL = 0x82F63B78; // reversed Castagnoli polynomial
+
+		typedef uint32_t (*UpdateFunc)(uint32_t crc, const unsigned char* data, size_t len);
+
+		struct LookupTable
+		{
+			uint32_t values[256];
+
+			LookupTable()
+			{
+				for(uint32_t i=0; i < 256; i++)
+				{
+					uint32_t crc = i;
+
+					for(unsigned bit=0; bit < 8; bit++)
+						crc = (crc & 1) ? ( (crc >> 1) ^ POLYNOMIAL) : (crc >> 1);
+
+					values[i] = crc;
+				}
+			}
+		};
+
+		static const LookupTable lookupTable;
+		static const UpdateFunc updateFunc; // selected once based on CPU features
+
+	private:
+		uint32_t crc {0xFFFFFFFF};
+
+		static uint32_t updatePortable(uint32_t crc, const unsigned char* data, size_t len)
+		{
+			for(size_t i=0; i < len; i++)
+				crc = lookupTable.values[(crc ^ data[i] ) & 0xFF] ^ (crc >> 8);
+
+			return crc;
+		}
+
+#if defined(__x86_64__)
+		__attribute__((target("sse4.2") ) )
+		static uint32_t updateX86SSE42(uint32_t crc, const unsigned char* data, size_t len)
+		{
+			uint64_t crc64 = crc;
+
+			for( ; len >= 8; len -= 8, data += 8)
+			{
+				uint64_t value;
+				memcpy(&value, data, sizeof(value) ); // (memcpy for unaligned access)
+				crc64 = _mm_crc32_u64(crc64, value);
+			}
+
+			crc = (uint32_t)crc64;
+
+			for( ; len; len--, data++)
+				crc = _mm_crc32_u8(crc, *data);
+
+			return crc;
+		}
+#endif // __x86_64__
+
+#if defined(__aarch64__)
+		__attribute__((target("+crc") ) )
+		static uint32_t updateArmCRC32(uint32_t crc, const unsigned char* data, size_t len)
+		{
+			for( ; len >= 8; len -= 8, data += 8)
+			{
+				uint64_t value;
+				memcpy(&value, data, sizeof(value) ); // (memcpy for unaligned access)
+				crc = __crc32cd(crc, value);
+			}
+
+			for( ; len; len--, data++)
+				crc = __crc32cb(crc, *data);
+
+			return crc;
+		}
+#endif // __aarch64__
+
+		static UpdateFunc selectUpdateFunc()
+		{
+#if defined(__x86_64__)
+			if(__builtin_cpu_supports("sse4.2") )
+				return updateX86SSE42;
+#elif defined(__aarch64__)
+			if(getauxval(AT_HWCAP) & HWCAP_CRC32)
+				return updateArmCRC32;
+#endif
+
+			return updatePortable;
+		}
+
+	public:
+		void update(const void* data, size_t len)
+		{
+			crc = updateFunc(crc, (const unsigned char*)data, len);
+		}
+
+		uint32_t digest() const
+		{
+			return ~crc;
+		}
+};
+
+const Crc32cHasher::LookupTable Crc32cHasher::lookupTable;
+const Crc32cHasher::UpdateFunc Crc32cHasher::updateFunc = Crc32cHasher::selectUpdateFunc();
+
+/**
+ * Search for literal strings in file contents, e.g. for "--contains". Contents can be given in
+ * consecutive chunks, in which case matches across chunk boundaries are also found.
+ *
+ * A single literal gets searched with a SIMD prefilter for its first and last byte (AVX2 if the
+ * CPU supports it, NEON on ARMv8). Multiple literals get searched in a single pass with an
+ * Aho-Corasick automaton.
+ */
+class ContentMatcher
+{
+	public:
+		/**
+		 * Per-file state for chunked search.
+		 */
+		struct ChunkState
+		{
+			uint32_t automatonState {0}; // current state of Aho-Corasick automaton
+			std::string carryBuf; // end of previous chunk for single literal search
+		};
+
+	private:
+		typedef const char* (*FindLiteralFunc)(const char* haystack, size_t haystackLen,
+			const char* needle, size_t needleLen);
+
+		static const FindLiteralFunc findLiteralFunc; // selected once based on CPU features
+
+	public:
+		ContentMatcher() {}
+
+	private:
+		StringVec literals;
+
+		// Aho-Corasick automaton (only used for multiple literals)
+		unsigned char byteClasses[256]; // maps bytes to column in transitions; 0 for unused bytes
+		unsigned numByteClasses {0};
+		std::vector<uint32_t> transitions; // next state; row is state, column is byte class
+		std::vector<bool> isMatchState; // true if any literal ends in this state
+
+		static const char* findLiteralPortable(const char* haystack, size_t haystackLen,
+			const char* needle, size_t needleLen)
+		{
+			return (const char*)memmem(haystack, haystackLen, needle, needleLen);
+		}
+
+#if defined(__x86_64__)
+		__attribute__((target("avx2") ) )
+		static const char* findLiteralAVX2(const char* haystack, size_t haystackLen,
+			const char* needle, size_t needleLen)
+		{
+			if(needleLen < 2)
+				return (const char*)memchr(haystack, needle[0], haystackLen);
+
+			const __m256i firstByteVec = _mm256_set1_epi8(needle[0] );
+			const __m256i lastByteVec = _mm256_set1_epi8(needle[needleLen - 1] );
+			size_t pos = 0;
+
+			// compare 32 candidate positions per iteration based on first and last byte
+			for( ; (pos + needleLen - 1 + 32) <= haystackLen; pos += 32)
+			{
+				__m256i firstBytes = _mm256_loadu_si256( (const __m256i*)(haystack + pos) );
+				__m256i lastBytes = _mm256_loadu_si256(
+					(const __m256i*)(haystack + pos + needleLen - 1) );
+
+				uint32_t candidatesMask = _mm256_movemask_epi8(_mm256_and_si256(
+					_mm256_cmpeq_epi8(firstBytes, firstByteVec),
+					_mm256_cmpeq_epi8(lastBytes, lastByteVec) ) );
+
+				for( ; candidatesMask; candidatesMask &= (candidatesMask - 1) )
+				{
+					size_t candidatePos = pos + __builtin_ctz(candidatesMask);
+
+					if(!memcmp(haystack + candidatePos + 1, needle + 1, needleLen - 2) )
+						return haystack + candidatePos;
+				}
+			}
+
+			return findLiteralPortable(haystack + pos, haystackLen - pos, needle, needleLen);
+		}
+#endif // __x86_64__
+
+#if defined(__aarch64__)
+		static const char* findLiteralNEON(const char* haystack, size_t haystackLen,
+			const char* needle, size_t needleLen)
+		{
+			if(needleLen < 2)
+				return (const char*)memchr(haystack, needle[0], haystackLen);
+
+			const uint8x16_t firstByteVec = vdupq_n_u8(needle[0] );
+			const uint8x16_t lastByteVec = vdupq_n_u8(needle[needleLen - 1] );
+			size_t pos = 0;
+
+			// compare 16 candidate positions per iteration based on first and last byte
+			for( ; (pos + needleLen - 1 + 16) <= haystackLen; pos += 16)
+			{
+				uint8x16_t firstBytes = vld1q_u8( (const uint8_t*)(haystack + pos) );
+				uint8x16_t lastBytes = vld1q_u8( (const uint8_t*)(haystack + pos + needleLen - 1) );
+
+				uint8x16_t candidatesVec = vandq_u8(vceqq_u8(firstBytes, firstByteVec),
+					vceqq_u8(lastBytes, lastByteVec) );
+
+				// narrow to 4 bits per byte, because NEON has no movemask
+				uint64_t candidatesMask = vget_lane_u64(vreinterpret_u64_u8(
+					vshrn_n_u16(vreinterpretq_u16_u8(candidatesVec), 4) ), 0);
+
+				for( ; candidatesMask; candidatesMask &= ~(0xFULL << (__builtin_ctzll(
+					candidatesMask) & ~3U) ) )
+				{
+					size_t candidatePos = pos + (__builtin_ctzll(candidatesMask) / 4);
+
+					if(!memcmp(haystack + candidatePos + 1, needle + 1, needleLen - 2) )
+						return haystack + candidatePos;
+				}
+			}
+
+			return findLiteralPortable(haystack + pos, haystackLen - pos, needle, needleLen);
+		}
+#endif // __aarch64__
+
+		static FindLiteralFunc selectFindLiteralFunc()
+		{
+#if defined(__x86_64__)
+			if(__builtin_cpu_supports("avx2") )
+				return findLiteralAVX2;
+#elif defined(__aarch64__)
+			return findLiteralNEON;
+#endif
+
+			return findLiteralPortable;
+		}
+
+		/**
+		 * Build Aho-Corasick automaton with failure transitions resolved, so that each input byte
+		 * is exactly one table lookup.
+		 */
+		void buildAutomaton()
+		{
+			// assign byte classes to keep the transition table small
+
+			memset(byteClasses, 0, sizeof(byteClasses) );
+			numByteClasses = 1; // class 0 for bytes that don't occur in any literal
+
+			for(const std::string& literal : literals)
+				for(const unsigned char currentByte : literal)
+					if(!byteClasses[currentByte] )
+						byteClasses[currentByte] = numByteClasses++;
+
+			// build trie (0 means "no transition" here, because root can't be a child)
+
+			transitions.assign(numByteClasses, 0); // root state
+			isMatchState.assign(1, false);
+
+			for(const std::string& literal : literals)
+			{
+				uint32_t state = 0;
+
+				for(const unsigned char currentByte : literal)
+				{
+					uint32_t& nextState = transitions[(state * numByteClasses) +
+						byteClasses[currentByte] ];
+
+					if(!nextState)
+					{
+						nextState = isMatchState.size();
+						isMatchState.push_back(false);
+						// (nextState reference is invalid after resize, so assign above first)
+						transitions.resize(transitions.size() + numByteClasses, 0);
+					}
+
+					state = transitions[(state * numByteClasses) + byteClasses[currentByte] ];
+				}
+
+				isMatchState[state] = true;
+			}
+
+			// breadth-first to resolve failure transitions (root children fail to root)
+
+			std::vector<uint32_t> failStates(isMatchState.size(), 0);
+			std::queue<uint32_t> stateQueue;
+
+			for(unsigned byteClass=0; byteClass < numByteClasses; byteClass++)
+				if(transitions[byteClass] )
+					stateQueue.push(transitions[byteClass] );
+
+			while(!stateQueue.empty() )
+			{
+				uint32_t state = stateQueue.front();
+				stateQueue.pop();
+
+				if(isMatchState[failStates[state] ] )
+					isMatchState[state] = true; // a literal ends in a suffix of this state
+
+				for(unsigned byteClass=0; byteClass < numByteClasses; byteClass++)
+				{
+					uint32_t& nextState = transitions[(state * numByteClasses) + byteClass];
+					uint32_t failNextState =
+						transitions[(failStates[state] * numByteClasses) + byteClass];
+
+					if(nextState)
+					{
+						failStates[nextState] = failNextState;
+						stateQueue.push(nextState);
+					}
+					else
+						nextState = failNextState;
+				}
+			}
+		}
+
+	public:
+		/**
+		 * Set the literals to search for. Literals may not be empty.
+		 */
+		void setLiterals(const StringVec& literals)
+		{
+			this->literals = literals;
+
+			if(literals.size() > 1)
+				buildAutomaton();
+		}
+
+		bool empty() const
+		{
+			return literals.empty();
+		}
+
+		/**
+		 * Search next chunk of contents.
+		 *
+		 * @chunkState state from search in previous chunks of the same contents.
+		 * @return true if any of the literals was found.
+		 */
+		bool findInChunk(ChunkState& chunkState, const char* buf, size_t len) const
+		{
+			if(literals.size() > 1)
+			{ // Aho-Corasick
+				uint32_t state = chunkState.automatonState;
+
+				for(size_t i=0; i < len; i++)
+				{
+					state = transitions[(state * numByteClasses) +
+						byteClasses[(unsigned char)buf[i] ] ];
+
+					if(isMatchState[state] )
+						return true;
+				}
+
+				chunkState.automatonState = state;
+
+				return false;
+			}
+
+			// single literal
+
+			const std::string& literal = literals[0];
+			const size_t carryLen = literal.length() - 1; // bytes to keep for chunk boundary
+
+			if(!chunkState.carryBuf.empty() )
+			{ // check for match across boundary of previous and current chunk
+				std::string boundaryBuf(chunkState.carryBuf);
+				boundaryBuf.append(buf, std::min(len, carryLen) );
+
+				if(findLiteralFunc(boundaryBuf.data(), boundaryBuf.length(),
+					literal.data(), literal.length() ) )
+					return true;
+			}
+
+			if(findLiteralFunc(buf, len, literal.data(), literal.length() ) )
+				return true;
+
+			// remember end of data for next chunk
+
+			if(len >= carryLen)
+				chunkState.carryBuf.assign(buf + len - carryLen, carryLen);
+			else
+			{
+				chunkState.carryBuf.append(buf, len);
+
+				if(chunkState.carryBuf.length() > carryLen)
+					chunkState.carryBuf.erase(0, chunkState.carryBuf.length() - carryLen);
+			}
+
+			return false;
+		}
+};
+
+const ContentMatcher::FindLiteralFunc ContentMatcher::findLiteralFunc =
+	ContentMatcher::selectFindLiteralFunc();
+
+ContentMatcher contentMatcher; // initialized from config.containsLiterals
+
+/**
+ * Open-addressing hash set (linear probing) of fixed-length binary keys, e.g. checksum digests.
+ * Keys are stored back to back in a flat array, so lookups touch only few cache lines. Intended
+ * to be filled once and then only be read concurrently.
+ */
+class DigestHashSet
+{
+	private:
+		size_t keyLen {0};
+		size_t numKeys {0};
+		size_t capacityMask {0}; // capacity is a power of 2
+		std::vector<unsigned char> keys; // capacity * keyLen bytes
+		std::vector<bool> slotsUsed;
+
+		/**
+		 * Hash of the first 8 bytes of the key (zero-padded if shorter). The splitmix64
+		 * finalizer gives good distribution also for non-uniform keys like file sizes.
+		 */
+		uint64_t hashKey(const unsigned char* key) const
+		{
+			uint64_t hash = 0;
+			memcpy(&hash, key, std::min(keyLen, sizeof(hash) ) );
+
+			hash ^= hash >> 30;
+			hash *= 0xBF58476D1CE4E5B9ULL;
+			hash ^= hash >> 27;
+			hash *= 0x94D049BB133111EBULL;
+			hash ^= hash >> 31;
+
+			return hash;
+		}
+
+		void grow()
+		{
+			std::vector<unsigned char> oldKeys;
+			std::vector<bool> oldSlotsUsed;
+
+			oldKeys.swap(keys);
+			oldSlotsUsed.swap(slotsUsed);
+
+			size_t newCapacity = oldSlotsUsed.empty() ? 64 : (oldSlotsUsed.size() * 2);
+
+			keys.resize(newCapacity * keyLen);
+			slotsUsed.resize(newCapacity, false);
+			capacityMask = newCapacity - 1;
+			numKeys = 0;
+
+			for(size_t i=0; i < oldSlotsUsed.size(); i++)
+				if(oldSlotsUsed[i] )
+					insert(&oldKeys[i * keyLen] );
+		}
+
+	public:
+		/**
+		 * @keyLen length of keys in bytes. Must be set before insert.
+		 */
+		void setKeyLen(size_t keyLen)
+		{
+			this->keyLen = keyLen;
+		}
+
+		size_t getKeyLen() const
+		{
+			return keyLen;
+		}
+
+		size_t size() const
+		{
+			return numKeys;
+		}
+
+		bool empty() const
+		{
+			return !numKeys;
+		}
+
+		/**
+		 * @key keyLen bytes; ignored if already contained.
+		 */
+		void insert(const unsigned char* key)
+		{
+			if( (numKeys + 1) * 2 > slotsUsed.size() )
+				grow(); // keep load factor below 1/2 for short probe sequences
+
+			for(size_t slot = hashKey(key) & capacityMask; ; slot = (slot + 1) & capacityMask)
+			{
+				if(!slotsUsed[slot] )
+				{
+					memcpy(&keys[slot * keyLen], key, keyLen);
+					slotsUsed[slot] = true;
+					numKeys++;
+					return;
+				}
+
+				if(!memcmp(&keys[slot * keyLen], key, keyLen) )
+					return; // already contained
+			}
+		}
+
+		/**
+		 * @key keyLen bytes.
+		 */
+		bool contains(const unsigned char* key) const
+		{
+			if(!numKeys)
+				return false;
+
+			for(size_t slot = hashKey(key) & capacityMask; ; slot = (slot + 1) & capacityMask)
+			{
+				if(!slotsUsed[slot] )
+					return false;
+
+				if(!memcmp(&keys[slot * keyLen], key, keyLen) )
+					return true;
+			}
+		}
+};
+
+DigestHashSet hashInDigestSet; // checksums from "--hash-in" file
+DigestHashSet hashInSizeSet; // file sizes from "--hash-in" file; empty if sizes are not given
+bool hashInSizeSetDisabled = false; // true if any line of any "--hash-in" file had no size
+
+/**
+ * Detection of file types by signatures ("magic bytes") at fixed offsets near the start of a file,
+ * e.g. for "--magic". Signatures are compiled into one byte-prefix trie per offset, so that all
+ * signatures at an offset are checked in a single pass over the bytes. If multiple signatures
+ * match, the longest one wins (e.g. "deb" over generic "ar").
+ */
+class MagicTypeDetector
+{
+	private:
+		struct Signature
+		{
+			const char* typeName;
+			size_t offset; // offset of bytes in file
+			const char* bytes;
+			size_t len; // length of bytes (which may contain zeros)
+		};
+
+		struct TrieNode
+		{
+			std::vector<std::pair<unsigned char, uint32_t> > children; // byte and node index
+			const char* typeName {NULL}; // non-NULL if a signature ends at this node
+		};
+
+		struct Trie
+		{
+			size_t offset; // offset of signatures in file
+			std::vector<TrieNode> nodes; // nodes[0] is root
+		};
+
+		static const Signature signatures[];
+		static const size_t numSignatures;
+
+		std::vector<Trie> tries; // one per distinct offset
+
+		void addSignature(const Signature& signature)
+		{
+			Trie* trie = NULL;
+
+			for(Trie& currentTrie : tries)
+				if(currentTrie.offset == signature.offset)
+					trie = &currentTrie;
+
+			if(!trie)
+			{
+				tries.push_back(Trie() );
+				trie = &tries.back();
+				trie->offset = signature.offset;
+				trie->nodes.resize(1);
+			}
+
+			uint32_t nodeIndex = 0;
+
+			for(size_t i=0; i < signature.len; i++)
+			{
+				unsigned char byte = signature.bytes[i];
+				uint32_t childIndex = 0;
+
+				for(const auto& child : trie->nodes[nodeIndex].children)
+					if(child.first == byte)
+						childIndex = child.second;
+
+				if(!childIndex)
+				{
+					childIndex = trie->nodes.size();
+					trie->nodes[nodeIndex].children.push_back( {byte, childIndex} );
+					trie->nodes.resize(childIndex + 1); // (invalidates references to nodes)
+				}
+
+				nodeIndex = childIndex;
+			}
+
+			trie->nodes[nodeIndex].typeName = signature.typeName;
+		}
+
+	public:
+		MagicTypeDetector()
+		{
+			for(size_t i=0; i < numSignatures; i++)
+				addSignature(signatures[i] );
+		}
+
+		/**
+		 * @buf bytes from the start of the file.
+		 * @return name of detected type or NULL if no signature matched.
+		 */
+		const char* detect(const unsigned char* buf, size_t len) const
+		{
+			const char* typeName = NULL;
+			size_t typeSignatureLen = 0;
+
+			for(const Trie& trie : tries)
+			{
+				uint32_t nodeIndex = 0;
+
+				for(size_t i = trie.offset; i < len; i++)
+				{
+					uint32_t childIndex = 0;
+
+					for(const auto& child : trie.nodes[nodeIndex].children)
+						if(child.first == buf[i] )
+							childIndex = child.second;
+
+					if(!childIndex)
+						break;
+
+					nodeIndex = childIndex;
+
+					if(trie.nodes[nodeIndex].typeName && ( (i + 1 - trie.offset) > typeSignatureLen) )
+					{
+						typeName = trie.nodes[nodeIndex].typeName;
+						typeSignatureLen = i + 1 - trie.offset;
+					}
+				}
+			}
+
+			return typeName;
+		}
+
+		/**
+		 * @return true if typeName is the name of at least one signature.
+		 */
+		static bool isKnownType(const std::string& typeName)
+		{
+			for(size_t i=0; i < numSignatures; i++)
+				if(typeName == signatures[i].typeName)
+					return true;
+
+			return false;
+		}
+
+		/**
+		 * @return comma-separated list of all known type names, sorted alphabetically.
+		 */
+		static std::string getKnownTypesStr()
+		{
+			StringVec typeNames;
+
+			for(size_t i=0; i < numSignatures; i++)
+				if(std::find(typeNames.begin(), typeNames.end(), signatures[i].typeName) ==
+					typeNames.end() )
+					typeNames.push_back(signatures[i].typeName);
+
+			std::sort(typeNames.begin(), typeNames.end() );
+
+			std::string typesStr;
+
+			for(const std::string& typeName : typeNames)
+				typesStr += (typesStr.empty() ? "" : ",") + typeName;
+
+			return typesStr;
+		}
+};
+
+#define MAGIC_SIGNATURE(typeName, offset, bytes)	{typeName, offset, bytes, sizeof(bytes) - 1}
+
+const MagicTypeDetector::Signature MagicTypeDetector::signatures[] =
+{
+	MAGIC_SIGNATURE("7z", 0, "7z\xBC\xAF\x27\x1C"),
+	MAGIC_SIGNATURE("ar", 0, "!<arch>\n"),
+	MAGIC_SIGNATURE("bzip2", 0, "BZh"),
+	MAGIC_SIGNATURE("deb", 0, "!<arch>\ndebian-binary"),
+	MAGIC_SIGNATURE("elf", 0, "\x7F" "ELF"),
+	MAGIC_SIGNATURE("fits", 0, "SIMPLE  ="),
+	MAGIC_SIGNATURE("flac", 0, "fLaC"),
+	MAGIC_SIGNATURE("gif", 0, "GIF87a"),
+	MAGIC_SIGNATURE("gif", 0, "GIF89a"),
+	MAGIC_SIGNATURE("grib", 0, "GRIB"),
+	MAGIC_SIGNATURE("gzip", 0, "\x1F\x8B"),
+	MAGIC_SIGNATURE("hdf5", 0, "\x89HDF\r\n\x1A\n"), // (superblock can also be at 512, 1024, ...)
+	MAGIC_SIGNATURE("hdf5", 512, "\x89HDF\r\n\x1A\n"),
+	MAGIC_SIGNATURE("hdf5", 1024, "\x89HDF\r\n\x1A\n"),
+	MAGIC_SIGNATURE("hdf5", 2048, "\x89HDF\r\n\x1A\n"),
+	MAGIC_SIGNATURE("jpeg", 0, "\xFF\xD8\xFF"),
+	MAGIC_SIGNATURE("lz4", 0, "\x04\x22\x4D\x18"),
+	MAGIC_SIGNATURE("mp3", 0, "ID3"),
+	MAGIC_SIGNATURE("mp4", 4, "ftyp"),
+	MAGIC_SIGNATURE("netcdf", 0, "CDF\x01"), // (netcdf4 files are hdf5)
+	MAGIC_SIGNATURE("netcdf", 0, "CDF\x02"),
+	MAGIC_SIGNATURE("netcdf", 0, "CDF\x05"),
+	MAGIC_SIGNATURE("numpy", 0, "\x93NUMPY"),
+	MAGIC_SIGNATURE("ogg", 0, "OggS"),
+	MAGIC_SIGNATURE("parquet", 0, "PAR1"),
+	MAGIC_SIGNATURE("pdf", 0, "%PDF-"),
+	MAGIC_SIGNATURE("pe", 0, "MZ"),
+	MAGIC_SIGNATURE("png", 0, "\x89PNG\r\n\x1A\n"),
+	MAGIC_SIGNATURE("qcow2", 0, "QFI\xFB"),
+	MAGIC_SIGNATURE("rar", 0, "Rar!\x1A\x07"),
+	MAGIC_SIGNATURE("riff", 0, "RIFF"),
+	MAGIC_SIGNATURE("rpm", 0, "\xED\xAB\xEE\xDB"),
+	MAGIC_SIGNATURE("script", 0, "#!"),
+	MAGIC_SIGNATURE("sqlite", 0, "SQLite format 3\x00"),
+	MAGIC_SIGNATURE("tar", 257, "ustar"),
+	MAGIC_SIGNATURE("tiff", 0, "II*\x00"),
+	MAGIC_SIGNATURE("tiff", 0, "MM\x00*"),
+	MAGIC_SIGNATURE("wasm", 0, "\x00" "asm"),
+	MAGIC_SIGNATURE("xml", 0, "<?xml"),
+	MAGIC_SIGNATURE("xz", 0, "\xFD" "7zXZ\x00"),
+	MAGIC_SIGNATURE("zip", 0, "PK\x03\x04"),
+	MAGIC_SIGNATURE("zip", 0, "PK\x05\x06"), // (empty archive)
+	MAGIC_SIGNATURE("zstd", 0, "\x28\xB5\x2F\xFD"),
+};
+
+const size_t MagicTypeDetector::numSignatures =
+	sizeof(MagicTypeDetector::signatures) / sizeof(MagicTypeDetector::signatures[0] );
+
+const MagicTypeDetector magicTypeDetector;
+
+/**
+ * Global statistics. Each counter is sharded into the per-thread StatisticsCounterBlock, so reading
+ * a counter aggregates over all threads.
+ */
+struct Statistics
+{
+	StatisticsCounter numDirsFound {&StatisticsCounterBlock::numDirsFound};
+	StatisticsCounter numFilesFound {&StatisticsCounterBlock::numFilesFound};
+	StatisticsCounter numUnknownFound {&StatisticsCounterBlock::numUnknownFound};
+	StatisticsCounter numFilterMatches {&StatisticsCounterBlock::numFilterMatches};
+	StatisticsCounter numStatCalls {&StatisticsCounterBlock::numStatCalls};
+	StatisticsCounter numAccessACLsFound {&StatisticsCounterBlock::numAccessACLsFound};
+	StatisticsCounter numDefaultACLsFound {&StatisticsCounterBlock::numDefaultACLsFound};
+	StatisticsCounter numErrors {&StatisticsCounterBlock::numErrors};
+	StatisticsCounter numBytesCopied {&StatisticsCounterBlock::numBytesCopied};
+	StatisticsCounter numFilesNotCopied {&StatisticsCounterBlock::numFilesNotCopied};
+	StatisticsCounter numBytesRead {&StatisticsCounterBlock::numBytesRead};
+} statistics;
+
+class ScanDoneException : public std::exception {};
+
+/**
+ * Get the max number of threads that may scan dirs of the given device at the same time for
+ * "--dev-threads". With "--dev-threads auto", network filesystems and non-rotational disks get no
+ * limit, because they benefit from many parallel requests, while rotational disks get
+ * DEV_THREADS_ROTATIONAL to avoid seek thrashing. Devices of the synthetic backend and anonymous
+ * devices (e.g. btrfs, major 0) have no block device to check and thus get no limit.
+ *
+ * @dirPath a dir on the given device, to detect the filesystem type.
+ * @return 0 for no limit.
+ */
+unsigned getDevThreadsLimit(uint64_t devID, const std::string& dirPath)
+{
+	if(!config.devThreadsAuto)
+		return config.devThreads;
+
+	if(config.useSyntheticFs)
+		return 0; // made-up device IDs and paths, nothing to detect on the real system
+
+	const std::vector<uint64_t> networkFsTypes = {
+		0x6969, // nfs
+		0xFF534D42, // cifs
+		0xFE534D42, // smb2
+		0x0BD00BD0, // lustre
+		0x19830326, // beegfs
+		0x47504653, // gpfs
+		0x00C36400, // ceph
+		0x5346414F, // afs
+	};
+
+	struct statfs statfsBuf;
+
+	if(!statfs(dirPath.c_str(), &statfsBuf) &&
+		(std::find(networkFsTypes.begin(), networkFsTypes.end(),
+			(uint64_t)(uint32_t)statfsBuf.f_type) != networkFsTypes.end() ) )
+		return 0;
+
+	// block devices of partitions don't have a queue dir, but their parent device has
+	const std::string sysDevPath = "/sys/dev/block/" + std::to_string(major(devID) ) + ":" +
+		std::to_string(minor(devID) );
+
+	for(const std::string& rotationalPath :
+		{sysDevPath + "/queue/rotational", sysDevPath + "/../queue/rotational"} )
+	{
+		std::ifstream rotationalFile(rotationalPath);
+		int isRotational;
+
+		if(rotationalFile >> isRotational)
+			return isRotational ? DEV_THREADS_ROTATIONAL : 0;
+	}
+
+	return 0; // unknown, e.g. tmpfs
+}
+
+/**
+ * Scheduling statistics of a single device in the SharedStack.
+ */
+struct DevQueueStats
+{
+	uint64_t devID;
+	unsigned threadsLimit; // 0 for no limit
+	uint64_t numDirsPopped;
+	unsigned maxActiveThreads;
+};
+
+/**
+ * This is the stack for directories that were found by the breadth search threads. There is a
+ * separate stack per device (st_dev) with an optional limit of threads that scan dirs of the
+ * device at the same time. popWait() takes dirs from the device with the lowest utilization of its
+ * limit, so that a slow device can't hog all threads while a fast one starves.
+ */
+class SharedStack
+{
+	private:
+		struct StackElem
+		{
+			StackElem(const std::string& dirPath, unsigned short dirDepth) :
+				dirPath(dirPath), dirDepth(dirDepth) {}
+
+			std::string dirPath;
+			unsigned short dirDepth; // dirPath depth relative to start path
+		};
+
+		struct DevQueue
+		{
+			std::stack<StackElem> dirPathStack;
+			unsigned numActiveThreads {0}; // threads that currently scan a dir of this device
+			unsigned threadsLimit {0}; // max numActiveThreads (0 for no limit)
+			uint64_t numDirsPopped {0};
+			unsigned maxActiveThreads {0};
+		};
+
+	public:
+		SharedStack() {}
+
+	private:
+		std::map<uint64_t, DevQueue> devQueues; // key is device ID (st_dev)
+		std::mutex mutex;
+		std::condition_variable condition; // when new elems are pushed
+		unsigned numWaiters {0}; // detect termination when equal to number of threads
+		std::atomic_uint64_t stackSize {0}; // to get stack size lock-free
+		uint64_t maxStackSize {0}; // max stack size reached so far
+		std::atomic_bool isCancelled {false}; // true if scan should stop before the end of the tree
+		unsigned activeThreadsLimit {0}; // max threads outside of popWait (0 for no limit)
+
+		/**
+		 * @return true if the calling thread in popWait() may not take new work, because
+		 * 		activeThreadsLimit other threads are active.
+		 */
+		bool isActiveThreadsLimitReached()
+		{
+			return activeThreadsLimit && ( (config.numThreads - numWaiters) >= activeThreadsLimit);
+		}
+
+		/**
+		 * Find the device with queued dirs that has the lowest utilization of its threads limit.
+		 *
+		 * @return devQueues.end() if no device has queued dirs below its threads limit.
+		 */
+		std::map<uint64_t, DevQueue>::iterator pickDevQueue()
+		{
+			auto bestDevQueueIter = devQueues.end();
+			double bestUtilization = 0;
+
+			for(auto devQueueIter = devQueues.begin(); devQueueIter != devQueues.end();
+				devQueueIter++)
+			{
+				DevQueue& devQueue = devQueueIter->second;
+
+				if(devQueue.dirPathStack.empty() ||
+					(devQueue.threadsLimit &&
+						(devQueue.numActiveThreads >= devQueue.threadsLimit) ) )
+					continue;
+
+				double utilization = (double)devQueue.numActiveThreads /
+					(devQueue.threadsLimit ? devQueue.threadsLimit : config.numThreads);
+
+				if( (bestDevQueueIter == devQueues.end() ) || (utilization < bestUtilization) )
+				{
+					bestDevQueueIter = devQueueIter;
+					bestUtilization = utilization;
+				}
+			}
+
+			return bestDevQueueIter;
+		}
+
+		/**
+		 * Pop the top elem of the given non-empty device stack.
+		 */
+		void popFromDevQueue(DevQueue& devQueue, std::string& outDirPath,
+			unsigned short& outDirDepth)
+		{
+			StackElem& topElem = devQueue.dirPathStack.top();
+			outDirPath = topElem.dirPath;
+			outDirDepth = topElem.dirDepth;
+
+			devQueue.dirPathStack.pop();
+
+			stackSize--;
+		}
+
+	public:
+		/**
+		 * @devID st_dev of dirPath; DEV_ID_NONE if unknown.
+		 */
+		void push(const std::string& dirPath, unsigned short dirDepth,
+			uint64_t devID = DEV_ID_NONE)
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			auto devQueueIter = devQueues.find(devID);
+
+			if(devQueueIter == devQueues.end() )
+			{ // first dir of this device => get its threads limit (without blocking other threads)
+				lock.unlock();
+
+				unsigned threadsLimit = (devID == DEV_ID_NONE) ?
+					0 : getDevThreadsLimit(devID, dirPath);
+
+				lock.lock();
+
+				devQueueIter = devQueues.emplace(devID, DevQueue() ).first;
+				devQueueIter->second.threadsLimit = threadsLimit;
+			}
+
+			devQueueIter->second.dirPathStack.push(StackElem(dirPath, dirDepth) );
+
+			stackSize++;
+
+			maxStackSize = std::max(maxStackSize, stackSize.load() );
+
+			condition.notify_one();
+		}
+
+		/**
+		 * If stack is empty (or all devices with queued dirs are at their threads limit), this
+		 * waits for a new push.
+		 *
+		 * @inOutDevID in: device of the dir that the calling thread scanned before (DEV_ID_NONE
+		 * 		on first call); out: device of outDirPath, which the calling thread counts
+		 * 		against until its next call.
+		 * @return false if stack was empty, so outDirPath did not get assigned.
+		 * @throw ScanDoneException when all threads were waiting, so no thread was active anymore
+		 * 		to add more dirs to the queue; or when the scan was cancelled.
+		 */
+		bool popWait(std::string& outDirPath, unsigned short& outDirDepth, uint64_t& inOutDevID)
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			auto prevDevQueueIter = devQueues.find(inOutDevID);
+
+			if(prevDevQueueIter != devQueues.end() )
+			{ // calling thread is done with its previous device
+				DevQueue& prevDevQueue = prevDevQueueIter->second;
+
+				prevDevQueue.numActiveThreads--;
+
+				if(!prevDevQueue.dirPathStack.empty() )
+					condition.notify_one(); // (a waiter might have been blocked by the limit)
+			}
+
+			inOutDevID = DEV_ID_NONE;
+
+			numWaiters++;
+
+			auto devQueueIter = devQueues.end();
+
+			while(isCancelled || isActiveThreadsLimitReached() ||
+				( (devQueueIter = pickDevQueue() ) == devQueues.end() ) )
+			{
+				if(isCancelled)
+					throw ScanDoneException(); // (numWaiters doesn't matter anymore)
+
+				if( (numWaiters == config.numThreads) && !stackSize)
+				{ // all threads waiting => end of dir tree scan
+					// note: no numWaiters-- here, so that all threads see termination condition
+					condition.notify_all();
+					throw ScanDoneException();
+				}
+
+				condition.wait(lock);
+			}
+
+			numWaiters--;
+
+			DevQueue& devQueue = devQueueIter->second;
+
+			popFromDevQueue(devQueue, outDirPath, outDirDepth);
+
+			devQueue.numActiveThreads++;
+			devQueue.numDirsPopped++;
+			devQueue.maxActiveThreads =
+				std::max(devQueue.maxActiveThreads, devQueue.numActiveThreads);
+
+			inOutDevID = devQueueIter->first;
+
+			return true;
+		}
+
+		/**
+		 * Pop from any device without waiting and without counting the calling thread against
+		 * a device threads limit.
+		 *
+		 * @return false if stack was empty, so outDirPath did not get assigned.
+		 */
+		bool pop(std::string& outDirPath, unsigned short& outDirDepth)
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			for(auto& devQueueIter : devQueues)
+			{
+				if(devQueueIter.second.dirPathStack.empty() )
+					continue;
+
+				popFromDevQueue(devQueueIter.second, outDirPath, outDirDepth);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		/**
+		 * Stop the scan: Waiting threads wake up and all threads terminate in popWait(). Running
+		 * scans are expected to check isScanCancelled() and return.
+		 */
+		void cancel()
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			isCancelled = true;
+
+			condition.notify_all();
+		}
+
+		/**
+		 * Lock-free check whether cancel() was called.
+		 */
+		bool isScanCancelled() const
+		{
+			return isCancelled.load(std::memory_order_relaxed);
+		}
+
+		/**
+		 * @return number of threads that are currently waiting for new dirs in popWait().
+		 */
+		unsigned getNumWaiters()
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			return numWaiters;
+		}
+
+		/**
+		 * Limit the number of threads that take work from popWait(), e.g. for "--threads auto".
+		 * Threads above the limit finish their current dir and then wait in popWait().
+		 *
+		 * @limit 0 for no limit.
+		 */
+		void setActiveThreadsLimit(unsigned limit)
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			activeThreadsLimit = limit;
+
+			condition.notify_all();
+		}
+
+		/**
+		 * @return current limit of active threads; config.numThreads if no limit is set.
+		 */
+		unsigned getActiveThreadsLimit()
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			return activeThreadsLimit ? activeThreadsLimit : config.numThreads;
+		}
+
+		/**
+		 * @return scheduling statistics of all devices that had dirs in the stack.
+		 */
+		std::vector<DevQueueStats> getDevQueueStats()
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			std::vector<DevQueueStats> statsVec;
+
+			for(const auto& devQueueIter : devQueues)
+				statsVec.push_back(DevQueueStats{devQueueIter.first,
+					devQueueIter.second.threadsLimit, devQueueIter.second.numDirsPopped,
+					devQueueIter.second.maxActiveThreads} );
+
+			return statsVec;
+		}
+
+		/**
+		 * @return max stack size that was reached so far.
+		 */
+		uint64_t getMaxSize()
+		{
+			std::unique_lock<std::mutex> lock(mutex); // L O C K
+
+			return maxStackSize;
+		}
+
+		/**
+		 * Lock-free getter of current stack size.
+		 */
+		uint64_t getSize()
+		{
+			return stackSize;
+		}
+
+} sharedStack;
+
+/**
+ * Interface to the filesystem calls of scan(), copyEntry() and unlinkEntry(). This makes it
+ * possible to replace the real filesystem by a simulated one, e.g. to test scheduling behavior on
+ * high-latency network filesystems without having one.
+ *
+ * All methods follow the semantics of the corresponding POSIX calls, i.e. on error they return -1
+ * (or NULL) and set errno.
+ */
+class FileSystemBackend
+{
+	public:
+		virtual ~FileSystemBackend() {}
+
+		virtual int lstatPath(const char* path, struct stat* outStatBuf) = 0;
+
+		/**
+		 * @return opaque handle for readDir(), statAt() and closeDir(); NULL on error.
+		 */
+		virtual void* openDir(const char* path) = 0;
+
+		/**
+		 * @return NULL at end of dir (with errno unchanged) or on error (with errno set).
+		 */
+		virtual struct dirent* readDir(void* dirHandle) = 0;
+		virtual void closeDir(void* dirHandle) = 0;
+
+		/**
+		 * Get attributes of an entry in the given dir without following symlinks.
+		 */
+		virtual int statAt(void* dirHandle, const char* name, struct stat* outStatBuf) = 0;
+
+		virtual int openFile(const char* path, int flags, mode_t mode) = 0;
+		virtual ssize_t readFile(int fd, void* buf, size_t count) = 0;
+		virtual ssize_t writeFile(int fd, const void* buf, size_t count) = 0;
+		virtual int updateFileTimes(int fd, const struct timespec times[2]) = 0;
+		virtual int closeFile(int fd) = 0;
+
+		virtual int makeDir(const char* path, mode_t mode) = 0;
+		virtual ssize_t readLink(const char* path, char* buf, size_t bufSize) = 0;
+		virtual int makeSymlink(const char* targetPath, const char* linkPath) = 0;
+
+		/**
+		 * @flags 0 or AT_SYMLINK_NOFOLLOW.
+		 */
+		virtual int updateTimes(const char* path, const struct timespec times[2], int flags) = 0;
+		virtual int unlinkPath(const char* path) = 0;
+};
+
+/**
+ * Filesystem backend for the real filesystem through POSIX calls.
+ */
+class PosixFileSystemBackend : public FileSystemBackend
+{
+	public:
+		int lstatPath(const char* path, struct stat* outStatBuf) override
+		{
+			return lstat(path, outStatBuf);
+		}
+
+		void* openDir(const char* path) override
+		{
+			return opendir(path);
+		}
+
+		struct dirent* readDir(void* dirHandle) override
+		{
+			return readdir( (DIR*)dirHandle);
+		}
+
+		void closeDir(void* dirHandle) override
+		{
+			closedir( (DIR*)dirHandle);
+		}
+
+		int statAt(void* dirHandle, const char* name, struct stat* outStatBuf) override
+		{
+			return fstatat(dirfd( (DIR*)dirHandle), name, outStatBuf, AT_SYMLINK_NOFOLLOW);
+		}
+
+		int openFile(const char* path, int flags, mode_t mode) override
+		{
+			return open(path, flags, mode);
+		}
+
+		ssize_t readFile(int fd, void* buf, size_t count) override
+		{
+			return read(fd, buf, count);
+		}
+
+		ssize_t writeFile(int fd, const void* buf, size_t count) override
+		{
+			return write(fd, buf, count);
+		}
+
+		int updateFileTimes(int fd, const struct timespec times[2]) override
+		{
+			return futimens(fd, times);
+		}
+
+		int closeFile(int fd) override
+		{
+			return close(fd);
+		}
+
+		int makeDir(const char* path, mode_t mode) override
+		{
+			return mkdir(path, mode);
+		}
+
+		ssize_t readLink(const char* path, char* buf, size_t bufSize) override
+		{
+			return readlink(path, buf, bufSize);
+		}
+
+		int makeSymlink(const char* targetPath, const char* linkPath) override
+		{
+			return symlink(targetPath, linkPath);
+		}
+
+		int updateTimes(const char* path, const struct timespec times[2], int flags) override
+		{
+			return utimensat(AT_FDCWD, path, times, flags);
+		}
+
+		int unlinkPath(const char* path) override
+		{
+			return unlink(path);
+		}
+};
+
+/**
+ * In-memory filesystem backend that simulates a tree of the shape given by SyntheticFsConfig
+ * below each scan path. Each dir contains files "f0", "f1", ... and (if not at max depth) subdirs
+ * "d0", "d1", ... Nothing gets stored: the tree is implicitly defined by the path names, so it
+ * can be arbitrarily large. Each call gets delayed by the configured latency and fails with the
+ * configured error rate. Writes (e.g. for copies) are accepted and discarded.
+ */
+class SyntheticFileSystemBackend : public FileSystemBackend
+{
+	private:
+		struct SyntheticDir
+		{
+			std::string path;
+			unsigned dirDepth; // relative to root path
+			uint64_t nextEntryIndex {0}; // files first, then subdirs
+			struct dirent dirEntry; // returned by readDir()
+		};
+
+		struct SyntheticFile
+		{
+			uint64_t size; // 0 for files opened for writing
+			uint64_t offset {0}; // current read offset
+		};
+
+	public:
+		/**
+		 * @rootPaths the paths at which synthetic trees get rooted, typically the scan paths.
+		 */
+		SyntheticFileSystemBackend(const SyntheticFsConfig& syntheticFsConfig,
+			const std::list<std::string>& rootPaths) : syntheticFsConfig(syntheticFsConfig)
+		{
+			for(std::string rootPath : rootPaths)
+			{
+				while( (rootPath.length() > 1) && (rootPath.back() == '/') )
+					rootPath.pop_back();
+
+				this->rootPaths.push_back(rootPath);
+			}
+		}
+
+	private:
+		SyntheticFsConfig syntheticFsConfig;
+		StringVec rootPaths; // without trailing slashes
+		std::unordered_map<int, SyntheticFile> openFiles; // key is fake file descriptor
+		int nextFD {3}; // next fake file descriptor to hand out
+		std::mutex openFilesMutex; // protects openFiles and nextFD
+		std::atomic_uint64_t numRandGens {0}; // to seed thread-local random generators
+
+		/**
+		 * Simulate the latency of a filesystem call and decide whether it fails.
+		 *
+		 * @return false if an error got injected, in which case errno is set.
+		 */
+		bool simulateCall()
+		{
+			thread_local std::mt19937_64 randGen(syntheticFsConfig.seed + numRandGens++);
+
+			int64_t delayNanoSecs = syntheticFsConfig.latencyNanoSecs;
+
+			if(syntheticFsConfig.jitterNanoSecs)
+			{
+				std::uniform_int_distribution<int64_t> jitterDist(
+					-(int64_t)syntheticFsConfig.jitterNanoSecs,
+					syntheticFsConfig.jitterNanoSecs);
+
+				delayNanoSecs = std::max( (int64_t)0, delayNanoSecs + jitterDist(randGen) );
+			}
+
+			if(delayNanoSecs)
+				std::this_thread::sleep_for(std::chrono::nanoseconds(delayNanoSecs) );
+
+			if(syntheticFsConfig.errorRate > 0)
+			{
+				std::uniform_real_distribution<double> errorDist(0, 1);
+
+				if(errorDist(randGen) < syntheticFsConfig.errorRate)
+				{
+					errno = syntheticFsConfig.errorNum;
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		/**
+		 * Parse a name of the form PREFIX + index, e.g. "d12".
+		 *
+		 * @return false if name doesn't have the given prefix or index is not below numIndices.
+		 */
+		static bool parseEntryName(const std::string& name, char prefix, uint64_t numIndices)
+		{
+			if( (name.length() < 2) || (name[0] != prefix) ||
+				(name.find_first_not_of("0123456789", 1) != std::string::npos) ||
+				( (name[1] == '0') && (name.length() > 2) ) ) // no leading zeros
+				return false;
+
+			return std::stoull(name.substr(1) ) < numIndices;
+		}
+
+		/**
+		 * Find the entry of the synthetic tree for the given path.
+		 *
+		 * @outRootIndex may be NULL; index of the root path that the entry belongs to.
+		 * @return false if path doesn't exist in the tree, in which case errno is set.
+		 */
+		bool resolvePath(std::string path, bool& outIsDir, unsigned& outDirDepth,
+			unsigned* outRootIndex = NULL) const
+		{
+			while( (path.length() > 1) && (path.back() == '/') )
+				path.pop_back();
+
+			for(unsigned rootIndex = 0; rootIndex < rootPaths.size(); rootIndex++)
+			{
+				const std::string& rootPath = rootPaths[rootIndex];
+
+				if(outRootIndex)
+					*outRootIndex = rootIndex;
+
+				if(path.compare(0, rootPath.length(), rootPath) )
+					continue; // root path is not a prefix
+
+				if(path.length() == rootPath.length() )
+				{ // path is the root dir itself
+					outIsDir = true;
+					outDirDepth = 0;
+					return true;
+				}
+
+				if( (path[rootPath.length()] != '/') && (rootPath != "/") )
+					continue; // prefix ends in the middle of a path component
+
+				std::stringstream relativePathStream(path.substr(rootPath.length() ) );
+				std::string name;
+				unsigned dirDepth = 0;
+				bool isFile = false;
+				bool isFound = true;
+
+				while(isFound && std::getline(relativePathStream, name, '/') )
+				{
+					if(name.empty() )
+						continue; // (leading slash or double slashes)
+
+					if(isFile)
+						isFound = false; // file can't have subdirs
+					else
+					if( (dirDepth < syntheticFsConfig.depth) &&
+						parseEntryName(name, 'd', syntheticFsConfig.fanout) )
+						dirDepth++;
+					else
+					if(parseEntryName(name, 'f', syntheticFsConfig.filesPerDir) )
+						isFile = true;
+					else
+						isFound = false;
+				}
+
+				if(!isFound)
+					continue; // not found under this root
+
+				outIsDir = !isFile;
+				outDirDepth = dirDepth;
+				return true;
+			}
+
+			errno = ENOENT;
+			return false;
+		}
+
+		/**
+		 * Fill statBuf for an entry of the synthetic tree. Each root path is a separate device.
+		 */
+		void fillStatBuf(const std::string& path, bool isDir, unsigned rootIndex,
+			struct stat* outStatBuf) const
+		{
+			memset(outStatBuf, 0, sizeof(*outStatBuf) );
+
+			outStatBuf->st_dev = SYNTHETIC_FS_DEV_ID + rootIndex;
+			outStatBuf->st_ino = std::hash<std::string>{}(path);
+			outStatBuf->st_mode = isDir ? (S_IFDIR | 0755) : (S_IFREG | 0644);
+			outStatBuf->st_nlink = isDir ? 2 : 1;
+			outStatBuf->st_uid = getuid();
+			outStatBuf->st_gid = getgid();
+			outStatBuf->st_size = isDir ? SYNTHETIC_FS_DIR_SIZE : syntheticFsConfig.fileSize;
+			outStatBuf->st_blksize = 4096;
+			outStatBuf->st_blocks = (outStatBuf->st_size + 511) / 512;
+			outStatBuf->st_atim.tv_sec = state.startTimeSecs;
+			outStatBuf->st_mtim.tv_sec = state.startTimeSecs;
+			outStatBuf->st_ctim.tv_sec = state.startTimeSecs;
+		}
+
+	public:
+		int lstatPath(const char* path, struct stat* outStatBuf) override
+		{
+			bool isDir;
+			unsigned dirDepth;
+			unsigned rootIndex;
+
+			if(!simulateCall() || !resolvePath(path, isDir, dirDepth, &rootIndex) )
+				return -1;
+
+			fillStatBuf(path, isDir, rootIndex, outStatBuf);
+
+			return 0;
+		}
+
+		void* openDir(const char* path) override
+		{
+			bool isDir;
+			unsigned dirDepth;
+
+			if(!simulateCall() || !resolvePath(path, isDir, dirDepth) )
+				return NULL;
+
+			if(!isDir)
+			{
+				errno = ENOTDIR;
+				return NULL;
+			}
+
+			SyntheticDir* dir = new SyntheticDir;
+
+			dir->path = path;
+			dir->dirDepth = dirDepth;
+
+			return dir;
+		}
+
+		struct dirent* readDir(void* dirHandle) override
+		{
+			SyntheticDir* dir = (SyntheticDir*)dirHandle;
+
+			const uint64_t numSubdirs = (dir->dirDepth < syntheticFsConfig.depth) ?
+				syntheticFsConfig.fanout : 0;
+
+			if(dir->nextEntryIndex >= (syntheticFsConfig.filesPerDir + numSubdirs) )
+				return NULL; // end of dir
+
+			if(!simulateCall() )
+				return NULL;
+
+			bool isFile = (dir->nextEntryIndex < syntheticFsConfig.filesPerDir);
+			uint64_t nameIndex = isFile ?
+				dir->nextEntryIndex : (dir->nextEntryIndex - syntheticFsConfig.filesPerDir);
+
+			memset(&dir->dirEntry, 0, sizeof(dir->dirEntry) );
+
+			dir->dirEntry.d_type = isFile ? DT_REG : DT_DIR;
+			snprintf(dir->dirEntry.d_name, sizeof(dir->dirEntry.d_name), "%c%" PRIu64,
+				isFile ? 'f' : 'd', nameIndex);
+
+			dir->nextEntryIndex++;
+
+			return &dir->dirEntry;
+		}
+
+		void closeDir(void* dirHandle) override
+		{
+			delete (SyntheticDir*)dirHandle;
+		}
+
+		int statAt(void* dirHandle, const char* name, struct stat* outStatBuf) override
+		{
+			SyntheticDir* dir = (SyntheticDir*)dirHandle;
+
+			return lstatPath( (dir->path + "/" + name).c_str(), outStatBuf);
+		}
+
+		int openFile(const char* path, int flags, mode_t mode) override
+		{
+			if(!simulateCall() )
+				return -1;
+
+			SyntheticFile file;
+
+			if( (flags & O_ACCMODE) == O_RDONLY)
+			{
+				bool isDir;
+				unsigned dirDepth;
+
+				if(!resolvePath(path, isDir, dirDepth) )
+					return -1;
+
+				file.size = isDir ? 0 : syntheticFsConfig.fileSize;
+			}
+			else
+				file.size = 0; // writes get discarded
+
+			std::unique_lock<std::mutex> lock(openFilesMutex); // L O C K
+
+			int fd = nextFD++;
+
+			openFiles[fd] = file;
+
+			return fd;
+		}
+
+		ssize_t readFile(int fd, void* buf, size_t count) override
+		{
+			if(!simulateCall() )
+				return -1;
+
+			std::unique_lock<std::mutex> lock(openFilesMutex); // L O C K
+
+			auto fileIter = openFiles.find(fd);
+			if(fileIter == openFiles.end() )
+			{
+				errno = EBADF;
+				return -1;
+			}
+
+			SyntheticFile& file = fileIter->second;
+
+			size_t readLen = std::min( (uint64_t)count, file.size - file.offset);
+
+			file.offset += readLen;
+
+			lock.unlock();
+
+			memset(buf, 0, readLen);
+
+			return readLen;
+		}
+
+		ssize_t writeFile(int fd, const void* buf, size_t count) override
+		{
+			return simulateCall() ? count : -1;
+		}
+
+		int updateFileTimes(int fd, const struct timespec times[2]) override
+		{
+			return simulateCall() ? 0 : -1;
+		}
+
+		int closeFile(int fd) override
+		{
+			std::unique_lock<std::mutex> lock(openFilesMutex); // L O C K
+
+			if(!openFiles.erase(fd) )
+			{
+				errno = EBADF;
+				return -1;
+			}
+
+			return 0;
+		}
+
+		int makeDir(const char* path, mode_t mode) override
+		{
+			return simulateCall() ? 0 : -1;
+		}
+
+		ssize_t readLink(const char* path, char* buf, size_t bufSize) override
+		{
+			if(simulateCall() )
+				errno = EINVAL; // no symlinks in synthetic tree
+
+			return -1;
+		}
+
+		int makeSymlink(const char* targetPath, const char* linkPath) override
+		{
+			return simulateCall() ? 0 : -1;
+		}
+
+		int updateTimes(const char* path, const struct timespec times[2], int flags) override
+		{
+			return simulateCall() ? 0 : -1;
+		}
+
+		int unlinkPath(const char* path) override
+		{
+			bool isDir;
+			unsigned dirDepth;
+
+			if(!simulateCall() || !resolvePath(path, isDir, dirDepth) )
+				return -1;
+
+			if(isDir)
+			{
+				errno = EISDIR;
+				return -1;
+			}
+
+			return 0;
+		}
+};
+
+std::unique_ptr<FileSystemBackend> fsBackend(new PosixFileSystemBackend() );
+
+/**
+ * Check ACL of given file or dir.
+ *
+ * @path: path to entry for which ACLs should be checked.
+ * @isDirectory: true of given entry is a directory.
+ */
+void checkACLs(const char* path, bool isDirectory)
+{
+	if(!config.checkACLs)
+		return; // nothing to do
+
+	SyscallTimer getAccessTimer(SyscallType_GETXATTR);
+	ssize_t getAccessRes = lgetxattr(path, "system.posix_acl_access", NULL, 0);
+	getAccessTimer.stop();
+
+	if(getAccessRes >= 0)
+		statistics.numAccessACLsFound++;
+	else
+	if( (errno != ENODATA) && (errno != ENOTSUP) )
+		fprintf(stderr, "Failed to get Access ACL for entry: %s; Error: %s\n",
+			path, strerror(errno) );
+
+	// dirs have additional default ACL check
+	if(isDirectory)
+	{
+		SyscallTimer getDefaultTimer(SyscallType_GETXATTR);
+		ssize_t getDefaultRes = lgetxattr(path, "system.posix_acl_default", NULL, 0);
+		getDefaultTimer.stop();
+
+		if(getDefaultRes >= 0)
+			statistics.numAccessACLsFound++;
+		else
+		if( (errno != ENODATA) && (errno != ENOTSUP) )
+			fprintf(stderr, "Failed to get Default ACL for dir: %s; Error: %s\n",
+				path, strerror(errno) );
+	}
+}
+
+/**
+ * Add escape characters to make a string usable in JSON.
+ *
+ * @string input string to convert
+ * @return copy of input string with escaped
+ */
+std::string escapeStrforJSON(const std::string &string)
+{
+	std::ostringstream stringStream;
+
+	for (const auto& currentChar : string)
+	{
+		/* the case statments are the typical shortcut escapes, the "default" statment handles
+			generic escapes */
+		switch (currentChar)
+		{
+			case '"':
+				stringStream << "\\\"";
+			break;
+			case '\\':
+				stringStream << "\\\\";
+			break;
+			case '\b':
+				stringStream << "\\b";
+			break;
+			case '\f':
+				stringStream << "\\f";
+			break;
+			case '\n':
+				stringStream << "\\n";
+			break;
+			case '\r':
+				stringStream << "\\r";
+			break;
+			case '\t':
+				stringStream << "\\t";
+			break;
+
+			default:
+				if('\x00' <= currentChar && currentChar <= '\x1f')
+				{ // escape this character
+					stringStream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+							<< static_cast<int>(currentChar);
+				}
+				else
+				{ // nothing to escape
+					stringStream << currentChar;
+				}
+		}
+	}
+
+	return stringStream.str();
+}
+
+/**
+ * Filter printed entries by user-defined entry type.
+ *
+ * If entry type cannot be determined and a user-defined filter is set then this returns false.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByType(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(!config.searchType)
+		return true; // no filter defined by user => always passes
+
+	if(dirEntry && (dirEntry->d_type != DT_UNKNOWN) )
+	{
+		char matchType = 0; // values taken from "man find(1)"
+
+		switch(dirEntry->d_type)
+		{
+			case DT_BLK: 	matchType = 'b'; break;
+			case DT_CHR: 	matchType = 'c'; break;
+			case DT_DIR: 	matchType = 'd'; break;
+			case DT_FIFO: 	matchType = 'p'; break;
+			case DT_LNK: 	matchType = 'l'; break;
+			case DT_REG: 	matchType = 'f'; break;
+			case DT_SOCK: 	matchType = 's'; break;
+		}
+
+		if(matchType == config.searchType)
+			return true;
+
+		return false;
+	}
+
+	if(statBuf)
+	{
+		char matchType = 0; // values taken from "man find(1)"
+
+		if(S_ISBLK(statBuf->st_mode) )
+			matchType = 'b';
+		else
+		if(S_ISCHR(statBuf->st_mode) )
+			matchType = 'c';
+		else
+		if(S_ISDIR(statBuf->st_mode) )
+			matchType = 'd';
+		else
+		if(S_ISFIFO(statBuf->st_mode) )
+			matchType = 'p';
+		else
+		if(S_ISLNK(statBuf->st_mode) )
+			matchType = 'l';
+		else
+		if(S_ISREG(statBuf->st_mode) )
+			matchType = 'f';
+		else
+		if(S_ISSOCK(statBuf->st_mode) )
+			matchType = 's';
+
+		if(matchType == config.searchType)
+			return true;
+
+		return false;
+	}
+
+	// we have neither d_type nor statBuf and a filter has been definded
+	fprintf(stderr, "Cannot identify type of entry. Path: %s\n", entryPath.c_str() );
+
+	return false;
+}
+
+/**
+ * Filter printed files by user-defined filename pattern.
+ *
+ * If entry type cannot be determined and a user-defined filter is set then this returns false.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByName(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(config.nameFilterVec.empty() )
+		return true; // no filter defined by user => always passes
+
+	// check whether any of the given filter names matches
+
+	std::string currentFilename = std::filesystem::path(entryPath).filename().string();
+
+	for(std::string& nameFilter : config.nameFilterVec)
+	{
+		int matchRes = fnmatch(nameFilter.c_str(), currentFilename.c_str(), 0 /* flags */);
+
+		if(!matchRes)
+			return true; // we have a match
+	}
+
+	return false;
+}
+
+/**
+ * Filter printed files by user-defined path pattern.
+ *
+ * If entry type cannot be determined and a user-defined filter is set then this returns false.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByPath(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(config.pathFilter.empty() )
+		return true; // no filter defined by user => always passes
+
+	bool isFile =
+		(dirEntry && (dirEntry->d_type != DT_UNKNOWN) && (dirEntry->d_type != DT_DIR) ) ||
+		(statBuf && !S_ISDIR(statBuf->st_mode) );
+
+	if(!isFile)
+		return false; // anything that's not a file can't match
+
+	int matchRes = fnmatch(config.pathFilter.c_str(), entryPath.c_str(), 0 /* flags */);
+
+	if(!matchRes)
+		return true; // we have a match
+
+	return false;
+}
+
+/**
+ * Check for size or timestamp exact/less/greater match.
+ * This returns false if a filter is defined that doesn't match. Otherwise it will run through
+ * without calling "return".
+ * Note that there can be more than one filter defined, so this can't return true on first match.
+ * Example: CHECK_EXACT_LESS_GREATER_VAL(atime, ATIME, atim.tv_sec)
+ */
+#define _CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField) \
+		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _EXACT) \
+			if( (uint64_t)statBuf->st_ ## statBufField != config.filterSizeAndTime.lowercaseCfgName ## Exact) \
+				return false; \
+		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _LESS) \
+			if( (uint64_t)statBuf->st_ ## statBufField >= config.filterSizeAndTime.lowercaseCfgName ## Less) \
+				return false; \
+		if(config.filterSizeAndTime.filterSizeAndTimeFlags & FILTER_FLAG_ ## uppercaseCfgName ## _GREATER) \
+			if( (uint64_t)statBuf->st_ ## statBufField <= config.filterSizeAndTime.lowercaseCfgName ## Greater) \
+				return false;
+#define CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField) \
+		_CHECK_EXACT_LESS_GREATER_VAL(lowercaseCfgName, uppercaseCfgName, statBufField)
+
+
+/**
+ * Filter printed files by user-defined size or timestamp.
+ *
+ * This requires stat() info.
+ *
+ * If entry type cannot be determined and a user-defined filter is set then this returns false.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryBySizeOrTime(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(!config.filterSizeAndTime.filterSizeAndTimeFlags)
+		return true; // no filter defined by user => always passes
+
+	bool isFile =
+		(dirEntry && (dirEntry->d_type != DT_UNKNOWN) && (dirEntry->d_type != DT_DIR) ) ||
+		(statBuf && !S_ISDIR(statBuf->st_mode) );
+
+	if(!isFile)
+		return false; // anything that's not a file can't match
+
+	if(!statBuf)
+		return false; // can't filter without stat() info
+
+	// the macro will return false if a defined filter doesn't match, otherwise it runs through.
+	CHECK_EXACT_LESS_GREATER_VAL(size, SIZE, size);
+	CHECK_EXACT_LESS_GREATER_VAL(atime, ATIME, atim.tv_sec);
+	CHECK_EXACT_LESS_GREATER_VAL(ctime, CHANGETIME, ctim.tv_sec);
+	CHECK_EXACT_LESS_GREATER_VAL(mtime, MTIME, mtim.tv_sec);
+
+	return true; // all filters passed
+}
+
+/**
+ * Filter printed files by user-defined UID and GID.
+ *
+ * This requires stat() info.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByUIDAndGID(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	// filter UID
+	if(config.filterUID != ~0ULL)
+	{
+		if(!statBuf || (statBuf->st_uid != config.filterUID) )
+			return false; // either no statBuf or UID mismatch
+	}
+
+	// filter GID
+	if(config.filterGID != ~0ULL)
+	{
+		if(!statBuf || (statBuf->st_gid != config.filterGID) )
+			return false; // either no statBuf or GID mismatch
+	}
+
+	return true;
+}
+
+
+/**
+ * Replace all occurrences of EXEC_ARG_PATH_PLACEHOLDER in "subject" string with the given "path"
+ * string.
+ */
+void replacePathPlaceholerWithPath(std::string& subject, const std::string& path)
+{
+    size_t pos = 0;
+
+    while( (pos = subject.find(EXEC_ARG_PATH_PLACEHOLDER, pos) ) != std::string::npos)
+    {
+         subject.replace(pos, strlen(EXEC_ARG_PATH_PLACEHOLDER), path);
+         pos += path.length();
+    }
+}
+
+/**
+ * Execute user-given system command for discovered entry.
+ */
+void execSystemCommand(const std::string& entryPath)
+{
+	if(config.exec.cmdLineStrVec.empty() )
+		return; // nothing to do
+
+	std::string commandStr;
+
+	// add executable
+	commandStr.append("'");
+	commandStr.append(config.exec.cmdLineStrVec[0] );
+	commandStr.append("' ");
+
+	// add args and replace placeholder with path
+	for(size_t i=1; i < config.exec.cmdLineStrVec.size(); i++)
+	{
+		std::string argStr(config.exec.cmdLineStrVec[i] );
+
+		replacePathPlaceholerWithPath(argStr, entryPath);
+
+		commandStr.append("'");
+		commandStr.append(argStr);
+		commandStr.append("' ");
+	}
+
+	// flush is necessary for cases where stdout is not line-buffered, e.g. because it's not a tty.
+	fflush(stdout);
+
+	int sysRes = std::system(commandStr.c_str() );
+	if(WIFSIGNALED(sysRes) )
+	{
+		fprintf(stderr, "Aborting because exec command terminated on signal. "
+			"Signal: %d; Path: %s\n", (int)WTERMSIG(sysRes), entryPath.c_str() );
+
+		// note: we really need SIGTERM here, as SIGINT does not reliably kill running system cmds
+		kill(0, SIGTERM);
+	}
+}
+
+/**
+ * Copy entry if it's a regular file, dir or symlink; skip others.
+ * This won't preserve hardlinks.
+ */
+void copyEntry(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(config.copyDestDir.empty() )
+		return;
+
+	TraceSpan copySpan(TraceEventType_COPY, entryPath);
+	copySpan.addToValue(statBuf->st_size);
+
+	std::string relativeEntryPath = entryPath.substr(config.scanPaths.front().length() );
+	std::string destPath = config.copyDestDir + "/" + relativeEntryPath;
+
+	if(config.printVerbose)
+		fprintf(stderr, "Copying: %s -> %s\n", entryPath.c_str(), destPath.c_str() );
+
+	// config.statAll is forced to true when config.copyDestDir is set
+
+	if(S_ISDIR(statBuf->st_mode) )
+	{ // create directory
+		SyscallTimer mkdirTimer(SyscallType_MKDIR);
+		int mkRes = fsBackend->makeDir(destPath.c_str(),
+				(statBuf->st_mode & 0777) | ( S_IRUSR | S_IWUSR | S_IXUSR) ); // user always rwx
+		mkdirTimer.stop();
+		if( (mkRes == -1) && (errno != EEXIST) )
+		{
+			fprintf(stderr, "Failed to create dir: %s; Error: %s\n",
+				destPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+
+		if(config.copyTimeUpdate)
+		{ // update timestamps
+			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+
+			int updateTimeRes = fsBackend->updateTimes(destPath.c_str(), newTimes, 0);
+			if(updateTimeRes == -1)
+			{
+				fprintf(stderr, "Failed to update timestamps of copy destination dir: %s; "
+					"Error: %s\n", destPath.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+			}
+		}
+	}
+	else
+	if(S_ISLNK(statBuf->st_mode) )
+	{ // copy symlink
+		const unsigned bufSize = 16*1024; // 16KiB copy buffer
+		char* buf = (char*)malloc(bufSize);
+
+		if(!buf)
+		{
+			fprintf(stderr, "Failed to allocate memory buffer for symlink copy. Alloc size: %u\n",
+				bufSize);
+
+			exit(EXIT_FAILURE);
+		}
+
+		ssize_t readRes = fsBackend->readLink(entryPath.c_str(), buf, bufSize);
+		if(readRes == bufSize)
+		{
+			fprintf(stderr, "Failed to copy symlink due to long target path: %s; Max: %u\n",
+				entryPath.c_str(), bufSize);
+
+			statistics.numErrors++;
+			free(buf);
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+		else
+		if(readRes == -1)
+		{
+			fprintf(stderr, "Failed to read symlink for copying: %s; Error: %s\n",
+				entryPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+			free(buf);
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+
+		// readLink() does not zero-terminate the string in buf
+		buf[readRes] = 0;
+
+		int linkRes = fsBackend->makeSymlink(buf, destPath.c_str() );
+		if( (linkRes == -1) && (errno == EEXIST) )
+		{ // symlink can't overwrite existing file, so unlink and try again
+			fsBackend->unlinkPath(destPath.c_str() );
+
+			linkRes = fsBackend->makeSymlink(buf, destPath.c_str() );
+		}
+
+		if(linkRes == -1)
+		{
+			fprintf(stderr, "Failed to create symlink for copying: %s; Error: %s\n",
+				destPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+			free(buf);
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+
+		if(config.copyTimeUpdate)
+		{ // update timestamps
+			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+
+			int updateTimeRes = fsBackend->updateTimes(destPath.c_str(), newTimes,
+				AT_SYMLINK_NOFOLLOW);
+			if(updateTimeRes == -1)
+			{
+				fprintf(stderr, "Failed to update timestamps of copy destination symlink: %s; "
+					"Error: %s\n", destPath.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+			}
+		}
+
+		// symlink copy done => cleanup
+		free(buf);
+	}
+	else
+	if(S_ISREG(statBuf->st_mode) )
+	{ // copy regular file
+		// (no atime update simiar to "cp -a" behavior)
+		SyscallTimer openSourceTimer(SyscallType_OPEN);
+		int sourceFD = fsBackend->openFile(entryPath.c_str(), O_RDONLY | O_NOATIME, 0);
+		openSourceTimer.stop();
+		if(sourceFD == -1)
+		{
+			fprintf(stderr, "Failed to open copy source file for reading: %s; Error: %s\n",
+				entryPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+
+		SyscallTimer openDestTimer(SyscallType_OPEN);
+		int destFD = fsBackend->openFile(destPath.c_str(), O_CREAT | O_TRUNC | O_WRONLY,
+			(statBuf->st_mode & 0777) | ( S_IRUSR | S_IWUSR) ); // user/owner can always read+write
+		openDestTimer.stop();
+		if(destFD == -1)
+		{
+			fprintf(stderr, "Failed to open copy destination file for writing: %s; Error: %s\n",
+				destPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+			fsBackend->closeFile(sourceFD);
+
+			EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+		}
+
+		const unsigned bufSize = 4*1024*1024; // 4MiB copy buffer
+		char* buf = (char*)malloc(bufSize);
+		ssize_t readRes;
+
+		if(!buf)
+		{
+			fprintf(stderr, "Failed to allocate memory buffer for file copy. Alloc size: %u\n",
+				bufSize);
+
+			exit(EXIT_FAILURE);
+		}
+
+		// copy file contents
+		for( ; ; )
+		{
+			SyscallTimer readTimer(SyscallType_READ);
+			readRes = fsBackend->readFile(sourceFD, buf, bufSize);
+			readTimer.stop();
+			if(!readRes)
+				break;
+			else
+			if(readRes == -1)
+			{
+				fprintf(stderr, "Failed to read from copy source file: %s; Error: %s\n",
+					entryPath.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+				fsBackend->closeFile(sourceFD);
+				fsBackend->closeFile(destFD);
+				free(buf);
+
+				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+			}
+
+			SyscallTimer writeTimer(SyscallType_WRITE);
+			ssize_t writeRes = fsBackend->writeFile(destFD, buf, readRes);
+			writeTimer.stop();
+			if(writeRes == -1)
+			{
+				fprintf(stderr, "Failed to write to copy destination file: %s; Error: %s\n",
+					destPath.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+				fsBackend->closeFile(sourceFD);
+				fsBackend->closeFile(destFD);
+				free(buf);
+
+				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+			}
+			else
+			if(readRes != writeRes)
+			{
+				fprintf(stderr, "Failed to write to copy destination file: %s; "
+					"Expected write size: %zd; Actual write size: %zd\n",
+					destPath.c_str(), readRes, writeRes);
+
+				statistics.numErrors++;
+				fsBackend->closeFile(sourceFD);
+				fsBackend->closeFile(destFD);
+				free(buf);
+
+				EXIT_OR_RETURN_CONFIGURABLE(config.ignoreCopyErrors);
+			}
+
+			statistics.numBytesCopied += writeRes;
+		}
+
+		if(config.copyTimeUpdate)
+		{ // update timestamps
+			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+
+			int updateTimeRes = fsBackend->updateFileTimes(destFD, newTimes);
+			if(updateTimeRes == -1)
+			{
+				fprintf(stderr, "Failed to update timestamps of copy destination file: %s; "
+					"Error: %s\n", destPath.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+			}
+		}
+
+		// regular file copy complete => cleanup
+		fsBackend->closeFile(sourceFD);
+		fsBackend->closeFile(destFD);
+		free(buf);
+	}
+	else
+	{
+		fprintf(stderr, "Skipping copy of entry due to non-regular file type. "
+			"Path: %s\n", entryPath.c_str() );
+		statistics.numFilesNotCopied++;
+	}
+}
+
+/**
+ * Unlink entry if it's not a directory.
+ */
+void unlinkEntry(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(!config.unlinkFiles)
+		return;
+
+	// config.statAll is forced to true when config.unlinkFiles is set
+
+	if(S_ISDIR(statBuf->st_mode) )
+		return;
+
+	if(config.printVerbose)
+		fprintf(stderr, "Unlinking: %s\n", entryPath.c_str() );
+
+	SyscallTimer unlinkTimer(SyscallType_UNLINK);
+	int unlinkRes = fsBackend->unlinkPath(entryPath.c_str() );
+	unlinkTimer.stop();
+	if(unlinkRes == -1)
+	{
+		fprintf(stderr, "Failed to unlink file: %s; Error: %s\n",
+			entryPath.c_str(), strerror(errno) );
+
+		statistics.numErrors++;
+
+		EXIT_OR_RETURN_CONFIGURABLE(config.ignoreUnlinkErrors);
+	}
+}
+
+/**
+ * Open a file for reading its contents. Tries to avoid atime updates.
+ *
+ * @return file descriptor or -1 on error, in which case an error message was already printed.
+ */
+int openFileForReading(const std::string& path)
+{
+	SyscallTimer openTimer(SyscallType_OPEN);
+
+	int fd = open(path.c_str(), O_RDONLY | O_NOATIME);
+	if( (fd == -1) && (errno == EPERM) )
+		fd = open(path.c_str(), O_RDONLY); // O_NOATIME is only allowed for owner
+
+	openTimer.stop();
+
+	if(fd == -1)
+		fprintf(stderr, "Failed to open file for reading: %s; Error: %s\n",
+			path.c_str(), strerror(errno) );
+
+	return fd;
+}
+
+/**
+ * Read the contents of a file sequentially in chunks of up to FILE_READ_BUF_SIZE and hand each
+ * chunk to the given function.
+ *
+ * @chunkFunc returns false to stop reading before the end of the file is reached.
+ * @return false on error, in which case an error message was already printed.
+ */
+bool readFileContents(const std::string& path,
+	std::function<bool(const char* buf, size_t len)> chunkFunc)
+{
+	int fd = openFileForReading(path);
+	if(fd == -1)
+		return false;
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	char* buf = getThreadFileReadBuf();
+
+	for( ; ; )
+	{
+		SyscallTimer readTimer(SyscallType_READ);
+		ssize_t readRes = read(fd, buf, FILE_READ_BUF_SIZE);
+		readTimer.stop();
+		if(!readRes)
+			break; // end of file
+		else
+		if(readRes == -1)
+		{
+			fprintf(stderr, "Failed to read file contents: %s; Error: %s\n",
+				path.c_str(), strerror(errno) );
+
+			close(fd);
+			return false;
+		}
+
+		statistics.numBytesRead += readRes;
+
+		if(!chunkFunc(buf, readRes) )
+			break; // caller is not interested in the rest of the file
+	}
+
+	close(fd);
+
+	return true;
+}
+
+/**
+ * Filter printed files by their type detected from magic bytes. This reads the first
+ * MAGIC_READ_LEN bytes of the file, so it should come after the cheap filters.
+ *
+ * @contentInfo magicType gets set.
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByMagic(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf, EntryContentInfo& contentInfo)
+{
+	if(config.magicTypes.empty() )
+		return true; // no filter defined by user => always passes
+
+	bool isRegularFile =
+		(dirEntry && (dirEntry->d_type == DT_REG) ) ||
+		(statBuf && S_ISREG(statBuf->st_mode) );
+
+	if(!isRegularFile)
+		return false; // only regular files have contents to detect type
+
+	int fd = openFileForReading(entryPath);
+	if(fd == -1)
+	{
+		statistics.numErrors++;
+		return false;
+	}
+
+	unsigned char buf[MAGIC_READ_LEN];
+	size_t bufLen = 0;
+
+	while(bufLen < MAGIC_READ_LEN)
+	{
+		ssize_t readRes = read(fd, &buf[bufLen], MAGIC_READ_LEN - bufLen);
+		if(!readRes)
+			break; // end of file
+		else
+		if(readRes == -1)
+		{
+			fprintf(stderr, "Failed to read file contents: %s; Error: %s\n",
+				entryPath.c_str(), strerror(errno) );
+
+			statistics.numErrors++;
+			close(fd);
+			return false;
+		}
+
+		bufLen += readRes;
+	}
+
+	close(fd);
+
+	statistics.numBytesRead += bufLen;
+
+	contentInfo.magicType = magicTypeDetector.detect(buf, bufLen);
+
+	if(!contentInfo.magicType)
+		return false;
+
+	for(const std::string& magicType : config.magicTypes)
+		if( (magicType == MAGIC_TYPE_ANY_STR) || (magicType == contentInfo.magicType) )
+			return true;
+
+	return false;
+}
+
+/**
+ * Filter printed files by user-defined literal strings in their contents. This reads the file
+ * contents (until the first match), so it should come after the cheap filters.
+ *
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByContents(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf)
+{
+	if(contentMatcher.empty() )
+		return true; // no filter defined by user => always passes
+
+	bool isRegularFile =
+		(dirEntry && (dirEntry->d_type == DT_REG) ) ||
+		(statBuf && S_ISREG(statBuf->st_mode) );
+
+	if(!isRegularFile)
+		return false; // only regular files have contents to search
+
+	ContentMatcher::ChunkState chunkState;
+	bool literalFound = false;
+
+	bool readRes = readFileContents(entryPath, [&](const char* buf, size_t len)
+	{
+		literalFound = contentMatcher.findInChunk(chunkState, buf, len);
+		return !literalFound; // no need to read further after first match
+	} );
+
+	if(!readRes)
+	{
+		statistics.numErrors++;
+		return false;
+	}
+
+	return literalFound;
+}
+
+/**
+ * Get length of binary checksum digest of the given algorithm.
+ */
+size_t getChecksumDigestLen(ChecksumAlgo algo)
+{
+	switch(algo)
+	{
+		case ChecksumAlgo_SHA256: return Sha256Hasher::DIGEST_LEN;
+		case ChecksumAlgo_XXH3: return sizeof(uint64_t);
+		case ChecksumAlgo_CRC32C: return sizeof(uint32_t);
+		default: return 0;
+	}
+}
+
+/**
+ * Calculate binary checksum digest of a file's contents. Integer digests are stored in big endian
+ * byte order, so that their hex string matches the usual printf representation.
+ *
+ * @outDigest buffer of getChecksumDigestLen(algo) bytes.
+ * @return false on error, in which case an error message was already printed.
+ */
+bool calcFileDigest(const std::string& path, ChecksumAlgo algo, unsigned char* outDigest)
+{
+	switch(algo)
+	{
+		case ChecksumAlgo_SHA256:
+		{
+			Sha256Hasher hasher;
+
+			if(!readFileContents(path, [&](const char* buf, size_t len)
+				{ hasher.update(buf, len); return true; } ) )
+				return false;
+
+			hasher.digest(outDigest);
+		} break;
+
+		case ChecksumAlgo_XXH3:
+		{
+			Xxh3Hasher hasher;
+
+			if(!readFileContents(path, [&](const char* buf, size_t len)
+				{ hasher.update(buf, len); return true; } ) )
+				return false;
+
+			uint64_t digest = hasher.digest();
+
+			for(unsigned i=0; i < sizeof(digest); i++)
+				outDigest[i] = (unsigned char)(digest >> (8 * (sizeof(digest) - 1 - i) ) );
+		} break;
+
+		case ChecksumAlgo_CRC32C:
+		{
+			Crc32cHasher hasher;
+
+			if(!readFileContents(path, [&](const char* buf, size_t len)
+				{ hasher.update(buf, len); return true; } ) )
+				return false;
+
+			uint32_t digest = hasher.digest();
+
+			for(unsigned i=0; i < sizeof(digest); i++)
+				outDigest[i] = (unsigned char)(digest >> (8 * (sizeof(digest) - 1 - i) ) );
+		} break;
+
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Calculate checksum of a file's contents with the algorithm given in config.
+ *
+ * @outChecksum hex string of checksum.
+ * @return false on error, in which case an error message was already printed.
+ */
+bool calcFileChecksum(const std::string& path, std::string& outChecksum)
+{
+	unsigned char digest[Sha256Hasher::DIGEST_LEN]; // (sha256 has the longest digest)
+
+	if(!calcFileDigest(path, config.checksumAlgo, digest) )
+		return false;
+
+	outChecksum = binaryToHexStr(digest, getChecksumDigestLen(config.checksumAlgo) );
+
+	return true;
+}
+
+/**
+ * Filter printed files by checksums from the user-given "--hash-in" file. Files with a size that
+ * does not occur in the list get skipped without reading them (if sizes were given in the list).
+ *
+ * @contentInfo hashInMatch gets set for matching files; and also checksum if "--checksum" uses the
+ * 		same algorithm, so that files don't need to be read twice.
+ * @return true if entry passes the filter and should be printed, false otherwise.
+ */
+bool filterPrintEntryByHashList(const std::string& entryPath, const struct stat* statBuf,
+	EntryContentInfo& contentInfo)
+{
+	if(hashInDigestSet.empty() )
+		return true; // no filter defined by user => always passes
+
+	if(!statBuf || !S_ISREG(statBuf->st_mode) )
+		return false; // only regular files have contents to hash
+
+	if(!hashInSizeSet.empty() )
+	{
+		uint64_t fileSize = statBuf->st_size;
+		unsigned char sizeKey[sizeof(fileSize)];
+
+		memcpy(sizeKey, &fileSize, sizeof(fileSize) );
+
+		if(!hashInSizeSet.contains(sizeKey) )
+			return false;
+	}
+
+	unsigned char digest[Sha256Hasher::DIGEST_LEN]; // (sha256 has the longest digest)
+
+	if(!calcFileDigest(entryPath, config.hashInAlgo, digest) )
+	{
+		statistics.numErrors++;
+		return false;
+	}
+
+	if(!hashInDigestSet.contains(digest) )
+		return false;
+
+	contentInfo.hashInMatch = binaryToHexStr(digest, hashInDigestSet.getKeyLen() );
+
+	if(config.checksumAlgo == config.hashInAlgo)
+		contentInfo.checksum = contentInfo.hashInMatch;
+
+	return true;
+}
+
+/**
+ * Calculate checksum of entry if "--checksum" is given and entry is a regular file.
+ *
+ * @statBuf may be NULL (e.g. due to stat() error), in which case no checksum gets calculated.
+ */
+void addEntryChecksum(const std::string& entryPath, const struct stat* statBuf,
+	EntryContentInfo& contentInfo)
+{
+	if(!config.checksumAlgo || !statBuf || !S_ISREG(statBuf->st_mode) )
+		return; // nothing to do
+
+	if(!contentInfo.checksum.empty() )
+		return; // already calculated by "--hash-in" filter
+
+	if(!calcFileChecksum(entryPath, contentInfo.checksum) )
+		statistics.numErrors++;
+}
+
+/**
+ * Print line for a checksum manifest in the format of "sha256sum" and similar tools. Paths
+ * containing backslash or newline get escaped and the line gets prefixed with a backslash, as in
+ * "sha256sum" output. Xxh3 checksums get prefixed with CHECKSUM_XXH3_PREFIX, because "xxhsum -c"
+ * would take a plain 16 digit hex checksum as XXH64.
+ */
+void printChecksumLine(const std::string& checksum, const std::string& entryPath)
+{
+	const char* checksumPrefix =
+		(config.checksumAlgo == ChecksumAlgo_XXH3) ? CHECKSUM_XXH3_PREFIX : "";
+
+	if(entryPath.find_first_of("\\\n") == std::string::npos)
+	{ // common case: nothing to escape
+		printf("%s%s  %s\n", checksumPrefix, checksum.c_str(), entryPath.c_str() );
+		return;
+	}
+
+	std::string escapedPath;
+
+	for(const char currentChar : entryPath)
+	{
+		if(currentChar == '\\')
+			escapedPath += "\\\\";
+		else
+		if(currentChar == '\n')
+			escapedPath += "\\n";
+		else
+			escapedPath += currentChar;
+	}
+
+	printf("\\%s%s  %s\n", checksumPrefix, checksum.c_str(), escapedPath.c_str() );
+}
+
+/**
+ * Print entry either as plain newline-terminated string to console or in JSON format, depending
+ * on config values.
+ *
+ * @dirEntry does not have to be provided if config.printJSON==false. otherwise it only needs to be
+ * 		provided if statBuf is not provided, but there are special cases where it can still be
+ * 		NULL, e.g. because it's a user-given path argument.
+ * @statBuf does not have to be provided if config.printJSON==false. otherwise it only needs to be
+ * 		provided if dirEntry->d_type==DT_UNKNOWN or config.statAll==true, but there are special
+ * 		cases where it can still be NULL, e.g. if the stat() call returned an error.
+ * @contentInfo may be NULL if no info from reading the entry's contents is available.
+ */
+void printEntry(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf, const EntryContentInfo* contentInfo)
+{
+	if(!config.printJSON)
+	{
+		if(config.checksumAlgo)
+		{ // checksum manifest line (entries without checksum, e.g. dirs, are not printed)
+			if(contentInfo && !contentInfo->checksum.empty() )
+				printChecksumLine(contentInfo->checksum, entryPath);
+
+			return;
+		}
+
+		// simple print of path
+		printf("%s%c", entryPath.c_str(), (config.print0 ? '\0' : '\n') );
+
+		return;
+	}
+
+	// try to get dentry type from dirEntry or statBuf
+
+	std::string dirEntryJSONType(DIRENTRY_JSON_TYPE_UNKNOWN);
+
+	if(dirEntry && (dirEntry->d_type != DT_UNKNOWN) )
+	{ // we can take type from dirEntry info
+		switch(dirEntry->d_type)
+		{
+			case DT_BLK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_BLK; break;
+			case DT_CHR: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_CHR; break;
+			case DT_DIR: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_DIR; break;
+			case DT_FIFO: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_FIFO; break;
+			case DT_LNK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_LNK; break;
+			case DT_REG: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_REG; break;
+			case DT_SOCK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_SOCK; break;
+
+			default:
+			{ // should never happen (but we try to continue with "unknown" if it does)
+				fprintf(stderr, "Encountered unexpected directory entry d_type. "
+					"Path: %s; d_type: %u\n", entryPath.c_str(), (unsigned)dirEntry->d_type);
+			} break;
+		}
+	}
+	else
+	if(statBuf)
+	{ // take type from stat() info
+		if(S_ISBLK(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_BLK;
+		else
+		if(S_ISCHR(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_CHR;
+		else
+		if(S_ISDIR(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_DIR;
+		else
+		if(S_ISFIFO(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_FIFO;
+		else
+		if(S_ISLNK(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_LNK;
+		else
+		if(S_ISREG(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_REG;
+		else
+		if(S_ISSOCK(statBuf->st_mode) )
+			dirEntryJSONType = DIRENTRY_JSON_TYPE_SOCK;
+		else
+		{ // should never happen (but we try to continue with "unknown" if it does)
+			fprintf(stderr, "Encountered unexpected directory entry stat st_mode. "
+				"Path: %s; st_mode: %u\n", entryPath.c_str(), (unsigned)statBuf->st_mode);
+		}
+	}
+
+
+	// additional fields based on entry contents
+
+	std::string contentJSONFields;
+
+	if(config.checksumAlgo)
+		contentJSONFields += (contentInfo && !contentInfo->checksum.empty() ) ?
+			(",\"checksum\":\"" + contentInfo->checksum + "\"") : ",\"checksum\":null";
+
+	if(!config.magicTypes.empty() )
+		contentJSONFields += (contentInfo && contentInfo->magicType) ?
+			(",\"magic\":\"" + std::string(contentInfo->magicType) + "\"") : ",\"magic\":null";
+
+	if(contentInfo && !contentInfo->hashInMatch.empty() )
+		contentJSONFields += ",\"hash_match\":\"" + contentInfo->hashInMatch + "\"";
+
+	// print as JSON root object
+
+	if(!config.statAll)
+	{ // short JSON format
+		printf("{"
+			"\"path\":\"%s\","
+			"\"type\":\"%s\""
+			"%s"
+			"}\n",
+			escapeStrforJSON(entryPath).c_str(),
+			dirEntryJSONType.c_str(),
+			contentJSONFields.c_str() );
+
+		return;
+	}
+
+	// long JSON format
+	// (note: statBuf might be NULL due to stat() error for this entry)
+
+	if(statBuf)
+	{
+		printf("{"
+			"\"path\":\"%s\","
+			"\"type\":\"%s\","
+			"\"st_dev\":\"%" PRIu64 "\","
+			"\"st_ino\":\"%" PRIu64 "\","
+			"\"st_mode\":\"%" PRIu64 "\","
+			"\"st_nlink\":\"%" PRIu64 "\","
+			"\"st_uid\":\"%" PRIu64 "\","
+			"\"st_gid\":\"%" PRIu64 "\","
+			"\"st_rdev\":\"%" PRIu64 "\","
+			"\"st_size\":\"%" PRIu64 "\","
+			"\"st_blksize\":\"%" PRIu64 "\","
+			"\"st_blocks\":\"%" PRIu64 "\","
+			"\"st_atime\":\"%" PRIu64 "\","
+			"\"st_mtime\":\"%" PRIu64 "\","
+			"\"st_ctime\":\"%" PRIu64 "\""
+			"%s"
+			"}\n",
+			escapeStrforJSON(entryPath).c_str(),
+			dirEntryJSONType.c_str(),
+			(uint64_t)statBuf->st_dev,
+			(uint64_t)statBuf->st_ino,
+			(uint64_t)statBuf->st_mode,
+			(uint64_t)statBuf->st_nlink,
+			(uint64_t)statBuf->st_uid,
+			(uint64_t)statBuf->st_gid,
+			(uint64_t)statBuf->st_rdev,
+			(uint64_t)statBuf->st_size,
+			(uint64_t)statBuf->st_blksize,
+			(uint64_t)statBuf->st_blocks,
+			(uint64_t)statBuf->st_atime,
+			(uint64_t)statBuf->st_mtime,
+			(uint64_t)statBuf->st_ctime,
+			contentJSONFields.c_str() );
+	}
+	else
+	{ // no statBuf (probably due to stat() error), so most fields are empty
+		printf("{"
+			"\"path\":\"%s\","
+			"\"type\":\"%s\","
+			"\"st_dev\":null,"
+			"\"st_ino\":null,"
+			"\"st_mode\":null,"
+			"\"st_nlink\":null,"
+			"\"st_uid\":null,"
+			"\"st_gid\":null,"
+			"\"st_rdev\":null,"
+			"\"st_size\":null,"
+			"\"st_blksize\":null,"
+			"\"st_blocks\":null,"
+			"\"st_atime\":null,"
+			"\"st_mtime\":null,"
+			"\"st_ctime\":null"
+			"%s"
+			"}\n",
+			escapeStrforJSON(entryPath).c_str(),
+			dirEntryJSONType.c_str(),
+			contentJSONFields.c_str() );
+	}
+
+}
+
+/**
+ * Add entry to this thread's candidates for the "--top" output, if it ranks high enough.
+ *
+ * @statBuf may be NULL (e.g. due to stat() error), in which case the entry can't be ranked and gets
+ * 		ignored.
+ * @contentInfo info from reading the entry's contents during the scan, kept for printing.
+ */
+void addTopEntry(const std::string& entryPath, const struct stat* statBuf,
+	const EntryContentInfo& contentInfo)
+{
+	if(!statBuf)
+		return; // can't rank without stat() info
+
+	int64_t rank;
+
+	switch(config.topSortKey)
+	{
+		case TopSortKey_SIZE: rank = statBuf->st_size; break;
+		case TopSortKey_BLOCKS: rank = statBuf->st_blocks; break;
+		case TopSortKey_MTIME: rank = -(int64_t)statBuf->st_mtim.tv_sec; break; // oldest first
+		case TopSortKey_ATIME: rank = -(int64_t)statBuf->st_atim.tv_sec; break; // oldest first
+		default: rank = 0;
+	}
+
+	BoundedTopHeap<TopEntry>& topEntries = getThreadData().topEntries;
+
+	// check before constructing the elem to avoid path string copy for the common case
+	if(!topEntries.isCandidate(rank) )
+		return;
+
+	topEntries.push(TopEntry{rank, entryPath, *statBuf, contentInfo} );
+}
+
+/**
+ * Merge the "--top" candidates of all threads and print the final top entries.
+ *
+ * This may only be called after all scan threads terminated.
+ */
+void printTopEntries()
+{
+	if(!config.topNum || config.printEntriesDisabled)
+		return; // nothing to do
+
+	BoundedTopHeap<TopEntry> mergedTopEntries(config.topNum);
+
+	for(ThreadData& threadData : state.threadDataList)
+		mergedTopEntries.mergeFrom(threadData.topEntries);
+
+	std::vector<TopEntry> sortedTopEntries = mergedTopEntries.extractSorted();
+
+	/* checksums only for the final top entries instead of all candidates during the scan (unless
+		already calculated by "--hash-in" filter) */
+	if(config.checksumAlgo)
+		runParallelJobs(sortedTopEntries.size(), [&](size_t jobIndex)
+		{
+			TopEntry& topEntry = sortedTopEntries[jobIndex];
+
+			addEntryChecksum(topEntry.path, &topEntry.statBuf, topEntry.contentInfo);
+		} );
+
+	for(const TopEntry& topEntry : sortedTopEntries)
+		printEntry(topEntry.path, NULL, &topEntry.statBuf, &topEntry.contentInfo);
+}
+
+/**
+ * Get the index of the histogram bucket for the given value.
+ */
+size_t getHistogramBucketIndex(const HistogramConfig& histogramConfig, uint64_t value)
+{
+	if(histogramConfig.bucketBounds.empty() )
+		return value ? (64 - __builtin_clzll(value) ) : 0; // log2 buckets
+
+	// user-defined buckets (bucket 0 is everything below the first given bound)
+	return std::upper_bound(histogramConfig.bucketBounds.begin(),
+		histogramConfig.bucketBounds.end(), value) - histogramConfig.bucketBounds.begin();
+}
+
+/**
+ * Add entry to this thread's histograms.
+ *
+ * @statBuf may be NULL (e.g. due to stat() error), in which case the entry only gets added to
+ * 		histograms that don't need stat() info.
+ */
+void addEntryToHistograms(unsigned short entryDepth, const struct stat* statBuf)
+{
+	if(config.histogramConfigVec.empty() )
+		return; // nothing to do
+
+	std::vector<Histogram>& histogramVec = getThreadData().histogramVec;
+
+	if(histogramVec.empty() )
+	{ // first call by this thread => init buckets
+		histogramVec.resize(config.histogramConfigVec.size() );
+
+		for(size_t i=0; i < config.histogramConfigVec.size(); i++)
+		{
+			size_t numBuckets = config.histogramConfigVec[i].bucketBounds.empty() ?
+				HISTOGRAM_LOG2_NUMBUCKETS : (config.histogramConfigVec[i].bucketBounds.size() + 1);
+
+			histogramVec[i].numEntriesVec.resize(numBuckets, 0);
+			histogramVec[i].numBytesVec.resize(numBuckets, 0);
+		}
+	}
+
+	const uint64_t secsPerDay = 60 * 60 * 24;
+	const uint64_t entrySize = statBuf ? statBuf->st_size : 0;
+
+	for(size_t i=0; i < config.histogramConfigVec.size(); i++)
+	{
+		const HistogramConfig& histogramConfig = config.histogramConfigVec[i];
+		uint64_t value;
+
+		switch(histogramConfig.type)
+		{
+			case HistogramType_SIZE:
+			{
+				if(!statBuf)
+					continue;
+
+				value = statBuf->st_size;
+			} break;
+
+			case HistogramType_ATIME:
+			case HistogramType_MTIME:
+			{
+				if(!statBuf)
+					continue;
+
+				time_t entryTime = (histogramConfig.type == HistogramType_ATIME) ?
+					statBuf->st_atim.tv_sec : statBuf->st_mtim.tv_sec;
+
+				// (timestamps in the future count as age 0)
+				value = (entryTime < state.startTimeSecs) ?
+					( (state.startTimeSecs - entryTime) / secsPerDay) : 0;
+			} break;
+
+			case HistogramType_DEPTH:
+			default:
+			{
+				value = entryDepth;
+			} break;
+		}
+
+		size_t bucketIndex = getHistogramBucketIndex(histogramConfig, value);
+
+		histogramVec[i].numEntriesVec[bucketIndex]++;
+		histogramVec[i].numBytesVec[bucketIndex] += entrySize;
+	}
+}
+
+/**
+ * Get the name of a histogram type as given by the user.
+ */
+const char* getHistogramTypeStr(HistogramType type)
+{
+	switch(type)
+	{
+		case HistogramType_SIZE: return HISTOGRAM_TYPE_SIZE_STR;
+		case HistogramType_ATIME: return HISTOGRAM_TYPE_ATIME_STR;
+		case HistogramType_MTIME: return HISTOGRAM_TYPE_MTIME_STR;
+		case HistogramType_DEPTH: return HISTOGRAM_TYPE_DEPTH_STR;
+		default: return "unknown";
+	}
+}
+
+/**
+ * Get the value range of a histogram bucket.
+ *
+ * @outMax will be set to ~0ULL for the last bucket, which has no upper bound.
+ */
+void getHistogramBucketRange(const HistogramConfig& histogramConfig, size_t bucketIndex,
+	uint64_t& outMin, uint64_t& outMax)
+{
+	if(histogramConfig.bucketBounds.empty() )
+	{ // log2 buckets
+		outMin = bucketIndex ? (1ULL << (bucketIndex - 1) ) : 0;
+		outMax = bucketIndex ? ( (bucketIndex == 64) ? ~0ULL : ( (1ULL << bucketIndex) - 1) ) : 0;
+		return;
+	}
+
+	// user-defined buckets
+
+	outMin = bucketIndex ? histogramConfig.bucketBounds[bucketIndex - 1] : 0;
+	outMax = (bucketIndex < histogramConfig.bucketBounds.size() ) ?
+		(histogramConfig.bucketBounds[bucketIndex] - 1) : ~0ULL;
+}
+
+/**
+ * Merge the histograms of all threads and print them either in human-readable form or in JSON
+ * format, depending on config values.
+ *
+ * This may only be called after all scan threads terminated.
+ */
+void printHistograms()
+{
+	if(config.histogramConfigVec.empty() )
+		return; // nothing to do
+
+	for(size_t i=0; i < config.histogramConfigVec.size(); i++)
+	{
+		const HistogramConfig& histogramConfig = config.histogramConfigVec[i];
+		const char* typeStr = getHistogramTypeStr(histogramConfig.type);
+		const char* unitStr = (histogramConfig.type == HistogramType_SIZE) ? "bytes" :
+			(histogramConfig.type == HistogramType_DEPTH) ? "levels" : "days";
+
+		Histogram mergedHistogram;
+
+		for(ThreadData& threadData : state.threadDataList)
+		{
+			if(threadData.histogramVec.empty() )
+				continue; // this thread didn't find any matches
+
+			const Histogram& threadHistogram = threadData.histogramVec[i];
+
+			mergedHistogram.numEntriesVec.resize(threadHistogram.numEntriesVec.size(), 0);
+			mergedHistogram.numBytesVec.resize(threadHistogram.numBytesVec.size(), 0);
+
+			for(size_t bucketIndex=0; bucketIndex < threadHistogram.numEntriesVec.size();
+				bucketIndex++)
+			{
+				mergedHistogram.numEntriesVec[bucketIndex] +=
+					threadHistogram.numEntriesVec[bucketIndex];
+				mergedHistogram.numBytesVec[bucketIndex] += threadHistogram.numBytesVec[bucketIndex];
+			}
+		}
+
+		// log2 has lots of buckets, so only print the range of buckets that are actually used
+
+		size_t firstBucketIndex = 0;
+		size_t lastBucketIndex = mergedHistogram.numEntriesVec.size();
+
+		if(histogramConfig.bucketBounds.empty() )
+		{
+			while( (firstBucketIndex < lastBucketIndex) &&
+				!mergedHistogram.numEntriesVec[firstBucketIndex] )
+				firstBucketIndex++;
+
+			while( (lastBucketIndex > firstBucketIndex) &&
+				!mergedHistogram.numEntriesVec[lastBucketIndex - 1] )
+				lastBucketIndex--;
+		}
+
+		if(config.printJSON)
+			printf("{\"histogram\":\"%s\",\"unit\":\"%s\",\"buckets\":[", typeStr, unitStr);
+		else
+			printf("HISTOGRAM: %s (unit: %s)\n", typeStr, unitStr);
+
+		for(size_t bucketIndex = firstBucketIndex; bucketIndex < lastBucketIndex; bucketIndex++)
+		{
+			uint64_t bucketMin;
+			uint64_t bucketMax;
+
+			getHistogramBucketRange(histogramConfig, bucketIndex, bucketMin, bucketMax);
+
+			std::string bucketMaxStr = (bucketMax == ~0ULL) ? "" : std::to_string(bucketMax);
+
+			if(config.printJSON)
+				printf("%s{\"min\":%" PRIu64 ",\"max\":%s,"
+					"\"entries\":%" PRIu64 ",\"bytes\":%" PRIu64 "}",
+					(bucketIndex == firstBucketIndex) ? "" : ",",
+					bucketMin, bucketMaxStr.empty() ? "null" : bucketMaxStr.c_str(),
+					mergedHistogram.numEntriesVec[bucketIndex],
+					mergedHistogram.numBytesVec[bucketIndex]);
+			else
+				printf("  * %" PRIu64 " - %s: entries: %" PRIu64 "; bytes: %" PRIu64 "\n",
+					bucketMin, bucketMaxStr.empty() ? "max" : bucketMaxStr.c_str(),
+					mergedHistogram.numEntriesVec[bucketIndex],
+					mergedHistogram.numBytesVec[bucketIndex]);
+		}
+
+		if(config.printJSON)
+			printf("]}\n");
+	}
+}
+
+/**
+ * Get project ID of given entry.
+ *
+ * @return false on error (e.g. entry type that can't be opened or not supported by filesystem).
+ */
+bool getProjectID(const std::string& entryPath, const struct stat* statBuf,
+	uint64_t& outProjectID)
+{
+#ifdef FS_IOC_FSGETXATTR
+	if(!S_ISREG(statBuf->st_mode) && !S_ISDIR(statBuf->st_mode) )
+		return false; // ioctl needs an open file descriptor
+
+	const int openFlags = O_RDONLY | O_NOFOLLOW | O_NONBLOCK |
+		(S_ISDIR(statBuf->st_mode) ? O_DIRECTORY : 0);
+
+	int fd = open(entryPath.c_str(), openFlags | O_NOATIME);
+	if( (fd == -1) && (errno == EPERM) )
+		fd = open(entryPath.c_str(), openFlags); // O_NOATIME is only allowed for owner
+
+	if(fd == -1)
+	{
+		fprintf(stderr, "Failed to open entry to get project ID: %s; Error: %s\n",
+			entryPath.c_str(), strerror(errno) );
+		return false;
+	}
+
+	struct fsxattr fsxAttr;
+
+	int ioctlRes = ioctl(fd, FS_IOC_FSGETXATTR, &fsxAttr);
+	if(ioctlRes == -1)
+	{
+		fprintf(stderr, "Failed to get project ID: %s; Error: %s\n",
+			entryPath.c_str(), strerror(errno) );
+
+		close(fd);
+		return false;
+	}
+
+	close(fd);
+
+	outProjectID = fsxAttr.fsx_projid;
+
+	return true;
+#else // FS_IOC_FSGETXATTR
+	return false;
+#endif // FS_IOC_FSGETXATTR
+}
+
+/**
+ * Add entry to this thread's usage maps.
+ *
+ * @statBuf may be NULL (e.g. due to stat() error), in which case the entry can't be accounted and
+ * 		gets ignored.
+ */
+void addEntryToUsageMaps(const std::string& entryPath, const struct stat* statBuf)
+{
+	if(config.usageByVec.empty() || !statBuf)
+		return; // nothing to do
+
+	std::vector<UsageMap>& usageMapVec = getThreadData().usageMapVec;
+
+	if(usageMapVec.empty() )
+		usageMapVec.resize(config.usageByVec.size() ); // first call by this thread
+
+	/* like "du", bytes of hardlinked files get accounted only once. this thread only keeps the
+		first found link and printUsageReports() dedups the links found by different threads. */
+	const bool isHardlink = !S_ISDIR(statBuf->st_mode) && (statBuf->st_nlink > 1);
+	UsageHardlink* usageHardlink = NULL;
+
+	if(isHardlink)
+	{
+		auto insertRes = getThreadData().usageHardlinkMap.emplace(std::piecewise_construct,
+			std::forward_as_tuple(statBuf->st_dev, statBuf->st_ino), std::forward_as_tuple() );
+
+		if(insertRes.second)
+		{ // first link found by this thread
+			usageHardlink = &insertRes.first->second;
+			usageHardlink->numBytes = statBuf->st_size;
+			usageHardlink->numAllocatedBytes = (uint64_t)statBuf->st_blocks * 512;
+			usageHardlink->usageKeyVec.resize(config.usageByVec.size(), USAGE_KEY_NONE);
+		}
+	}
+
+	for(size_t i=0; i < config.usageByVec.size(); i++)
+	{
+		uint64_t usageKey;
+
+		switch(config.usageByVec[i])
+		{
+			case UsageByType_USER: usageKey = statBuf->st_uid; break;
+			case UsageByType_GROUP: usageKey = statBuf->st_gid; break;
+
+			case UsageByType_PROJECT:
+			default:
+			{
+				if(!getProjectID(entryPath, statBuf, usageKey) )
+				{
+					statistics.numErrors++;
+					continue;
+				}
+			} break;
+		}
+
+		UsageCounters& usageCounters = usageMapVec[i][usageKey];
+
+		usageCounters.numEntries++;
+
+		if(isHardlink)
+		{ // bytes of hardlinked files get added by printUsageReports()
+			if(usageHardlink)
+				usageHardlink->usageKeyVec[i] = usageKey;
+
+			continue;
+		}
+
+		usageCounters.numBytes += statBuf->st_size;
+		usageCounters.numAllocatedBytes += (uint64_t)statBuf->st_blocks * 512;
+	}
+}
+
+/**
+ * Read project names from PROJID_FILE_PATH. Lines in this file have the format "name:id".
+ *
+ * @return map of project ID to project name; empty if the file does not exist.
+ */
+std::unordered_map<uint64_t, std::string> getProjectNames()
+{
+	std::unordered_map<uint64_t, std::string> projectNamesMap;
+
+	FILE* projIDFile = fopen(PROJID_FILE_PATH, "r");
+	if(!projIDFile)
+		return projectNamesMap;
+
+	char lineBuf[1024];
+
+	while(fgets(lineBuf, sizeof(lineBuf), projIDFile) )
+	{
+		char* separatorPos = strchr(lineBuf, ':');
+		if( (lineBuf[0] == '#') || !separatorPos)
+			continue;
+
+		*separatorPos = 0;
+		projectNamesMap[strtoull(separatorPos + 1, NULL, 10)] = lineBuf;
+	}
+
+	fclose(projIDFile);
+
+	return projectNamesMap;
+}
+
+/**
+ * Merge the usage maps of all threads and print them either in human-readable form or in JSON
+ * format, depending on config values. Names get resolved only once per ID here, not during the
+ * scan.
+ *
+ * This may only be called after all scan threads terminated.
+ */
+void printUsageReports()
+{
+	if(config.usageByVec.empty() )
+		return; // nothing to do
+
+	// hardlinked files that were found by more than one thread only count once
+
+	std::map<std::pair<uint64_t, uint64_t>, const UsageHardlink*> mergedHardlinkMap;
+
+	for(const ThreadData& threadData : state.threadDataList)
+		for(const auto& hardlinkElem : threadData.usageHardlinkMap)
+			mergedHardlinkMap.emplace(hardlinkElem.first, &hardlinkElem.second);
+
+	for(size_t i=0; i < config.usageByVec.size(); i++)
+	{
+		UsageMap mergedUsageMap;
+
+		for(const auto& hardlinkElem : mergedHardlinkMap)
+		{
+			uint64_t usageKey = hardlinkElem.second->usageKeyVec[i];
+
+			if(usageKey == USAGE_KEY_NONE)
+				continue; // e.g. project ID lookup failed
+
+			UsageCounters& mergedCounters = mergedUsageMap[usageKey];
+
+			mergedCounters.numBytes += hardlinkElem.second->numBytes;
+			mergedCounters.numAllocatedBytes += hardlinkElem.second->numAllocatedBytes;
+		}
+
+		for(ThreadData& threadData : state.threadDataList)
+		{
+			if(threadData.usageMapVec.empty() )
+				continue; // this thread didn't find any matches
+
+			for(const auto& usageMapElem : threadData.usageMapVec[i] )
+			{
+				UsageCounters& mergedCounters = mergedUsageMap[usageMapElem.first];
+
+				mergedCounters.numEntries += usageMapElem.second.numEntries;
+				mergedCounters.numBytes += usageMapElem.second.numBytes;
+				mergedCounters.numAllocatedBytes += usageMapElem.second.numAllocatedBytes;
+			}
+		}
+
+		// sort by allocated bytes, largest first
+
+		std::vector<std::pair<uint64_t, UsageCounters> > sortedUsageVec(
+			mergedUsageMap.begin(), mergedUsageMap.end() );
+
+		std::sort(sortedUsageVec.begin(), sortedUsageVec.end(),
+			[](const std::pair<uint64_t, UsageCounters>& a,
+				const std::pair<uint64_t, UsageCounters>& b)
+			{ return a.second.numAllocatedBytes > b.second.numAllocatedBytes; } );
+
+		const char* typeStr;
+		std::unordered_map<uint64_t, std::string> projectNamesMap;
+
+		switch(config.usageByVec[i])
+		{
+			case UsageByType_USER: typeStr = USAGEBY_TYPE_USER_STR; break;
+			case UsageByType_GROUP: typeStr = USAGEBY_TYPE_GROUP_STR; break;
+
+			case UsageByType_PROJECT:
+			default:
+			{
+				typeStr = USAGEBY_TYPE_PROJECT_STR;
+				projectNamesMap = getProjectNames();
+			} break;
+		}
+
+		if(!config.printJSON)
+			printf("USAGE BY %s:\n", typeStr);
+
+		for(const auto& usageElem : sortedUsageVec)
+		{
+			std::string name; // stays empty if ID can't be resolved
+
+			if(config.usageByVec[i] == UsageByType_USER)
+			{
+				struct passwd* passwdEntry = getpwuid(usageElem.first);
+				if(passwdEntry)
+					name = passwdEntry->pw_name;
+			}
+			else
+			if(config.usageByVec[i] == UsageByType_GROUP)
+			{
+				struct group* groupEntry = getgrgid(usageElem.first);
+				if(groupEntry)
+					name = groupEntry->gr_name;
+			}
+			else
+			{
+				auto projectNameIter = projectNamesMap.find(usageElem.first);
+				if(projectNameIter != projectNamesMap.end() )
+					name = projectNameIter->second;
+			}
+
+			if(config.printJSON)
+				printf("{"
+					"\"usage_by\":\"%s\","
+					"\"id\":%" PRIu64 ","
+					"\"name\":%s,"
+					"\"entries\":%" PRIu64 ","
+					"\"bytes\":%" PRIu64 ","
+					"\"allocated_bytes\":%" PRIu64
+					"}\n",
+					typeStr,
+					usageElem.first,
+					name.empty() ? "null" : ("\"" + escapeStrforJSON(name) + "\"").c_str(),
+					usageElem.second.numEntries,
+					usageElem.second.numBytes,
+					usageElem.second.numAllocatedBytes);
+			else
+				printf("  * %" PRIu64 " (%s): entries: %" PRIu64 "; bytes: %" PRIu64 "; "
+					"allocated bytes: %" PRIu64 "\n",
+					usageElem.first,
+					name.empty() ? "-" : name.c_str(),
+					usageElem.second.numEntries,
+					usageElem.second.numBytes,
+					usageElem.second.numAllocatedBytes);
+		}
+	}
+}
+
+/**
+ * Add entry to this thread's candidates for "--duplicates" if it's a non-empty regular file.
+ *
+ * @statBuf may be NULL (e.g. due to stat() error), in which case the entry gets ignored.
+ */
+void addDuplicateCandidate(const std::string& entryPath, const struct stat* statBuf)
+{
+	if(!config.findDuplicates || !statBuf)
+		return; // nothing to do
+
+	if(!S_ISREG(statBuf->st_mode) || !statBuf->st_size)
+		return; // only non-empty regular files can be relevant duplicates
+
+	getThreadData().duplicateSizeMap[statBuf->st_size].push_back(
+		DuplicateCandidate{entryPath, (uint64_t)statBuf->st_dev, (uint64_t)statBuf->st_ino} );
+}
+
+/**
+ * Calculate XXH64 hash of the first and last DUPLICATES_PARTIAL_LEN bytes of a file. Small files
+ * get hashed completely.
+ *
+ * @fileSize size of the file as seen during the scan.
+ * @return false on error, in which case an error message was already printed.
+ */
+bool hashDuplicateCandidateFile(const std::string& path, uint64_t fileSize, uint64_t& outHash)
+{
+	int fd = openFileForReading(path);
+	if(fd == -1)
+		return false;
+
+	char* buf = getThreadFileReadBuf();
+	Xxh64Hasher hasher;
+
+	// start and end get read with a single pread each
+	const bool readStartAndEnd = (fileSize > (2 * DUPLICATES_PARTIAL_LEN) );
+	const size_t maxReadLen = readStartAndEnd ? DUPLICATES_PARTIAL_LEN : FILE_READ_BUF_SIZE;
+
+	off_t offset = 0;
+
+	for( ; ; )
+	{
+		ssize_t readRes = pread(fd, buf, maxReadLen, offset);
+		if(readRes == -1)
+		{
+			fprintf(stderr, "Failed to read file for hashing: %s; Error: %s\n",
+				path.c_str(), strerror(errno) );
+
+			close(fd);
+			return false;
+		}
+
+		statistics.numBytesRead += readRes;
+
+		hasher.update(buf, readRes);
+
+		if(readStartAndEnd)
+		{
+			if(offset)
+				break; // end has been read
+
+			offset = fileSize - DUPLICATES_PARTIAL_LEN;
+			continue;
+		}
+
+		if(!readRes)
+			break; // end of file
+
+		offset += readRes;
+	}
+
+	close(fd);
+
+	outHash = hasher.digest();
+
+	return true;
+}
+
+/**
+ * Calculate partial hashes of all candidates in the given groups in parallel and update their
+ * hash and hashValid fields.
+ */
+void hashDuplicateCandidates(std::vector<DuplicateGroup>& duplicateGroups)
+{
+	// flat list of candidates to give each worker thread a single file per job
+
+	std::vector<std::pair<DuplicateCandidate*, uint64_t> > jobVec; // candidate and file size
+
+	for(DuplicateGroup& duplicateGroup : duplicateGroups)
+		for(DuplicateCandidate& candidate : duplicateGroup.candidates)
+			jobVec.push_back(std::make_pair(&candidate, duplicateGroup.fileSize) );
+
+	runParallelJobs(jobVec.size(), [&](size_t jobIndex)
+	{
+		DuplicateCandidate& candidate = *jobVec[jobIndex].first;
+
+		candidate.hashValid = hashDuplicateCandidateFile(candidate.path, jobVec[jobIndex].second,
+			candidate.hash);
+
+		if(!candidate.hashValid)
+			statistics.numErrors++;
+	} );
+}
+
+/**
+ * Read a chunk of a duplicates candidate for compareDuplicateGroup().
+ *
+ * @inOutFD file descriptor of the candidate; -1 to open the file for this read and close it
+ * 		afterwards, if keepOpen is false. Otherwise the opened file is kept for the next calls.
+ * @return number of read bytes or -1 on error, in which case an error message was already
+ * 		printed.
+ */
+ssize_t readDuplicateCandidateChunk(const std::string& path, int& inOutFD, bool keepOpen,
+	char* buf, size_t len, off_t offset)
+{
+	int fd = inOutFD;
+
+	if(fd == -1)
+	{
+		fd = openFileForReading(path);
+		if(fd == -1)
+			return -1;
+
+		if(keepOpen)
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			inOutFD = fd;
+		}
+	}
+
+	ssize_t readRes = pread(fd, buf, len, offset);
+	if(readRes == -1)
+		fprintf(stderr, "Failed to read file for comparison: %s; Error: %s\n",
+			path.c_str(), strerror(errno) );
+	else
+		statistics.numBytesRead += readRes;
+
+	if(!keepOpen)
+		close(fd);
+
+	return readRes;
+}
+
+/**
+ * Compare the contents of all candidates of a group byte by byte in a single streaming pass, so
+ * that each file is read only once. The group gets split whenever chunks at the same offset
+ * differ, so this also works in the unlikely case of an XXH64 hash collision in the previous
+ * stage. Candidates with errors and resulting groups with less than two candidates get dropped.
+ *
+ * @outGroups groups of candidates with identical contents get added here.
+ */
+void compareDuplicateGroup(DuplicateGroup& duplicateGroup,
+	std::vector<DuplicateGroup>& outGroups)
+{
+	DuplicateCandidateVec& candidates = duplicateGroup.candidates;
+	const uint64_t fileSize = duplicateGroup.fileSize;
+
+	// large groups share the read buffer; small chunks still keep memory per job bounded
+	const size_t chunkLen = std::max<size_t>(DUPLICATES_MIN_CHUNK_LEN,
+		FILE_READ_BUF_SIZE / candidates.size() );
+	const bool keepOpen = (candidates.size() <= DUPLICATES_MAX_OPEN_FILES);
+
+	char* readBuf = getThreadFileReadBuf();
+	std::vector<std::unique_ptr<char[]> > refBufVec; // chunk of first candidate of each subgroup
+	std::vector<int> fdVec(candidates.size(), -1);
+
+	// groups of candidate indices that were identical so far
+	std::vector<std::vector<size_t> > subgroups(1);
+
+	for(size_t i=0; i < candidates.size(); i++)
+		subgroups[0].push_back(i);
+
+	for(off_t offset = 0; ( (uint64_t)offset < fileSize) && !subgroups.empty();
+		offset += chunkLen)
+	{
+		const size_t readLen = std::min<uint64_t>(chunkLen, fileSize - offset);
+		std::vector<std::vector<size_t> > nextSubgroups;
+
+		for(std::vector<size_t>& subgroup : subgroups)
+		{
+			std::vector<std::vector<size_t> > splitSubgroups; // same order as refBufVec
+
+			for(size_t candidateIndex : subgroup)
+			{
+				ssize_t readRes = readDuplicateCandidateChunk(candidates[candidateIndex].path,
+					fdVec[candidateIndex], keepOpen, readBuf, readLen, offset);
+
+				if(readRes == -1)
+				{
+					statistics.numErrors++;
+					continue;
+				}
+
+				if( (size_t)readRes != readLen)
+					continue; // file size changed since the scan
+
+				size_t splitIndex = 0;
+
+				while( (splitIndex < splitSubgroups.size() ) &&
+					memcmp(refBufVec[splitIndex].get(), readBuf, readLen) )
+					splitIndex++;
+
+				if(splitIndex == splitSubgroups.size() )
+				{ // first candidate with this chunk contents
+					if(refBufVec.size() == splitIndex)
+						refBufVec.emplace_back(new char[chunkLen] );
+
+					memcpy(refBufVec[splitIndex].get(), readBuf, readLen);
+					splitSubgroups.emplace_back();
+				}
+
+				splitSubgroups[splitIndex].push_back(candidateIndex);
+			}
+
+			for(std::vector<size_t>& splitSubgroup : splitSubgroups)
+			{
+				if(splitSubgroup.size() >= 2)
+				{
+					nextSubgroups.push_back(std::move(splitSubgroup) );
+					continue;
+				}
+
+				// unique contents => no need to read the rest of this file
+				if(fdVec[splitSubgroup[0] ] != -1)
+				{
+					close(fdVec[splitSubgroup[0] ] );
+					fdVec[splitSubgroup[0] ] = -1;
+				}
+			}
+		}
+
+		subgroups = std::move(nextSubgroups);
+	}
+
+	for(int fd : fdVec)
+		if(fd != -1)
+			close(fd);
+
+	for(std::vector<size_t>& subgroup : subgroups)
+	{
+		DuplicateGroup identicalGroup {fileSize, {} };
+
+		for(size_t candidateIndex : subgroup)
+			identicalGroup.candidates.push_back(std::move(candidates[candidateIndex] ) );
+
+		outGroups.push_back(std::move(identicalGroup) );
+	}
+}
+
+/**
+ * Run compareDuplicateGroup() for the given groups in parallel with one group per job.
+ *
+ * @return groups of candidates with identical contents.
+ */
+std::vector<DuplicateGroup> compareDuplicateGroups(std::vector<DuplicateGroup>& duplicateGroups)
+{
+	std::vector<std::vector<DuplicateGroup> > jobResultVec(duplicateGroups.size() );
+
+	runParallelJobs(duplicateGroups.size(), [&](size_t jobIndex)
+	{
+		compareDuplicateGroup(duplicateGroups[jobIndex], jobResultVec[jobIndex] );
+	} );
+
+	std::vector<DuplicateGroup> identicalGroups;
+
+	for(std::vector<DuplicateGroup>& jobResult : jobResultVec)
+		std::move(jobResult.begin(), jobResult.end(), std::back_inserter(identicalGroups) );
+
+	return identicalGroups;
+}
+
+/**
+ * Split groups based on the hash of their candidates, so that afterwards all candidates in a
+ * group have the same hash. Candidates without valid hash and resulting groups with less than two
+ * candidates get dropped.
+ */
+std::vector<DuplicateGroup> splitDuplicateGroupsByHash(std::vector<DuplicateGroup>& duplicateGroups)
+{
+	std::vector<DuplicateGroup> splitGroups;
+
+	for(DuplicateGroup& duplicateGroup : duplicateGroups)
+	{
+		DuplicateCandidateVec& candidates = duplicateGroup.candidates;
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const DuplicateCandidate& a, const DuplicateCandidate& b)
+			{ return a.hash < b.hash; } );
+
+		for(size_t rangeStart=0; rangeStart < candidates.size(); )
+		{
+			size_t rangeEnd = rangeStart + 1;
+
+			while( (rangeEnd < candidates.size() ) &&
+				(candidates[rangeEnd].hash == candidates[rangeStart].hash) )
+				rangeEnd++;
+
+			DuplicateGroup splitGroup {duplicateGroup.fileSize, {} };
+
+			for(size_t i = rangeStart; i < rangeEnd; i++)
+				if(candidates[i].hashValid)
+					splitGroup.candidates.push_back(std::move(candidates[i] ) );
+
+			if(splitGroup.candidates.size() >= 2)
+				splitGroups.push_back(std::move(splitGroup) );
+
+			rangeStart = rangeEnd;
+		}
+	}
+
+	return splitGroups;
+}
+
+/**
+ * Merge the "--duplicates" candidates of all threads, find the actual duplicates and print them
+ * either as groups of newline-separated paths or in JSON format, depending on config values.
+ *
+ * This is a pipeline with increasing cost per file, so that each stage only has to process the
+ * remaining candidates of the previous stage: (1) group by file size, (2) group by hash of start
+ * and end of file, (3) byte comparison of full file contents, reading each file only once.
+ *
+ * This may only be called after all scan threads terminated.
+ */
+void findAndPrintDuplicates()
+{
+	if(!config.findDuplicates)
+		return; // nothing to do
+
+	// stage 1: merge size groups of all threads
+
+	DuplicateSizeMap mergedSizeMap;
+
+	for(ThreadData& threadData : state.threadDataList)
+	{
+		for(auto& sizeMapElem : threadData.duplicateSizeMap)
+		{
+			DuplicateCandidateVec& mergedCandidates = mergedSizeMap[sizeMapElem.first];
+
+			std::move(sizeMapElem.second.begin(), sizeMapElem.second.end(),
+				std::back_inserter(mergedCandidates) );
+		}
+
+		threadData.duplicateSizeMap.clear();
+	}
+
+	std::vector<DuplicateGroup> duplicateGroups;
+
+	for(auto& sizeMapElem : mergedSizeMap)
+	{
+		DuplicateCandidateVec& candidates = sizeMapElem.second;
+
+		if(candidates.size() < 2)
+			continue; // unique size => can't have duplicates
+
+		// exclude hardlinks, because they are the same file and not duplicate data
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const DuplicateCandidate& a, const DuplicateCandidate& b)
+			{ return (a.devID != b.devID) ? (a.devID < b.devID) : (a.inodeID < b.inodeID); } );
+
+		candidates.erase(std::unique(candidates.begin(), candidates.end(),
+			[](const DuplicateCandidate& a, const DuplicateCandidate& b)
+			{ return (a.devID == b.devID) && (a.inodeID == b.inodeID); } ), candidates.end() );
+
+		if(candidates.size() >= 2)
+			duplicateGroups.push_back(DuplicateGroup{sizeMapElem.first, std::move(candidates) } );
+	}
+
+	mergedSizeMap.clear();
+
+	// stage 2: hash start and end of files
+
+	hashDuplicateCandidates(duplicateGroups);
+
+	duplicateGroups = splitDuplicateGroupsByHash(duplicateGroups);
+
+	// stage 3: byte comparison of full contents (hashes are not a proof of identical contents)
+
+	std::vector<DuplicateGroup> finalGroups = compareDuplicateGroups(duplicateGroups);
+
+	// print results, largest files first
+
+	std::sort(finalGroups.begin(), finalGroups.end(),
+		[](const DuplicateGroup& a, const DuplicateGroup& b)
+		{ return a.fileSize > b.fileSize; } );
+
+	for(DuplicateGroup& duplicateGroup : finalGroups)
+	{
+		std::sort(duplicateGroup.candidates.begin(), duplicateGroup.candidates.end(),
+			[](const DuplicateCandidate& a, const DuplicateCandidate& b)
+			{ return a.path < b.path; } );
+
+		if(config.printJSON)
+		{
+			printf("{\"size\":%" PRIu64 ",\"paths\":[", duplicateGroup.fileSize);
+
+			for(size_t i=0; i < duplicateGroup.candidates.size(); i++)
+				printf("%s\"%s\"", i ? "," : "",
+					escapeStrforJSON(duplicateGroup.candidates[i].path).c_str() );
+
+			printf("]}\n");
+		}
+		else
+		{ // groups are separated by an empty line (like in fdupes output)
+			for(const DuplicateCandidate& candidate : duplicateGroup.candidates)
+				printf("%s%c", candidate.path.c_str(), (config.print0 ? '\0' : '\n') );
+
+			printf("%c", (config.print0 ? '\0' : '\n') );
+		}
+	}
+}
+
+/**
+ * Stop the scan before the end of the tree is reached.
+ *
+ * @reason printed in summary to mark results as partial; only the reason of the first call is
+ * 		kept. NULL if results are not partial from the user's point of view (e.g. "--limit").
+ */
+void cancelScan(const char* reason)
+{
+	const char* noReason = NULL;
+
+	state.scanPartialReason.compare_exchange_strong(noReason, reason);
+
+	sharedStack.cancel();
+}
+
+/**
+ * Filter discovered files/dirs and kick off processing of entries that came through the filters,
+ * such as printing to console, copying etc.
+ *
+ * @dirEntry does not have to be provided if config.printJSON==false. otherwise it only needs to be
+ * 		provided if statBuf is not provided, but there are special cases where it can still be
+ * 		NULL, e.g. because it's a user-given path argument.
+ * @statBuf does not have to be provided if config.printJSON==false. otherwise it only needs to be
+ * 		provided if dirEntry->d_type==DT_UNKNOWN or config.statAll==true, but there are special
+ * 		cases where it can still be NULL, e.g. if the stat() call returned an error.
+ * @entryDepth dir depth of this entry relative to the scan path. (Path arguments have depth 0.)
+ */
+void processDiscoveredEntry(const std::string& entryPath, const struct dirent* dirEntry,
+	const struct stat* statBuf, unsigned short entryDepth)
+{
+	// filters
+
+	if(!filterPrintEntryByType(entryPath, dirEntry, statBuf) )
+		return;
+
+	if(!filterPrintEntryByName(entryPath, dirEntry, statBuf) )
+		return;
+
+	if(!filterPrintEntryByPath(entryPath, dirEntry, statBuf) )
+		return;
+
+	if(!filterPrintEntryBySizeOrTime(entryPath, dirEntry, statBuf) )
+		return;
+
+	if(!filterPrintEntryByUIDAndGID(entryPath, dirEntry, statBuf) )
+		return;
+
+	// (contents filters read the file, so they come after all the cheap filters)
+
+	EntryContentInfo contentInfo;
+
+	if(!filterPrintEntryByMagic(entryPath, dirEntry, statBuf, contentInfo) )
+		return;
+
+	if(!filterPrintEntryByContents(entryPath, dirEntry, statBuf) )
+		return;
+
+	if(!filterPrintEntryByHashList(entryPath, statBuf, contentInfo) )
+		return;
+
+	/* reserve a match slot for "--limit", so that exactly the given number of matches gets
+		processed, even if other threads find matches at the same time. we can't exit() here
+		because of the other threads, so the scan gets cancelled when the last slot is taken. */
+
+	if(config.matchLimit)
+	{
+		uint64_t matchSlot = state.numMatchesReserved++;
+
+		if(matchSlot >= config.matchLimit)
+			return; // other threads took all slots
+
+		if(matchSlot == (config.matchLimit - 1) )
+			cancelScan(NULL);
+	}
+
+	// print entry (or keep it as candidate for printing of top entries at the end)
+
+	if(config.topNum && !config.printEntriesDisabled)
+		addTopEntry(entryPath, statBuf, contentInfo);
+	else
+	if(!config.printEntriesDisabled)
+	{
+		addEntryChecksum(entryPath, statBuf, contentInfo);
+
+		ThreadTimeTimer outputTimer(ThreadTimeType_OUTPUT);
+
+		printEntry(entryPath, dirEntry, statBuf, &contentInfo);
+	}
+
+	// histograms
+
+	addEntryToHistograms(entryDepth, statBuf);
+
+	// usage reports
+
+	addEntryToUsageMaps(entryPath, statBuf);
+
+	// duplicates
+
+	addDuplicateCandidate(entryPath, statBuf);
+
+	// exec system command on entry
+
+	execSystemCommand(entryPath);
+
+	// copy
+
+	copyEntry(entryPath, dirEntry, statBuf);
+
+	// unlink
+
+	unlinkEntry(entryPath, dirEntry, statBuf);
+
+	statistics.numFilterMatches++;
+}
+
+/**
+ * Starting point for the thread that cancels the scan when "--time-limit" is reached. Terminates
+ * early when the scan threads are done before that.
+ */
+void timeLimitThreadStart()
+{
+	std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
+
+	bool scanThreadsDone = state.scanThreadsDoneCondition.wait_until(lock,
+		state.startTime + std::chrono::seconds(config.timeLimitSecs),
+		[]() { return state.scanThreadsDone; } );
+
+	if(!scanThreadsDone)
+		cancelScan("time limit reached");
+}
+
+/**
+ * Counters of a progress snapshot, to calculate rates since the previous snapshot.
+ */
+struct ProgressSnapshot
+{
+	std::chrono::steady_clock::time_point time {state.startTime};
+	uint64_t numEntries {0};
+	uint64_t numDirs {0};
+	uint64_t numStatCalls {0};
+	uint64_t numBytesCopied {0};
+};
+
+/**
+ * Print a progress line to stderr for "--progress" or SIGUSR1.
+ *
+ * @lastSnapshot counters of previous call to calculate rates; gets updated to current counters.
+ */
+void printProgress(ProgressSnapshot& lastSnapshot)
+{
+	ProgressSnapshot snapshot;
+
+	snapshot.time = std::chrono::steady_clock::now();
+	snapshot.numDirs = statistics.numDirsFound;
+	snapshot.numEntries = snapshot.numDirs + statistics.numFilesFound;
+	snapshot.numStatCalls = statistics.numStatCalls;
+	snapshot.numBytesCopied = statistics.numBytesCopied;
+
+	std::chrono::microseconds elapsedMicroSec =
+		std::chrono::duration_cast<std::chrono::microseconds>(snapshot.time - state.startTime);
+	double intervalSecs = std::chrono::duration_cast<std::chrono::microseconds>(
+		snapshot.time - lastSnapshot.time).count() / 1000000.0;
+
+	if(intervalSecs <= 0)
+		intervalSecs = 1; // avoid division by zero for two snapshots at the same time
+
+	unsigned numActiveThreads = config.numThreads - sharedStack.getNumWaiters();
+
+	fprintf(stderr, "PROGRESS: %" PRIu64 ".%01" PRIu64 "s; "
+		"entries: %" PRIu64 " (%.0f/s); "
+		"dirs: %" PRIu64 " (%.0f/s); "
+		"stat calls: %" PRIu64 " (%.0f/s); "
+		"queue: %" PRIu64 "; "
+		"active threads: %u/%u",
+		(uint64_t)(elapsedMicroSec.count() / 1000000),
+		(uint64_t)( (elapsedMicroSec.count() % 1000000) / 100000),
+		snapshot.numEntries, (snapshot.numEntries - lastSnapshot.numEntries) / intervalSecs,
+		snapshot.numDirs, (snapshot.numDirs - lastSnapshot.numDirs) / intervalSecs,
+		snapshot.numStatCalls, (snapshot.numStatCalls - lastSnapshot.numStatCalls) / intervalSecs,
+		sharedStack.getSize(),
+		numActiveThreads, sharedStack.getActiveThreadsLimit() );
+
+	if(!config.copyDestDir.empty() )
+		fprintf(stderr, "; copy: %.1f MiB/s",
+			(snapshot.numBytesCopied - lastSnapshot.numBytesCopied) /
+			(1024 * 1024 * intervalSecs) );
+
+	fprintf(stderr, "\n");
+
+	lastSnapshot = snapshot;
+}
+
+/**
+ * Signal handler to request a progress snapshot from the progress thread.
+ */
+void progressSignalHandler(int signal)
+{
+	state.progressSnapshotRequested = true; // (lock-free atomic, so ok in signal handler)
+}
+
+/**
+ * Starting point for the thread that prints progress at config.progressIntervalSecs and on
+ * SIGUSR1. Terminates when the scan threads are done.
+ */
+void progressThreadStart()
+{
+	ProgressSnapshot lastSnapshot;
+
+	std::chrono::steady_clock::time_point nextPrintTime = state.startTime +
+		std::chrono::seconds(config.progressIntervalSecs);
+
+	std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
+
+	while(!state.scanThreadsDone)
+	{
+		state.scanThreadsDoneCondition.wait_for(lock,
+			std::chrono::milliseconds(PROGRESS_CHECK_INTERVAL_MS) );
+
+		if(state.scanThreadsDone)
+			break;
+
+		bool doPrint = state.progressSnapshotRequested.exchange(false);
+
+		if(config.progressIntervalSecs && (std::chrono::steady_clock::now() >= nextPrintTime) )
+		{
+			doPrint = true;
+			nextPrintTime += std::chrono::seconds(config.progressIntervalSecs);
+		}
+
+		if(!doPrint)
+			continue;
+
+		lock.unlock(); // (printProgress needs sharedStack lock, so avoid nested locks)
+
+		printProgress(lastSnapshot);
+
+		lock.lock();
+	}
+}
+
+/**
+ * This is the main workhorse. It does a breadth scan while dir stack size is below
+ * config.depthSearchStartThreshold, in which cases discovered dirs are put on stack so that other
+ * threads can grab them. Otherwise it switches to recursive depth search.
+ *
+ * @devID st_dev of path (or of its parent if unknown), which the calling thread counts against.
+ */
+void scan(std::string path, const unsigned short dirDepth, const uint64_t devID)
+{
+	if(sharedStack.isScanCancelled() )
+		return;
+
+	TraceSpan scanSpan(TraceEventType_SCAN, path); // (value is number of dir entries)
+	HotDirRecorder hotDirRecorder(path);
+
+	SyscallTimer opendirTimer(SyscallType_OPENDIR);
+	void* dirStream = fsBackend->openDir(path.c_str() );
+	opendirTimer.stop();
+	if(!dirStream)
+	{
+		statistics.numErrors++;
+
+		int errnoBackup = errno;
+		fprintf(stderr, "Failed to open dir: '%s'; Error: %s\n", path.c_str(), strerror(errno) );
+		if( (errnoBackup == EACCES) || (errnoBackup == ENOENT) )
+			return;
+
+		kill(0, SIGTERM);
+	}
+
+	/* loop over contents of this entire directory - potentially recursively descending into subdirs
+		along the way, depending on config and current global state */
+	for ( ; ; )
+	{
+		errno = 0;
+		ThreadTimeTimer readdirThreadTimer(ThreadTimeType_READDIR);
+		SyscallTimer readdirTimer(SyscallType_READDIR);
+		struct dirent* dirEntry = fsBackend->readDir(dirStream);
+		readdirTimer.stop();
+		readdirThreadTimer.stop();
+		if(!dirEntry)
+		{
+			if(errno)
+			{
+				fprintf(stderr, "Failed to read from dir: %s; Error: %s\n",
+					path.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+			}
+
+			fsBackend->closeDir(dirStream);
+			return;
+		}
+
+		if(!strcmp(dirEntry->d_name, ".") || !strcmp(dirEntry->d_name, "..") )
+			continue;
+
+		scanSpan.addToValue(1);
+		hotDirRecorder.addEntry();
+
+		if(sharedStack.isScanCancelled() )
+		{ // time limit or similar reached => stop as soon as possible
+			fsBackend->closeDir(dirStream);
+			return;
+		}
+
+		if(config.maxEntries && (state.numEntriesReserved++ >= config.maxEntries) )
+		{
+			cancelScan("max entries reached");
+			fsBackend->closeDir(dirStream);
+			return;
+		}
+
+		struct stat statBuf;
+		int statErrno = -1; // "-1" to let clear that statBuf is not usable yet
+
+		// if dentry type is unknown then we have to stat to know if this is a dir to descend into
+		if(config.statAll || (dirEntry->d_type == DT_UNKNOWN) )
+		{
+			statistics.numStatCalls++;
+
+			ThreadTimeTimer statThreadTimer(ThreadTimeType_STAT);
+			SyscallTimer statTimer(SyscallType_STAT);
+			hotDirRecorder.startStat();
+			int statRes = fsBackend->statAt(dirStream, dirEntry->d_name, &statBuf);
+			hotDirRecorder.stopStat();
+			statTimer.stop();
+			statThreadTimer.stop();
+
+			if(!statRes)
+				statErrno = 0; // success, so mark statBuf as usable
+			else
+			{ // stat failed
+				statErrno = errno;
+
+				fprintf(stderr, "Failed to get attributes for path: %s; Error: %s\n",
+					path.c_str(), strerror(statErrno) );
+			}
+		}
+
+		if(dirEntry->d_type == DT_UNKNOWN)
+			statistics.numUnknownFound++;
+
+		std::string entryPath(path + "/" + dirEntry->d_name);
+
+		if(dirEntry->d_type == DT_DIR ||
+			( (dirEntry->d_type == DT_UNKNOWN) && !statErrno && S_ISDIR(statBuf.st_mode) ) )
+		{ // this entry is a directory
+			statistics.numDirsFound++;
+
+			checkACLs(entryPath.c_str(), true);
+
+			ThreadTimeTimer processingTimer(ThreadTimeType_PROCESSING);
+
+			processDiscoveredEntry(entryPath, dirEntry, statErrno ? NULL : &statBuf, dirDepth);
+
+			processingTimer.stop();
+
+			// (without stat info, subdirs are assumed to be on the device of their parent)
+			const uint64_t subdirDevID = !statErrno ? statBuf.st_dev : devID;
+
+			const bool doDescendDepth = (dirDepth < config.maxDirDepth);
+			const bool doDescendMount = !config.stayOnDevice ||
+				(!statErrno && (statBuf.st_dev == devID) );
+
+			if(doDescendMount && doDescendDepth)
+			{
+				// (dirs on other devices always go to the stack to be scheduled for their device)
+				if( (sharedStack.getSize() >= config.depthSearchStartThreshold) &&
+					(subdirDevID == devID) )
+				{
+					getThreadData().numDepthRecursions++;
+					hotDirRecorder.startSubdirScan();
+					scan(entryPath, dirDepth + 1, devID);
+					hotDirRecorder.stopSubdirScan();
+				}
+				else
+				{ // breadth search, so just add dir to stack for later processing
+					getThreadData().numBreadthPushes++;
+					sharedStack.push(entryPath, dirDepth + 1, subdirDevID);
+
+					traceInstantEvent(TraceEventType_PUSH, entryPath, sharedStack.getSize() );
+				}
+			}
+		}
+		else
+		{ // this entry is not a directory (or unknown with stat() error)
+			statistics.numFilesFound++;
+
+			checkACLs(entryPath.c_str(), false);
+
+			ThreadTimeTimer processingTimer(ThreadTimeType_PROCESSING);
+
+			processDiscoveredEntry(entryPath, dirEntry, statErrno ? NULL : &statBuf, dirDepth);
+		}
+
+	}
+}
+
+/**
+ * Starting point for directory structure scan threads.
+ */
+void threadStart()
+{
+	if(config.background)
+		setBackgroundPriority();
+
+	try
+	{
+		std::string dirPath;
+		unsigned short dirDepth;
+		uint64_t devID = DEV_ID_NONE;
+
+		for( ; ; )
+		{
+			ThreadTimeTimer waitTimer(ThreadTimeType_WAIT); // (also stopped by exception)
+			TraceSpan waitSpan(TraceEventType_WAIT, dirPath); // (path is the popped dir)
+
+			dirPath.clear(); // (so that the final wait span doesn't show the previous dir)
+
+			if(!sharedStack.popWait(dirPath, dirDepth, devID) )
+				break;
+
+			waitTimer.stop();
+			waitSpan.stop();
+
+			traceInstantEvent(TraceEventType_POP, dirPath, sharedStack.getSize() );
+
+			scan(dirPath, dirDepth, devID);
+		}
+	}
+	catch(ScanDoneException& e)
+	{
+	}
+}
+
+/**
+ * Read a dir for "--estimate" and count its entries. Subdirs that a full scan would descend into
+ * are returned by name. Results are cached, because the dirs near the top of the tree get visited
+ * by almost every probe.
+ *
+ * @devID st_dev of the scan path that this dir belongs to, for "--xdev".
+ * @return NULL if dir could not be opened. Failures are cached as well, so the error message gets
+ * 		printed only once per dir.
+ */
+std::shared_ptr<const EstimateDirSample> getEstimateDirSample(const std::string& path,
+	uint64_t devID)
+{
+	{
+		std::unique_lock<std::mutex> lock(state.estimateDirCacheMutex); // L O C K
+
+		auto cacheIter = state.estimateDirCache.find(path);
+		if(cacheIter != state.estimateDirCache.end() )
+			return cacheIter->second;
+	}
+
+	void* dirStream = fsBackend->openDir(path.c_str() );
+	if(!dirStream)
+	{
+		int openErrno = errno;
+
+		std::unique_lock<std::mutex> lock(state.estimateDirCacheMutex); // L O C K
+
+		// (negative entries ignore the cache size limit, so that errors don't repeat)
+		if(state.estimateDirCache.emplace(path, nullptr).second)
+		{ // first probe that reached this dir
+			statistics.numErrors++;
+			fprintf(stderr, "Failed to open dir: '%s'; Error: %s\n",
+				path.c_str(), strerror(openErrno) );
+		}
+
+		return NULL;
+	}
+
+	std::shared_ptr<EstimateDirSample> sample = std::make_shared<EstimateDirSample>();
+
+	for( ; ; )
+	{
+		errno = 0;
+		struct dirent* dirEntry = fsBackend->readDir(dirStream);
+		if(!dirEntry)
+		{
+			if(errno)
+			{
+				fprintf(stderr, "Failed to read from dir: %s; Error: %s\n",
+					path.c_str(), strerror(errno) );
+
+				statistics.numErrors++;
+			}
+
+			break;
+		}
+
+		if(!strcmp(dirEntry->d_name, ".") || !strcmp(dirEntry->d_name, "..") )
+			continue;
+
+		struct stat statBuf;
+
+		statistics.numStatCalls++;
+
+		if(fsBackend->statAt(dirStream, dirEntry->d_name, &statBuf) )
+		{
+			statistics.numErrors++;
+			continue;
+		}
+
+		sample->numBytes += statBuf.st_size;
+
+		if(!S_ISDIR(statBuf.st_mode) )
+		{
+			sample->numFiles++;
+			continue;
+		}
+
+		sample->numDirs++;
+
+		if(!config.stayOnDevice || (statBuf.st_dev == devID) )
+			sample->subdirNames.push_back(dirEntry->d_name);
+	}
+
+	fsBackend->closeDir(dirStream);
+
+	std::unique_lock<std::mutex> lock(state.estimateDirCacheMutex); // L O C K
+
+	if(state.estimateDirCache.size() < ESTIMATE_DIRCACHE_MAX_SIZE)
+		state.estimateDirCache[path] = sample;
+
+	return sample;
+}
+
+/**
+ * Do a single random probe of Knuth's tree size estimator for each scan path: Walk down from the
+ * scan path by choosing a random subdir at each level. The counts of each visited dir get
+ * multiplied by the product of the numbers of subdirs along the path, which gives an unbiased
+ * estimate of the totals of the full tree.
+ *
+ * @outProbeValues estimated totals, indexed by EstimateValue_....
+ */
+void runEstimateProbe(std::mt19937_64& randGen, double (&outProbeValues)[EstimateValue_COUNT] )
+{
+	std::fill(std::begin(outProbeValues), std::end(outProbeValues), 0);
+
+	for(const std::string& scanPath : config.scanPaths)
+	{
+		struct stat statBuf;
+
+		if(fsBackend->lstatPath(scanPath.c_str(), &statBuf) )
+			continue; // (error message was already printed by initial check in runEstimate() )
+
+		outProbeValues[EstimateValue_ENTRIES]++;
+		outProbeValues[S_ISDIR(statBuf.st_mode) ? EstimateValue_DIRS : EstimateValue_FILES]++;
+		outProbeValues[EstimateValue_BYTES] += statBuf.st_size;
+
+		if(!S_ISDIR(statBuf.st_mode) )
+			continue;
+
+		std::string dirPath(scanPath);
+		if( (dirPath != "/") && (dirPath[dirPath.length()-1] == '/') )
+			dirPath.erase(dirPath.length()-1, 1); // scan() also removes one trailing slash
+
+		double weight = 1; // product of the numbers of subdirs along the path
+
+		for(unsigned short dirDepth = 1; dirDepth <= config.maxDirDepth; dirDepth++)
+		{
+			std::shared_ptr<const EstimateDirSample> sample =
+				getEstimateDirSample(dirPath, statBuf.st_dev);
+			if(!sample)
+				break;
+
+			outProbeValues[EstimateValue_ENTRIES] +=
+				weight * (sample->numDirs + sample->numFiles);
+			outProbeValues[EstimateValue_DIRS] += weight * sample->numDirs;
+			outProbeValues[EstimateValue_FILES] += weight * sample->numFiles;
+			outProbeValues[EstimateValue_BYTES] += weight * sample->numBytes;
+
+			if(sample->subdirNames.empty() || (dirDepth == config.maxDirDepth) )
+				break;
+
+			weight *= sample->subdirNames.size();
+
+			dirPath += "/" + sample->subdirNames[randGen() % sample->subdirNames.size()];
+		}
+	}
+}
+
+/**
+ * Get estimated value and half width of its 95% confidence interval from the probe results.
+ */
+void getEstimateInterval(const EstimateResult& result, unsigned valueIndex,
+	double& outValue, double& outHalfWidth)
+{
+	outValue = result.numProbes ? (result.sums[valueIndex] / result.numProbes) : 0;
+	outHalfWidth = 0;
+
+	if(result.numProbes < 2)
+		return;
+
+	double variance =
+		(result.sumsOfSquares[valueIndex] - (result.numProbes * outValue * outValue) ) /
+		(result.numProbes - 1);
+
+	outHalfWidth = 1.96 * std::sqrt(std::max(variance, 0.0) / result.numProbes);
+}
+
+/**
+ * Print current estimate either as intermediate result to stderr or as final result to stdout.
+ */
+void printEstimate(const EstimateResult& result, bool isFinal)
+{
+	static const char* valueNames[EstimateValue_COUNT] = {"entries", "dirs", "files", "bytes"};
+
+	if(!isFinal)
+	{ // intermediate result
+		std::string intervalsStr;
+
+		for(unsigned i=0; i < EstimateValue_COUNT; i++)
+		{
+			double value;
+			double halfWidth;
+
+			getEstimateInterval(result, i, value, halfWidth);
+
+			intervalsStr += std::string(valueNames[i] ) + ": " +
+				std::to_string(std::llround(value) ) + " +/- " +
+				std::to_string(std::llround(halfWidth) ) + "; ";
+		}
+
+		fprintf(stderr, "ESTIMATE: %sprobes: %" PRIu64 "\n", intervalsStr.c_str(),
+			result.numProbes);
+
+		return;
+	}
+
+	if(config.printJSON)
+		printf("{\"estimate\":{\"probes\":%" PRIu64, result.numProbes);
+	else
+		printf("ESTIMATE: (95%% confidence intervals; probes: %" PRIu64 ")\n", result.numProbes);
+
+	for(unsigned i=0; i < EstimateValue_COUNT; i++)
+	{
+		double value;
+		double halfWidth;
+
+		getEstimateInterval(result, i, value, halfWidth);
+
+		uint64_t valueRounded = std::llround(value);
+		uint64_t halfWidthRounded = std::llround(halfWidth);
+
+		if(config.printJSON)
+			printf(",\"%s\":{\"value\":%" PRIu64 ",\"ci95\":%" PRIu64 "}",
+				valueNames[i], valueRounded, halfWidthRounded);
+		else
+			printf("  * %s: %" PRIu64 " +/- %" PRIu64 "\n",
+				valueNames[i], valueRounded, halfWidthRounded);
+	}
+
+	if(config.printJSON)
+		printf("}}\n");
+}
+
+/**
+ * Estimate number of entries and bytes in the scan paths for "--estimate" instead of a full scan.
+ * Probes run on getNumWorkerThreads() threads until config.estimateTimeSecs is over or until the
+ * confidence intervals are narrow enough. Intermediate results are printed to stderr once per
+ * second (unless summary is disabled).
+ *
+ * @return false if any of the scan paths could not be accessed.
+ */
+bool runEstimate()
+{
+	bool retVal = true;
+
+	for(const std::string& scanPath : config.scanPaths)
+	{
+		struct stat statBuf;
+
+		if(fsBackend->lstatPath(scanPath.c_str(), &statBuf) )
+		{
+			fprintf(stderr, "Failed to get attributes for path: %s; Error: %s\n",
+				scanPath.c_str(), strerror(errno) );
+
+			retVal = false;
+		}
+	}
+
+	EstimateResult result;
+	std::mutex resultMutex; // protects result
+	std::atomic_bool stopProbes {false};
+	std::vector<std::thread> probeThreads;
+
+	for(unsigned i=0; i < getNumWorkerThreads(); i++)
+		probeThreads.push_back(std::thread( [&]()
+		{
+			if(config.background)
+				setBackgroundPriority();
+
+			std::mt19937_64 randGen(std::random_device{}() );
+			double probeValues[EstimateValue_COUNT];
+
+			while(!stopProbes)
+			{
+				runEstimateProbe(randGen, probeValues);
+
+				std::unique_lock<std::mutex> lock(resultMutex); // L O C K
+
+				result.numProbes++;
+
+				for(unsigned valueIndex=0; valueIndex < EstimateValue_COUNT; valueIndex++)
+				{
+					result.sums[valueIndex] += probeValues[valueIndex];
+					result.sumsOfSquares[valueIndex] +=
+						probeValues[valueIndex] * probeValues[valueIndex];
+				}
+			}
+		} ) );
+
+	std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() +
+		std::chrono::seconds(config.estimateTimeSecs);
+	std::chrono::steady_clock::time_point nextPrintTime = std::chrono::steady_clock::now() +
+		std::chrono::seconds(1);
+
+	while(std::chrono::steady_clock::now() < endTime)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(ESTIMATE_CHECK_INTERVAL_MS) );
+
+		EstimateResult resultCopy;
+
+		{
+			std::unique_lock<std::mutex> lock(resultMutex); // L O C K
+			resultCopy = result;
+		}
+
+		// stop early if intervals are narrow, e.g. because the tree is small or very regular
+
+		bool isPrecise = (resultCopy.numProbes >= ESTIMATE_MIN_PROBES);
+
+		for(unsigned i=0; i < EstimateValue_COUNT; i++)
+		{
+			double value;
+			double halfWidth;
+
+			getEstimateInterval(resultCopy, i, value, halfWidth);
+
+			if(halfWidth > (value * ESTIMATE_PRECISE_REL_HALFWIDTH) )
+				isPrecise = false;
+		}
+
+		if(isPrecise)
+			break;
+
+		if(config.printSummary && (std::chrono::steady_clock::now() >= nextPrintTime) )
+		{
+			printEstimate(resultCopy, false);
+			nextPrintTime += std::chrono::seconds(1);
+		}
+	}
+
+	stopProbes = true;
+
+	for(std::thread& probeThread : probeThreads)
+		probeThread.join();
+
+	printEstimate(result, true);
+
+	return retVal;
+}
+
+/**
+ * Merge the "--report-hotdirs" candidates of all threads and print the dirs with the longest wall
+ * time and the dirs with the most entries.
+ *
+ * This may only be called after all scan threads terminated.
+ */
+void printHotDirs()
+{
+	if(!config.hotDirsNum)
+		return; // nothing to do
+
+	BoundedTopHeap<HotDirEntry> mergedHotDirsByTime(config.hotDirsNum);
+	BoundedTopHeap<HotDirEntry> mergedHotDirsByEntries(config.hotDirsNum);
+
+	for(ThreadData& threadData : state.threadDataList)
+	{
+		mergedHotDirsByTime.mergeFrom(threadData.hotDirsByTime);
+		mergedHotDirsByEntries.mergeFrom(threadData.hotDirsByEntries);
+	}
+
+	auto printHotDirVec = [](const char* sortKeyStr, const std::vector<HotDirEntry>& hotDirVec)
+	{
+		if(config.printJSON)
+			printf("{\"hotdirs\":\"%s\",\"dirs\":[", sortKeyStr);
+		else
+			printf("HOT DIRS BY %s: (unit: milliseconds)\n", sortKeyStr);
+
+		for(size_t i=0; i < hotDirVec.size(); i++)
+		{
+			const HotDirEntry& hotDir = hotDirVec[i];
+
+			if(config.printJSON)
+				printf("%s{\"path\":\"%s\",\"wall_ms\":%.3f,\"stat_ms\":%.3f,"
+					"\"entries\":%" PRIu64 "}",
+					i ? "," : "", escapeStrforJSON(hotDir.path).c_str(),
+					hotDir.wallNanoSecs / 1000000.0, hotDir.statNanoSecs / 1000000.0,
+					hotDir.numEntries);
+			else
+				printf("  * wall: %.3f; stat: %.3f; entries: %" PRIu64 "; %s\n",
+					hotDir.wallNanoSecs / 1000000.0, hotDir.statNanoSecs / 1000000.0,
+					hotDir.numEntries, hotDir.path.c_str() );
+		}
+
+		if(config.printJSON)
+			printf("]}\n");
+	};
+
+	printHotDirVec(config.printJSON ? "time" : "TIME", mergedHotDirsByTime.extractSorted() );
+	printHotDirVec(config.printJSON ? "entries" : "ENTRIES",
+		mergedHotDirsByEntries.extractSorted() );
+}
+
+/**
+ * Get the name of a filesystem call type for "--latency".
+ */
+const char* getSyscallTypeStr(SyscallType type)
+{
+	switch(type)
+	{
+		case SyscallType_OPENDIR: return "opendir";
+		case SyscallType_READDIR: return "readdir";
+		case SyscallType_STAT: return "stat";
+		case SyscallType_OPEN: return "open";
+		case SyscallType_READ: return "read";
+		case SyscallType_WRITE: return "write";
+		case SyscallType_MKDIR: return "mkdir";
+		case SyscallType_UNLINK: return "unlink";
+		case SyscallType_GETXATTR: return "getxattr";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Get the name of a thread time type for thread utilization stats.
+ */
+const char* getThreadTimeTypeStr(ThreadTimeType type)
+{
+	switch(type)
+	{
+		case ThreadTimeType_READDIR: return "readdir";
+		case ThreadTimeType_STAT: return "stat";
+		case ThreadTimeType_PROCESSING: return "processing";
+		case ThreadTimeType_OUTPUT: return "output";
+		case ThreadTimeType_WAIT: return "waiting";
+		default: return "unknown";
+	}
+}
+
+/**
+ * Merge the filesystem call latency histograms of all threads for "--latency".
+ *
+ * @return histograms indexed by SyscallType.
+ */
+std::vector<LatencyHistogram> getMergedSyscallLatencies()
+{
+	std::vector<LatencyHistogram> mergedLatencyVec(SyscallType_COUNT);
+
+	std::unique_lock<std::mutex> lock(state.threadDataListMutex); // L O C K
+
+	for(ThreadData& threadData : state.threadDataList)
+		for(size_t i=0; i < threadData.syscallLatencyVec.size(); i++)
+			mergedLatencyVec[i].mergeFrom(threadData.syscallLatencyVec[i] );
+
+	return mergedLatencyVec;
+}
+
+/**
+ * Print percentiles of filesystem call latencies for "--latency" as part of the summary.
+ */
+void printSyscallLatencies()
+{
+	std::vector<LatencyHistogram> mergedLatencyVec = getMergedSyscallLatencies();
+
+	std::cerr << "SYSCALL LATENCY: (unit: microseconds)" << std::endl;
+
+	std::cerr << std::fixed << std::setprecision(1);
+
+	for(size_t i=0; i < SyscallType_COUNT; i++)
+	{
+		const LatencyHistogram& histogram = mergedLatencyVec[i];
+
+		if(!histogram.getNumValues() )
+			continue; // syscall type was not used
+
+		std::cerr << "  * " << std::left << std::setfill(' ') << std::setw(9) <<
+			getSyscallTypeStr( (SyscallType)i) << std::right <<
+			"count: " << histogram.getNumValues() << "; " <<
+			"p50: " << (histogram.getPercentileValue(50) / 1000.0) << "; " <<
+			"p99: " << (histogram.getPercentileValue(99) / 1000.0) << "; " <<
+			"p999: " << (histogram.getPercentileValue(99.9) / 1000.0) << "; " <<
+			"max: " << (histogram.getMaxValue() / 1000.0) << std::endl;
+	}
+}
+
+/**
+ * Get the total number and total latency of the namespace calls (opendir, readdir, stat) of all
+ * threads so far.
+ */
+void getNamespaceSyscallLatencySums(uint64_t& outNumCalls, uint64_t& outSumLatencyNanoSecs)
+{
+	outNumCalls = 0;
+	outSumLatencyNanoSecs = 0;
+
+	std::unique_lock<std::mutex> lock(state.threadDataListMutex); // L O C K
+
+	for(ThreadData& threadData : state.threadDataList)
+	{
+		if(threadData.syscallLatencyVec.empty() )
+			continue; // not a scan thread
+
+		for(SyscallType syscallType : {SyscallType_OPENDIR, SyscallType_READDIR, SyscallType_STAT} )
+		{
+			outNumCalls += threadData.syscallLatencyVec[syscallType].getNumValues();
+			outSumLatencyNanoSecs += threadData.syscallLatencyVec[syscallType].getSumValues();
+		}
+	}
+}
+
+/**
+ * AIMD controller of the active scan threads limit in sharedStack for "--threads auto" and
+ * "--background". The baseline is the lowest mean latency of namespace calls in an interval. The
+ * limit grows additively while dirs are waiting in the stack for a thread. It shrinks
+ * multiplicatively when latency is above the baseline and throughput did not increase, i.e. when
+ * the storage is saturated and more threads only add queueing.
+ *
+ * With a fixed baseline (for "--background"), the baseline is only measured in the first updates
+ * and the limit shrinks whenever latency is above it, even if our own throughput increases,
+ * because the higher latency also hits other users of the storage.
+ */
+class ConcurrencyController
+{
+	public:
+		ConcurrencyController(unsigned minLimit, unsigned maxLimit, bool isBaselineFixed) :
+			minLimit(minLimit), maxLimit(maxLimit), isBaselineFixed(isBaselineFixed)
+		{
+			limit = sharedStack.getActiveThreadsLimit();
+			stats.maxLimit = limit;
+		}
+
+	private:
+		unsigned minLimit;
+		unsigned maxLimit;
+		bool isBaselineFixed; // true to measure baseline only in the first updates
+		unsigned numBaselineUpdates {0}; // updates with enough calls to measure baseline
+		unsigned limit; // current active threads limit
+		uint64_t lastNumCalls {0};
+		uint64_t lastSumLatencyNanoSecs {0};
+		double lastCallsPerSec {0};
+		double baselineLatencyNanoSecs {0}; // 0 until first update with enough calls
+		std::chrono::steady_clock::time_point lastUpdateTime {std::chrono::steady_clock::now()};
+		double sumLimitSecs {0}; // limit multiplied by time, for time-weighted average
+		double sumSecs {0};
+		ConcurrencyControlStats stats;
+
+		void setLimit(unsigned newLimit)
+		{
+			if(newLimit == limit)
+				return;
+
+			if(newLimit > limit)
+				stats.numIncreases++;
+			else
+				stats.numDecreases++;
+
+			limit = newLimit;
+			stats.maxLimit = std::max(stats.maxLimit, limit);
+
+			sharedStack.setActiveThreadsLimit(limit);
+		}
+
+	public:
+		/**
+		 * Adapt the limit based on the filesystem calls since the last update. Meant to be
+		 * called periodically.
+		 */
+		void update()
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			double intervalSecs = std::chrono::duration_cast<std::chrono::microseconds>(
+				now - lastUpdateTime).count() / 1000000.0;
+
+			lastUpdateTime = now;
+			sumLimitSecs += limit * intervalSecs;
+			sumSecs += intervalSecs;
+
+			uint64_t numCalls;
+			uint64_t sumLatencyNanoSecs;
+
+			getNamespaceSyscallLatencySums(numCalls, sumLatencyNanoSecs);
+
+			uint64_t numIntervalCalls = numCalls - lastNumCalls;
+			uint64_t sumIntervalLatencyNanoSecs = sumLatencyNanoSecs - lastSumLatencyNanoSecs;
+
+			lastNumCalls = numCalls;
+			lastSumLatencyNanoSecs = sumLatencyNanoSecs;
+
+			if( (numIntervalCalls < CONCURRENCY_CTRL_MIN_OPS) || (intervalSecs <= 0) )
+				return; // not enough samples for a decision, e.g. because threads are idle
+
+			double meanLatencyNanoSecs = (double)sumIntervalLatencyNanoSecs / numIntervalCalls;
+			double callsPerSec = numIntervalCalls / intervalSecs;
+
+			if(isBaselineFixed && (numBaselineUpdates >= CONCURRENCY_CTRL_BASELINE_UPDATES) )
+				{} // baseline measurement is done
+			else
+			if(!baselineLatencyNanoSecs || (meanLatencyNanoSecs < baselineLatencyNanoSecs) )
+				baselineLatencyNanoSecs = meanLatencyNanoSecs;
+			else
+			if(!isBaselineFixed) // (slowly follow the workload, e.g. for a slower subtree)
+				baselineLatencyNanoSecs += CONCURRENCY_CTRL_BASELINE_DRIFT *
+					(meanLatencyNanoSecs - baselineLatencyNanoSecs);
+
+			numBaselineUpdates++;
+
+			bool isLatencyHigh =
+				meanLatencyNanoSecs > (baselineLatencyNanoSecs * CONCURRENCY_CTRL_LATENCY_FACTOR);
+			bool isThroughputGain = callsPerSec > (lastCallsPerSec * CONCURRENCY_CTRL_GAIN_FACTOR);
+
+			lastCallsPerSec = callsPerSec;
+
+			if(isLatencyHigh && (isBaselineFixed || !isThroughputGain) )
+				setLimit(std::max(minLimit, (unsigned)(limit * CONCURRENCY_CTRL_DECREASE) ) );
+			else
+			if(sharedStack.getSize() &&
+				( (config.numThreads - sharedStack.getNumWaiters() ) >= limit) )
+				setLimit(std::min(maxLimit, limit + CONCURRENCY_CTRL_INCREASE) );
+		}
+
+		ConcurrencyControlStats getStats() const
+		{
+			ConcurrencyControlStats finalStats = stats;
+
+			finalStats.finalLimit = limit;
+			finalStats.avgLimit = sumSecs ? (sumLimitSecs / sumSecs) : limit;
+
+			return finalStats;
+		}
+};
+
+/**
+ * Starting point for the thread that adapts the active scan threads limit for "--threads auto"
+ * and "--background". Terminates when the scan threads are done.
+ */
+void concurrencyControlThreadStart()
+{
+	/* "--background" alone can only reduce the configured number of threads; with
+		"--threads auto", it only adds the fixed baseline. */
+	ConcurrencyController controller(config.autoThreads ? config.autoThreadsMin : 1,
+		config.autoThreads ? config.autoThreadsMax : config.numThreads, config.background);
+
+	std::chrono::steady_clock::time_point nextUpdateTime = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
+
+	while(!state.scanThreadsDone)
+	{
+		nextUpdateTime += std::chrono::milliseconds(CONCURRENCY_CTRL_INTERVAL_MS);
+
+		state.scanThreadsDoneCondition.wait_until(lock, nextUpdateTime,
+			[]{ return state.scanThreadsDone; } );
+
+		if(state.scanThreadsDone)
+			break;
+
+		lock.unlock(); // (scan threads need sharedStack lock; no need to block them here)
+
+		controller.update();
+
+		lock.lock();
+	}
+
+	state.concurrencyControlStats = controller.getStats();
+}
+
+/**
+ * Aggregated thread utilization stats of all scan threads.
+ */
+struct ThreadUtilization
+{
+	double totalThreadSecs; // number of scan threads multiplied by scan duration
+	double threadTimeSecs[ThreadTimeType_COUNT]; // processing time excludes output time
+	double otherSecs; // time that is not in any of the ThreadTimeType categories
+	uint64_t numBreadthPushes {0};
+	uint64_t numDepthRecursions {0};
+	uint64_t maxStackSize;
+};
+
+/**
+ * Aggregate thread utilization stats over all threads.
+ */
+ThreadUtilization getThreadUtilization()
+{
+	ThreadUtilization utilization;
+	uint64_t threadTimeNanoSecs[ThreadTimeType_COUNT] {};
+
+	for(ThreadData& threadData : state.threadDataList)
+	{
+		for(unsigned i=0; i < ThreadTimeType_COUNT; i++)
+			threadTimeNanoSecs[i] += threadData.threadTimeNanoSecs[i];
+
+		utilization.numBreadthPushes += threadData.numBreadthPushes;
+		utilization.numDepthRecursions += threadData.numDepthRecursions;
+	}
+
+	// (processing time includes output time, so subtract that to get separate values)
+	threadTimeNanoSecs[ThreadTimeType_PROCESSING] -= std::min(
+		threadTimeNanoSecs[ThreadTimeType_PROCESSING], threadTimeNanoSecs[ThreadTimeType_OUTPUT] );
+
+	utilization.totalThreadSecs = config.numThreads * std::chrono::duration_cast<
+		std::chrono::microseconds>(state.scanEndTime - state.scanStartTime).count() / 1000000.0;
+
+	utilization.otherSecs = utilization.totalThreadSecs;
+
+	for(unsigned i=0; i < ThreadTimeType_COUNT; i++)
+	{
+		utilization.threadTimeSecs[i] = threadTimeNanoSecs[i] / 1000000000.0;
+		utilization.otherSecs -= utilization.threadTimeSecs[i];
+	}
+
+	utilization.otherSecs = std::max(utilization.otherSecs, 0.0);
+
+	utilization.maxStackSize = sharedStack.getMaxSize();
+
+	return utilization;
+}
+
+/**
+ * Print how the scan threads spent their time and how dirs were handed over between threads as
+ * part of the verbose summary.
+ */
+void printThreadUtilization()
+{
+	ThreadUtilization utilization = getThreadUtilization();
+
+	// (avoid division by zero)
+	double totalThreadSecs = (utilization.totalThreadSecs > 0) ? utilization.totalThreadSecs : 1;
+
+	std::cerr << "THREAD UTILIZATION: (sum of " << config.numThreads << " scan threads; " <<
+		std::fixed << std::setprecision(3) << utilization.totalThreadSecs << "s total)" <<
+		std::endl;
+
+	for(unsigned i=0; i <= ThreadTimeType_COUNT; i++)
+	{
+		// (last iteration is for "other")
+		std::string nameStr = std::string( (i < ThreadTimeType_COUNT) ?
+			getThreadTimeTypeStr( (ThreadTimeType)i) : "other") + ":";
+		double threadTimeSecs = (i < ThreadTimeType_COUNT) ?
+			utilization.threadTimeSecs[i] : utilization.otherSecs;
+
+		std::cerr << "  * " << std::left << std::setfill(' ') << std::setw(15) <<
+			nameStr << std::right << std::setprecision(3) << threadTimeSecs << "s (" <<
+			std::setprecision(1) << (100 * threadTimeSecs / totalThreadSecs) << "%)" << std::endl;
+	}
+
+	std::cerr << "  * dir handoff:   " <<
+		"breadth pushes: " << utilization.numBreadthPushes << "; " <<
+		"depth recursions: " << utilization.numDepthRecursions << "; " <<
+		"max stack size: " << utilization.maxStackSize << std::endl;
+}
+
+/**
+ * Get a device ID in "major:minor" notation.
+ */
+std::string getDevIDStr(uint64_t devID)
+{
+	if(devID == DEV_ID_NONE)
+		return "unknown";
+
+	return std::to_string(major(devID) ) + ":" + std::to_string(minor(devID) );
+}
+
+/**
+ * Print the threads limit and number of scanned dirs per device as part of the verbose summary.
+ */
+void printDevQueueStats()
+{
+	std::vector<DevQueueStats> devQueueStatsVec = sharedStack.getDevQueueStats();
+
+	std::cerr << "DEVICES:" << std::endl;
+
+	for(const DevQueueStats& devQueueStats : devQueueStatsVec)
+		std::cerr << "  * " << std::left << std::setfill(' ') << std::setw(15) <<
+			(getDevIDStr(devQueueStats.devID) + ":") << std::right <<
+			"threads limit: " << (devQueueStats.threadsLimit ?
+				std::to_string(devQueueStats.threadsLimit) : "none") << "; " <<
+			"max active threads: " << devQueueStats.maxActiveThreads << "; " <<
+			"dirs from stack: " << devQueueStats.numDirsPopped << std::endl;
+}
+
+/**
+ * Print summary at end of run.
+ */
+void printSummary()
+{
+	if(!config.printSummary)
+		return; // summary disabled
+
+	std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+	std::chrono::microseconds elapsedMicroSec =
+		std::chrono::duration_cast<std::chrono::microseconds>(endTime - state.startTime);
+
+	uint64_t elapsedSec = elapsedMicroSec.count() / 1000000;
+	uint64_t elapsedMilliSecRemainder = (elapsedMicroSec.count() % 1000000) / 1000;
+
+	uint64_t scanEntriesTotal = statistics.numDirsFound + statistics.numFilesFound;
+	uint64_t scanEntriesPerSec =
+		( (double)scanEntriesTotal / elapsedMicroSec.count() ) * 1000000;
+	uint64_t copyMiBTotal = statistics.numBytesCopied / (1024*1024);
+	uint64_t copyMiBPerSec = ( (double)copyMiBTotal / elapsedMicroSec.count() ) * 1000000;
+	uint64_t readMiBTotal = statistics.numBytesRead / (1024*1024);
+	uint64_t readMiBPerSec = ( (double)readMiBTotal / elapsedMicroSec.count() ) * 1000000;
+
+
+	if(config.printVerbose)
+	{
+		std::cerr << "CONFIG:" << std::endl;
+		std::cerr << "  * threads:       " << config.numThreads << std::endl;
+		std::cerr << "  * godeep:        " << config.depthSearchStartThreshold << std::endl;
+		std::cerr << "  * flags:         " <<
+			"stat: " << config.statAll << "; " <<
+			"aclcheck: " << config.checkACLs << std::endl;
+
+		if(config.checksumAlgo == ChecksumAlgo_SHA256)
+			std::cerr << "  * sha256:        " << (Sha256Hasher::isHardwareAccelerated() ?
+				"hardware accelerated" : "portable implementation") << std::endl;
+	}
+
+
+	try
+	{
+		std::cerr.imbue(std::locale("") );
+	}
+	catch(std::runtime_error& exception)
+	{
+		/* static binaries from Alpine fail on Ubuntu with std::runtime_error
+			"locale::facet::_S_create_c_locale name not valid". however, this is just for nicer
+			number formatting, so not ciritical.*/
+	}
+
+	std::cerr << "STATISTICS:" << std::endl;
+
+	std::cerr << "  * entries found: " <<
+			"files: " << statistics.numFilesFound << "; " <<
+			"dirs: " << statistics.numDirsFound << "; " <<
+			"filter matches: " << statistics.numFilterMatches << std::endl;
+
+	std::cerr << "  * special cases: " <<
+			"unknown type: " << statistics.numUnknownFound << "; " <<
+			"errors: " << statistics.numErrors << std::endl;
+
+	if(statistics.numStatCalls)
+		std::cerr << "  * stat calls:    " << statistics.numStatCalls << std::endl;
+
+	if(config.checkACLs)
+		std::cerr << "  * ACLs found:    " <<
+			statistics.numAccessACLsFound << " access; " <<
+			statistics.numDefaultACLsFound << " default" << std::endl;
+
+	std::cerr << "  * scan speed:    " <<
+		scanEntriesPerSec << " entries/s; " <<
+		"runtime: " << elapsedSec << "." <<	std::setfill('0') << std::setw(3) <<
+			elapsedMilliSecRemainder << "s" << std::endl;
+
+	if(!config.copyDestDir.empty() )
+		std::cerr << "  * copy speed:    " <<
+			copyMiBPerSec << " MiB/s; " <<
+			"total: " << copyMiBTotal << " MiB; " <<
+			"skipped files: " << statistics.numFilesNotCopied << std::endl;
+
+	if(statistics.numBytesRead)
+		std::cerr << "  * read speed:    " <<
+			readMiBPerSec << " MiB/s; " <<
+			"total: " << readMiBTotal << " MiB" << std::endl;
+
+	if(config.autoThreads || config.background)
+	{
+		char avgLimitStr[32];
+		snprintf(avgLimitStr, sizeof(avgLimitStr), "%.1f",
+			state.concurrencyControlStats.avgLimit);
+
+		std::cerr << "  * threads:       " <<
+			(config.autoThreads ? "auto" : "") <<
+			( (config.autoThreads && config.background) ? "+" : "") <<
+			(config.background ? ARG_BACKGROUND_LONG : "") << " (" <<
+			(config.autoThreads ? config.autoThreadsMin : 1) << "-" <<
+			(config.autoThreads ? config.autoThreadsMax : config.numThreads) << "); " <<
+			"limit: final: " << state.concurrencyControlStats.finalLimit << "; " <<
+			"max: " << state.concurrencyControlStats.maxLimit << "; " <<
+			"avg: " << avgLimitStr << std::endl;
+	}
+
+	if(state.scanPartialReason)
+		std::cerr << "  * PARTIAL:       " <<
+			"scan stopped early, results are incomplete (" << state.scanPartialReason << ")" <<
+			std::endl;
+
+	if(config.measureThreadTimes)
+		printThreadUtilization();
+
+	if(config.printVerbose &&
+		(config.devThreads || config.devThreadsAuto || (config.scanPaths.size() > 1) ) )
+		printDevQueueStats();
+
+	if(config.measureSyscallLatency)
+		printSyscallLatencies();
+}
+
+/**
+ * Write statistics, config, resource usage and timings as a single JSON document to the file given
+ * by "--summary-json".
+ *
+ * @return false on error, in which case an error message was already printed.
+ */
+bool writeSummaryJSON()
+{
+	if(config.summaryJSONPath.empty() )
+		return true; // nothing to do
+
+	std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+	auto getSecs = [](std::chrono::steady_clock::time_point fromTime,
+		std::chrono::steady_clock::time_point toTime)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(toTime - fromTime).count() /
+			1000000.0;
+	};
+
+	double elapsedSecs = getSecs(state.startTime, endTime);
+	uint64_t numEntries = statistics.numDirsFound + statistics.numFilesFound;
+
+	struct rusage resourceUsage;
+	getrusage(RUSAGE_SELF, &resourceUsage);
+
+	std::ostringstream jsonStream;
+
+	jsonStream << std::fixed << std::setprecision(6);
+
+	jsonStream << "{" <<
+		"\"version\":\"" << EXE_VERSION << "\"," <<
+		"\"elapsed_sec\":" << elapsedSecs << "," <<
+		"\"partial\":" << (state.scanPartialReason ? "true" : "false") << "," <<
+		"\"partial_reason\":" << (state.scanPartialReason ?
+			("\"" + std::string(state.scanPartialReason) + "\"") : "null") << ",";
+
+	jsonStream << "\"phases\":{" <<
+		"\"setup_sec\":" << getSecs(state.startTime, state.scanStartTime) << "," <<
+		"\"scan_sec\":" << getSecs(state.scanStartTime, state.scanEndTime) << "," <<
+		"\"reports_sec\":" << getSecs(state.scanEndTime, endTime) << "},";
+
+	std::string scanPathsStr;
+
+	for(const std::string& scanPath : config.scanPaths)
+		scanPathsStr += (scanPathsStr.empty() ? "\"" : ",\"") + escapeStrforJSON(scanPath) + "\"";
+
+	jsonStream << "\"config\":{" <<
+		"\"paths\":[" << scanPathsStr << "]," <<
+		"\"threads\":" << config.numThreads << "," <<
+		"\"godeep\":" << config.depthSearchStartThreshold << "," <<
+		"\"maxdepth\":" << config.maxDirDepth << "," <<
+		"\"xdev\":" << (config.stayOnDevice ? "true" : "false") << "," <<
+		"\"threads_auto\":" << (config.autoThreads ? "true" : "false") << "," <<
+		"\"background\":" << (config.background ? "true" : "false") << "," <<
+		"\"dev_threads\":" << (config.devThreadsAuto ?
+			"\"" DEV_THREADS_AUTO_STR "\"" : std::to_string(config.devThreads) ) << "," <<
+		"\"stat\":" << (config.statAll ? "true" : "false") << "," <<
+		"\"aclcheck\":" << (config.checkACLs ? "true" : "false") << "," <<
+		"\"time_limit_sec\":" << config.timeLimitSecs << "," <<
+		"\"max_entries\":" << config.maxEntries << "," <<
+		"\"limit\":" << config.matchLimit << "},";
+
+	if(config.autoThreads || config.background)
+		jsonStream << "\"threads_auto\":{" <<
+			"\"min\":" << (config.autoThreads ? config.autoThreadsMin : 1) << "," <<
+			"\"max\":" << (config.autoThreads ? config.autoThreadsMax : config.numThreads) << "," <<
+			"\"final_limit\":" << state.concurrencyControlStats.finalLimit << "," <<
+			"\"max_limit\":" << state.concurrencyControlStats.maxLimit << "," <<
+			"\"avg_limit\":" << state.concurrencyControlStats.avgLimit << "," <<
+			"\"increases\":" << state.concurrencyControlStats.numIncreases << "," <<
+			"\"decreases\":" << state.concurrencyControlStats.numDecreases << "},";
+
+	std::vector<DevQueueStats> devQueueStatsVec = sharedStack.getDevQueueStats();
+
+	jsonStream << "\"devices\":[";
+
+	for(size_t i=0; i < devQueueStatsVec.size(); i++)
+		jsonStream << (i ? "," : "") << "{" <<
+			"\"dev\":\"" << getDevIDStr(devQueueStatsVec[i].devID) << "\"," <<
+			"\"threads_limit\":" << devQueueStatsVec[i].threadsLimit << "," <<
+			"\"max_active_threads\":" << devQueueStatsVec[i].maxActiveThreads << "," <<
+			"\"dirs_popped\":" << devQueueStatsVec[i].numDirsPopped << "}";
+
+	jsonStream << "],";
+
+	jsonStream << "\"statistics\":{" <<
+		"\"files\":" << statistics.numFilesFound << "," <<
+		"\"dirs\":" << statistics.numDirsFound << "," <<
+		"\"filter_matches\":" << statistics.numFilterMatches << "," <<
+		"\"unknown_type\":" << statistics.numUnknownFound << "," <<
+		"\"errors\":" << statistics.numErrors << "," <<
+		"\"stat_calls\":" << statistics.numStatCalls << "," <<
+		"\"access_acls\":" << statistics.numAccessACLsFound << "," <<
+		"\"default_acls\":" << statistics.numDefaultACLsFound << "," <<
+		"\"bytes_copied\":" << statistics.numBytesCopied << "," <<
+		"\"files_not_copied\":" << statistics.numFilesNotCopied << "," <<
+		"\"bytes_read\":" << statistics.numBytesRead << "," <<
+		"\"entries_per_sec\":" << (elapsedSecs ? (numEntries / elapsedSecs) : 0) << "},";
+
+	jsonStream << "\"rusage\":{" <<
+		"\"user_cpu_sec\":" << (resourceUsage.ru_utime.tv_sec +
+			(resourceUsage.ru_utime.tv_usec / 1000000.0) ) << "," <<
+		"\"sys_cpu_sec\":" << (resourceUsage.ru_stime.tv_sec +
+			(resourceUsage.ru_stime.tv_usec / 1000000.0) ) << "," <<
+		"\"voluntary_ctx_switches\":" << resourceUsage.ru_nvcsw << "," <<
+		"\"involuntary_ctx_switches\":" << resourceUsage.ru_nivcsw << "," <<
+		"\"minor_page_faults\":" << resourceUsage.ru_minflt << "," <<
+		"\"major_page_faults\":" << resourceUsage.ru_majflt << "," <<
+		"\"max_rss_kib\":" << resourceUsage.ru_maxrss << "},"; // (linux reports KiB)
+
+	ThreadUtilization utilization = getThreadUtilization();
+
+	jsonStream << "\"threads\":{" <<
+		"\"total_sec\":" << utilization.totalThreadSecs << ",";
+
+	for(unsigned i=0; i < ThreadTimeType_COUNT; i++)
+		jsonStream << "\"" << getThreadTimeTypeStr( (ThreadTimeType)i) << "_sec\":" <<
+			utilization.threadTimeSecs[i] << ",";
+
+	jsonStream <<
+		"\"other_sec\":" << utilization.otherSecs << "," <<
+		"\"breadth_pushes\":" << utilization.numBreadthPushes << "," <<
+		"\"depth_recursions\":" << utilization.numDepthRecursions << "," <<
+		"\"max_stack_size\":" << utilization.maxStackSize << "}";
+
+	if(config.measureSyscallLatency)
+	{
+		std::vector<LatencyHistogram> mergedLatencyVec = getMergedSyscallLatencies();
+		bool isFirstSyscallType = true;
+
+		jsonStream << ",\"syscall_latency_usec\":{";
+
+		for(size_t i=0; i < SyscallType_COUNT; i++)
+		{
+			const LatencyHistogram& histogram = mergedLatencyVec[i];
+
+			if(!histogram.getNumValues() )
+				continue; // syscall type was not used
+
+			jsonStream << (isFirstSyscallType ? "" : ",") <<
+				"\"" << getSyscallTypeStr( (SyscallType)i) << "\":{" <<
+				"\"count\":" << histogram.getNumValues() << "," <<
+				"\"p50\":" << (histogram.getPercentileValue(50) / 1000.0) << "," <<
+				"\"p99\":" << (histogram.getPercentileValue(99) / 1000.0) << "," <<
+				"\"p999\":" << (histogram.getPercentileValue(99.9) / 1000.0) << "," <<
+				"\"max\":" << (histogram.getMaxValue() / 1000.0) << "}";
+
+			isFirstSyscallType = false;
+		}
+
+		jsonStream << "}";
+	}
+
+	jsonStream << "}" << std::endl;
+
+	FILE* summaryFile = fopen(config.summaryJSONPath.c_str(), "w");
+	if(!summaryFile)
+	{
+		fprintf(stderr, "Failed to open JSON summary file: %s; Error: %s\n",
+			config.summaryJSONPath.c_str(), strerror(errno) );
+		return false;
+	}
+
+	std::string jsonStr = jsonStream.str();
+
+	size_t writeRes = fwrite(jsonStr.data(), 1, jsonStr.length(), summaryFile);
+	int closeRes = fclose(summaryFile);
+
+	if( (writeRes != jsonStr.length() ) || closeRes)
+	{
+		fprintf(stderr, "Failed to write JSON summary file: %s; Error: %s\n",
+			config.summaryJSONPath.c_str(), strerror(errno) );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Append an unlabeled prometheus metric with HELP and TYPE lines to the given stream.
+ */
+void addPrometheusMetric(std::ostringstream& metricsStream, const char* name, const char* type,
+	const char* help, uint64_t value)
+{
+	metricsStream <<
+		"# HELP " METRICS_NAME_PREFIX << name << " " << help << "\n" <<
+		"# TYPE " METRICS_NAME_PREFIX << name << " " << type << "\n" <<
+		METRICS_NAME_PREFIX << name << " " << value << "\n";
+}
+
+/**
+ * Write current statistics in prometheus text format to config.metricsFilePath for
+ * "--metrics-file". The file gets written under a temporary name and then renamed, so that a
+ * reader like the node_exporter textfile collector never sees a partial file. Can be called while
+ * the scan is running.
+ *
+ * @return false on error, in which case an error message was already printed.
+ */
+bool writeMetricsFile()
+{
+	// bucket bounds of latency histograms in nanoseconds (1-2-5 series from 1us to 10s)
+	const uint64_t latencyBucketBounds[] = { 1000, 2000, 5000, 10000, 20000, 50000,
+		100000, 200000, 500000, 1000000, 2000000, 5000000, 10000000, 20000000, 50000000,
+		100000000, 200000000, 500000000, 1000000000, 2000000000, 5000000000, 10000000000 };
+
+	std::ostringstream metricsStream;
+
+	bool scanThreadsDone;
+
+	{
+		std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
+		scanThreadsDone = state.scanThreadsDone;
+	}
+
+	unsigned numActiveThreads = scanThreadsDone ?
+		0 : (config.numThreads - sharedStack.getNumWaiters() );
+
+	std::chrono::microseconds elapsedMicroSec =
+		std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - state.startTime);
+
+	metricsStream << std::fixed << std::setprecision(6);
+
+	metricsStream <<
+		"# HELP " METRICS_NAME_PREFIX "entries_total Discovered entries by type.\n" <<
+		"# TYPE " METRICS_NAME_PREFIX "entries_total counter\n" <<
+		METRICS_NAME_PREFIX "entries_total{type=\"file\"} " << statistics.numFilesFound << "\n" <<
+		METRICS_NAME_PREFIX "entries_total{type=\"dir\"} " << statistics.numDirsFound << "\n" <<
+		METRICS_NAME_PREFIX "entries_total{type=\"unknown\"} " << statistics.numUnknownFound <<
+			"\n";
+
+	addPrometheusMetric(metricsStream, "filter_matches_total", "counter",
+		"Entries that passed all filters.", statistics.numFilterMatches);
+	addPrometheusMetric(metricsStream, "stat_calls_total", "counter",
+		"Stat calls to query entry attributes.", statistics.numStatCalls);
+	addPrometheusMetric(metricsStream, "errors_total", "counter",
+		"Errors, e.g. permission errors.", statistics.numErrors);
+	addPrometheusMetric(metricsStream, "copied_bytes_total", "counter",
+		"Bytes written by copy.", statistics.numBytesCopied);
+	addPrometheusMetric(metricsStream, "read_bytes_total", "counter",
+		"File contents read, e.g. for checksums.", statistics.numBytesRead);
+	addPrometheusMetric(metricsStream, "queue_depth", "gauge",
+		"Directories waiting in the shared stack.", scanThreadsDone ? 0 : sharedStack.getSize() );
+	addPrometheusMetric(metricsStream, "active_threads", "gauge",
+		"Scan threads that are not waiting for work.", numActiveThreads);
+	addPrometheusMetric(metricsStream, "threads", "gauge",
+		"Configured number of scan threads.", config.numThreads);
+	addPrometheusMetric(metricsStream, "threads_limit", "gauge",
+		"Max number of active scan threads, e.g. set by \"--threads auto\".",
+		sharedStack.getActiveThreadsLimit() );
+	addPrometheusMetric(metricsStream, "scan_done", "gauge",
+		"1 if the scan has finished, 0 otherwise.", scanThreadsDone ? 1 : 0);
+
+	metricsStream <<
+		"# HELP " METRICS_NAME_PREFIX "elapsed_seconds Time since start.\n" <<
+		"# TYPE " METRICS_NAME_PREFIX "elapsed_seconds gauge\n" <<
+		METRICS_NAME_PREFIX "elapsed_seconds " << (elapsedMicroSec.count() / 1000000.0) << "\n";
+
+	if(config.measureSyscallLatency)
+	{
+		std::vector<LatencyHistogram> mergedLatencyVec = getMergedSyscallLatencies();
+
+		metricsStream <<
+			"# HELP " METRICS_NAME_PREFIX "syscall_latency_seconds Latency of filesystem calls.\n"
+			"# TYPE " METRICS_NAME_PREFIX "syscall_latency_seconds histogram\n";
+
+		for(size_t i=0; i < SyscallType_COUNT; i++)
+		{
+			const LatencyHistogram& histogram = mergedLatencyVec[i];
+			const std::string labelStr =
+				std::string("syscall=\"") + getSyscallTypeStr( (SyscallType)i) + "\"";
+
+			for(uint64_t bucketBound : latencyBucketBounds)
+				metricsStream << METRICS_NAME_PREFIX "syscall_latency_seconds_bucket{" <<
+					labelStr << ",le=\"" << (bucketBound / 1000000000.0) << "\"} " <<
+					histogram.getNumValuesUpTo(bucketBound) << "\n";
+
+			metricsStream <<
+				METRICS_NAME_PREFIX "syscall_latency_seconds_bucket{" << labelStr <<
+					",le=\"+Inf\"} " << histogram.getNumValues() << "\n" <<
+				METRICS_NAME_PREFIX "syscall_latency_seconds_sum{" << labelStr << "} " <<
+					(histogram.getSumValues() / 1000000000.0) << "\n" <<
+				METRICS_NAME_PREFIX "syscall_latency_seconds_count{" << labelStr << "} " <<
+					histogram.getNumValues() << "\n";
 		}
+	}
 
-		if(config.copyTimeUpdate)
-		{ // update timestamps
-			struct timespec newTimes[2] = {statBuf->st_atim, statBuf->st_mtim};
+	/* note: the textfile collector only reads files with ".prom" suffix, so the tmp file must not
+		have that suffix to avoid reading of partial files. */
+	std::string tmpFilePath = config.metricsFilePath + ".tmp";
 
-			int updateTimeRes = futimens(destFD, newTimes);
-			if(updateTimeRes == -1)
-			{
-				fprintf(stderr, "Failed to update timestamps of copy destination file: %s; "
-					"Error: %s\n", destPath.c_str(), strerror(errno) );
+	FILE* metricsFile = fopen(tmpFilePath.c_str(), "w");
+	if(!metricsFile)
+	{
+		fprintf(stderr, "Failed to open metrics file: %s; Error: %s\n",
+			tmpFilePath.c_str(), strerror(errno) );
+		return false;
+	}
 
-				statistics.numErrors++;
-			}
-		}
+	std::string metricsStr = metricsStream.str();
 
-		// regular file copy complete => cleanup
-		close(sourceFD);
-		close(destFD);
-		free(buf);
+	size_t writeRes = fwrite(metricsStr.data(), 1, metricsStr.length(), metricsFile);
+	int closeRes = fclose(metricsFile);
+
+	if( (writeRes != metricsStr.length() ) || closeRes)
+	{
+		fprintf(stderr, "Failed to write metrics file: %s; Error: %s\n",
+			tmpFilePath.c_str(), strerror(errno) );
+		unlink(tmpFilePath.c_str() );
+		return false;
 	}
-	else
+
+	int renameRes = rename(tmpFilePath.c_str(), config.metricsFilePath.c_str() );
+	if(renameRes == -1)
 	{
-		fprintf(stderr, "Skipping copy of entry due to non-regular file type. "
-			"Path: %s\n", entryPath.c_str() );
-		statistics.numFilesNotCopied++;
+		fprintf(stderr, "Failed to rename metrics file: %s -> %s; Error: %s\n",
+			tmpFilePath.c_str(), config.metricsFilePath.c_str(), strerror(errno) );
+		unlink(tmpFilePath.c_str() );
+		return false;
 	}
+
+	return true;
 }
 
 /**
- * Unlink entry if it's not a directory.
+ * Starting point for the thread that rewrites the metrics file at config.metricsIntervalSecs for
+ * "--metrics-file". Terminates when the scan threads are done. (The final metrics get written by
+ * the main thread.)
  */
-void unlinkEntry(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+void metricsThreadStart()
 {
-	if(!config.unlinkFiles)
-		return;
+	std::chrono::steady_clock::time_point nextWriteTime = state.startTime;
 
-	// config.statAll is forced to true when config.unlinkFiles is set
+	std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
 
-	if(S_ISDIR(statBuf->st_mode) )
-		return;
+	while(!state.scanThreadsDone)
+	{
+		nextWriteTime += std::chrono::seconds(config.metricsIntervalSecs);
 
-	if(config.printVerbose)
-		fprintf(stderr, "Unlinking: %s\n", entryPath.c_str() );
+		state.scanThreadsDoneCondition.wait_until(lock, nextWriteTime,
+			[]{ return state.scanThreadsDone; } );
 
-	int unlinkRes = unlink(entryPath.c_str() );
-	if(unlinkRes == -1)
-	{
-		fprintf(stderr, "Failed to unlink file: %s; Error: %s\n",
-			entryPath.c_str(), strerror(errno) );
+		if(state.scanThreadsDone)
+			break;
 
-		statistics.numErrors++;
+		lock.unlock(); // (writeMetricsFile needs scanThreadsDoneMutex and sharedStack lock)
 
-		EXIT_OR_RETURN_CONFIGURABLE(config.ignoreUnlinkErrors);
+		writeMetricsFile(); // (errors are not fatal here; next interval will try again)
+
+		lock.lock();
 	}
 }
 
 /**
- * Print entry either as plain newline-terminated string to console or in JSON format, depending
- * on config values.
- *
- * @dirEntry does not have to be provided if config.printJSON==false. otherwise it only needs to be
- * 		provided if statBuf is not provided, but there are special cases where it can still be
- * 		NULL, e.g. because it's a user-given path argument.
- * @statBuf does not have to be provided if config.printJSON==false. otherwise it only needs to be
- * 		provided if dirEntry->d_type==DT_UNKNOWN or config.statAll==true, but there are special
- * 		cases where it can still be NULL, e.g. if the stat() call returned an error.
+ * Get the name of a trace event type for "--trace".
  */
-void printEntry(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+const char* getTraceEventTypeStr(TraceEventType type)
 {
-	if(config.printEntriesDisabled)
-		return;
+	switch(type)
+	{
+		case TraceEventType_SCAN: return "scan";
+		case TraceEventType_WAIT: return "wait";
+		case TraceEventType_COPY: return "copy";
+		case TraceEventType_PUSH: return "push";
+		case TraceEventType_POP: return "pop";
+		default: return "unknown";
+	}
+}
 
-	if(!config.printJSON)
-	{ // simple print of path
-		printf("%s%c", entryPath.c_str(), (config.print0 ? '\0' : '\n') );
+/**
+ * Write the recorded events of all threads as chrome trace event JSON to config.traceFilePath for
+ * "--trace". The file can be loaded in chrome://tracing or ui.perfetto.dev. Must only be called
+ * after all threads terminated.
+ *
+ * @return false on error, in which case an error message was already printed.
+ */
+bool writeTraceFile()
+{
+	if(config.traceFilePath.empty() )
+		return true; // nothing to do
 
-		return;
+	FILE* traceFile = fopen(config.traceFilePath.c_str(), "w");
+	if(!traceFile)
+	{
+		fprintf(stderr, "Failed to open trace file: %s; Error: %s\n",
+			config.traceFilePath.c_str(), strerror(errno) );
+		return false;
 	}
 
-	// try to get dentry type from dirEntry or statBuf
+	auto getMicroSecs = [](std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			time - state.startTime).count() / 1000.0;
+	};
 
-	std::string dirEntryJSONType(DIRENTRY_JSON_TYPE_UNKNOWN);
+	uint64_t numDroppedEvents = 0;
+	unsigned threadIndex = 0;
 
-	if(dirEntry && (dirEntry->d_type != DT_UNKNOWN) )
-	{ // we can take type from dirEntry info
-		switch(dirEntry->d_type)
+	fprintf(traceFile, "{\"traceEvents\":[\n");
+
+	for(const ThreadData& threadData : state.threadDataList)
+	{
+		const TraceRingBuffer& traceRingBuf = threadData.traceRingBuf;
+
+		numDroppedEvents += traceRingBuf.getNumDropped();
+
+		fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+			"\"args\":{\"name\":\"thread %u\"}}",
+			threadIndex ? ",\n" : "", threadIndex, threadIndex);
+
+		for(size_t i=0; i < traceRingBuf.getNumEvents(); i++)
 		{
-			case DT_BLK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_BLK; break;
-			case DT_CHR: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_CHR; break;
-			case DT_DIR: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_DIR; break;
-			case DT_FIFO: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_FIFO; break;
-			case DT_LNK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_LNK; break;
-			case DT_REG: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_REG; break;
-			case DT_SOCK: 	dirEntryJSONType = DIRENTRY_JSON_TYPE_SOCK; break;
+			const TraceEvent& event = traceRingBuf.getEvent(i);
 
-			default:
-			{ // should never happen (but we try to continue with "unknown" if it does)
-				fprintf(stderr, "Encountered unexpected directory entry d_type. "
-					"Path: %s; d_type: %u\n", entryPath.c_str(), (unsigned)dirEntry->d_type);
-			} break;
-		}
-	}
-	else
-	if(statBuf)
-	{ // take type from stat() info
-		if(S_ISBLK(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_BLK;
-		else
-		if(S_ISCHR(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_CHR;
-		else
-		if(S_ISDIR(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_DIR;
-		else
-		if(S_ISFIFO(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_FIFO;
-		else
-		if(S_ISLNK(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_LNK;
-		else
-		if(S_ISREG(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_REG;
-		else
-		if(S_ISSOCK(statBuf->st_mode) )
-			dirEntryJSONType = DIRENTRY_JSON_TYPE_SOCK;
-		else
-		{ // should never happen (but we try to continue with "unknown" if it does)
-			fprintf(stderr, "Encountered unexpected directory entry stat st_mode. "
-				"Path: %s; st_mode: %u\n", entryPath.c_str(), (unsigned)statBuf->st_mode);
-		}
-	}
+			fprintf(traceFile, ",\n{\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,",
+				getTraceEventTypeStr(event.eventType), threadIndex,
+				getMicroSecs(event.startTime) );
 
+			switch(event.eventType)
+			{
+				case TraceEventType_SCAN:
+				case TraceEventType_COPY:
+				case TraceEventType_WAIT:
+				{
+					fprintf(traceFile, "\"ph\":\"X\",\"dur\":%.3f,",
+						getMicroSecs(event.endTime) - getMicroSecs(event.startTime) );
+				} break;
+
+				default:
+				{ // instant event
+					fprintf(traceFile, "\"ph\":\"i\",\"s\":\"t\",");
+				} break;
+			}
 
-	// print as JSON root object
+			fprintf(traceFile, "\"args\":{\"path\":\"%s\"",
+				escapeStrforJSON(event.path).c_str() );
 
-	if(!config.statAll)
-	{ // short JSON format
-		printf("{"
-			"\"path\":\"%s\","
-			"\"type\":\"%s\""
-			"}\n",
-			escapeStrforJSON(entryPath).c_str(),
-			dirEntryJSONType.c_str() );
+			switch(event.eventType)
+			{
+				case TraceEventType_SCAN:
+					fprintf(traceFile, ",\"entries\":%" PRIu64, event.value); break;
+				case TraceEventType_COPY:
+					fprintf(traceFile, ",\"size\":%" PRIu64, event.value); break;
+				case TraceEventType_PUSH:
+				case TraceEventType_POP:
+					fprintf(traceFile, ",\"stack_size\":%" PRIu64, event.value); break;
+				default:
+					break;
+			}
 
-		return;
+			fprintf(traceFile, "}}");
+		}
+
+		threadIndex++;
 	}
 
-	// long JSON format
-	// (note: statBuf might be NULL due to stat() error for this entry)
+	fprintf(traceFile, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{"
+		"\"version\":\"" EXE_VERSION "\","
+		"\"sample_interval\":%" PRIu64 ",\"dropped_events\":%" PRIu64 "}}\n",
+		config.traceSampleInterval, numDroppedEvents);
 
-	if(statBuf)
+	int errorRes = ferror(traceFile);
+	int closeRes = fclose(traceFile);
+
+	if(errorRes || closeRes)
 	{
-		printf("{"
-			"\"path\":\"%s\","
-			"\"type\":\"%s\","
-			"\"st_dev\":\"%" PRIu64 "\","
-			"\"st_ino\":\"%" PRIu64 "\","
-			"\"st_mode\":\"%" PRIu64 "\","
-			"\"st_nlink\":\"%" PRIu64 "\","
-			"\"st_uid\":\"%" PRIu64 "\","
-			"\"st_gid\":\"%" PRIu64 "\","
-			"\"st_rdev\":\"%" PRIu64 "\","
-			"\"st_size\":\"%" PRIu64 "\","
-			"\"st_blksize\":\"%" PRIu64 "\","
-			"\"st_blocks\":\"%" PRIu64 "\","
-			"\"st_atime\":\"%" PRIu64 "\","
-			"\"st_mtime\":\"%" PRIu64 "\","
-			"\"st_ctime\":\"%" PRIu64 "\""
-			"}\n",
-			escapeStrforJSON(entryPath).c_str(),
-			dirEntryJSONType.c_str(),
-			(uint64_t)statBuf->st_dev,
-			(uint64_t)statBuf->st_ino,
-			(uint64_t)statBuf->st_mode,
-			(uint64_t)statBuf->st_nlink,
-			(uint64_t)statBuf->st_uid,
-			(uint64_t)statBuf->st_gid,
-			(uint64_t)statBuf->st_rdev,
-			(uint64_t)statBuf->st_size,
-			(uint64_t)statBuf->st_blksize,
-			(uint64_t)statBuf->st_blocks,
-			(uint64_t)statBuf->st_atime,
-			(uint64_t)statBuf->st_mtime,
-			(uint64_t)statBuf->st_ctime);
+		fprintf(stderr, "Failed to write trace file: %s; Error: %s\n",
+			config.traceFilePath.c_str(), strerror(errno) );
+		return false;
 	}
-	else
-	{ // no statBuf (probably due to stat() error), so most fields are empty
-		printf("{"
-			"\"path\":\"%s\","
-			"\"type\":\"%s\","
-			"\"st_dev\":null,"
-			"\"st_ino\":null,"
-			"\"st_mode\":null,"
-			"\"st_nlink\":null,"
-			"\"st_uid\":null,"
-			"\"st_gid\":null,"
-			"\"st_rdev\":null,"
-			"\"st_size\":null,"
-			"\"st_blksize\":null,"
-			"\"st_blocks\":null,"
-			"\"st_atime\":null,"
-			"\"st_mtime\":null,"
-			"\"st_ctime\":null"
-			"}\n",
-			escapeStrforJSON(entryPath).c_str(),
-			dirEntryJSONType.c_str() );
+
+	if(numDroppedEvents && config.printVerbose)
+		fprintf(stderr, "NOTE: %" PRIu64 " oldest trace events were dropped because of full "
+			"buffers. (Hint: Use \"--" ARG_TRACESAMPLE_LONG "\" to reduce the number of events.)\n",
+			numDroppedEvents);
+
+	return true;
+}
+
+void printUsageAndExit()
+{
+	std::cout << EXE_NAME " - Parallel search for files & dirs" << std::endl;
+	std::cout << std::endl;
+	std::cout << "VERSION: " EXE_VERSION << std::endl;
+	std::cout << std::endl;
+	std::cout << "USAGE: " EXE_NAME " [OPTIONS...] [PATHS...]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "OPTIONS (in alphabetical order):" << std::endl;
+	std::cout << "  --atime NUM       - atime filter based on number of days in the past." << std::endl;
+	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
+	std::cout << "  --aclcheck        - Query ACLs of all discovered entries." << std::endl;
+	std::cout << "                      (Just for testing, does not change the result set.)" << std::endl;
+	std::cout << "  --background      - Be nice to other users of the storage: Scan with idle I/O" << std::endl;
+	std::cout << "                      and CPU priority, and reduce the number of active threads" << std::endl;
+	std::cout << "                      when the latency of dir reads and stat calls rises above" << std::endl;
+	std::cout << "                      the baseline that was measured at the start." << std::endl;
+	std::cout << "  --by KEY          - Sort key for \"--" ARG_TOP_LONG "\": "
+		"\"" TOP_SORTKEY_SIZE_STR "\", \"" TOP_SORTKEY_BLOCKS_STR "\", "
+		"\"" TOP_SORTKEY_MTIME_STR "\" or" << std::endl;
+	std::cout << "                      \"" TOP_SORTKEY_ATIME_STR "\". "
+		"Size and blocks select the largest entries," << std::endl;
+	std::cout << "                      timestamps select the oldest entries." << std::endl;
+	std::cout << "                      (Default: \"" TOP_SORTKEY_SIZE_STR "\")" << std::endl;
+	std::cout << "  --checksum ALGO   - Print checksums of regular files instead of paths. ALGO is" << std::endl;
+	std::cout << "                      \"" CHECKSUM_ALGO_SHA256_STR "\", \"" CHECKSUM_ALGO_XXH3_STR "\" (64-bit) or \"" CHECKSUM_ALGO_CRC32C_STR "\". Output is compatible" << std::endl;
+	std::cout << "                      with \"sha256sum -c\" and similar tools. (Xxh3 checksums" << std::endl;
+	std::cout << "                      get the \"" CHECKSUM_XXH3_PREFIX "\" prefix of \"xxhsum -H3\".) With" << std::endl;
+	std::cout << "                      \"--" ARG_JSON_LONG "\", the checksum is an additional field." << std::endl;
+	std::cout << "  --contains STR    - Filter on regular files that contain the given string." << std::endl;
+	std::cout << "                      This parameter can be given multiple times, in which" << std::endl;
+	std::cout << "                      case files containing any of the strings will pass." << std::endl;
+	std::cout << "                      Files are only read if they passed all other filters," << std::endl;
+	std::cout << "                      and only until the first match." << std::endl;
+	std::cout << "  --contains-any PATH - Like \"--" ARG_CONTAINS_LONG "\", but read strings from the given" << std::endl;
+	std::cout << "                      file. (One string per line.)" << std::endl;
+	std::cout << "  --copyto PATH     - Copy discovered files and dirs to this directory." << std::endl;
+	std::cout << "                      Only regular files, dirs and symlinks will be copied." << std::endl;
+	std::cout << "                      Hardlinks will not be preserved. Source and" << std::endl;
+	std::cout << "                      destination have to be dirs." << std::endl;
+	std::cout << "  --ctime NUM       - ctime filter based on number of days in the past." << std::endl;
+	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
+	std::cout << "  --dev-threads NUM - Max number of threads that scan dirs of the same device" << std::endl;
+	std::cout << "                      at the same time, so that a slow device can't hog all" << std::endl;
+	std::cout << "                      threads. \"" DEV_THREADS_AUTO_STR "\" sets " << DEV_THREADS_ROTATIONAL << " for rotational disks and no" << std::endl;
+	std::cout << "                      limit for SSDs and network filesystems. Dirs on other" << std::endl;
+	std::cout << "                      devices than their scan path are only detected with" << std::endl;
+	std::cout << "                      \"--" ARG_STAT_LONG "\". Anonymous devices (major 0, e.g. btrfs)" << std::endl;
+	std::cout << "                      always get no limit with \"" DEV_THREADS_AUTO_STR "\". (Default: no limit)" << std::endl;
+	std::cout << "  --duplicates      - Print groups of regular files with identical contents" << std::endl;
+	std::cout << "                      instead of individual entries. Groups are separated by" << std::endl;
+	std::cout << "                      an empty line. Only files with the same size get" << std::endl;
+	std::cout << "                      hashed partially, and only files with equal hashes get" << std::endl;
+	std::cout << "                      compared byte by byte." << std::endl;
+	std::cout << "                      Hardlinks are not considered as duplicates." << std::endl;
+	std::cout << "  --estimate        - Estimate number of entries and bytes by random probes down" << std::endl;
+	std::cout << "                      the tree instead of a full scan (Knuth's estimator)." << std::endl;
+	std::cout << "                      Prints 95% confidence intervals, intermediate results" << std::endl;
+	std::cout << "                      once per second to stderr. Filters are ignored." << std::endl;
+	std::cout << "  --estimate-time DURATION - Time budget for \"--" ARG_ESTIMATE_LONG "\". Suffixes: s, m, h, d." << std::endl;
+	std::cout << "                      (Implies \"--" ARG_ESTIMATE_LONG "\". Default: " << ESTIMATE_TIME_SECS_DEFAULT << "s)" << std::endl;
+	std::cout << "  --exec CMD ARGs ; - Execute the given system command and arguments for each" << std::endl;
+	std::cout << "                      discovered file/dir. The string '{}' in any arg will get" << std::endl;
+	std::cout << "                      replaced by the current file/dir path. The argument ';'" << std::endl;
+	std::cout << "                      marks the end of the command line to run." << std::endl;
+	std::cout << "                      (Example: elfindo --exec ls -lhd '{}' \\; --type d)" << std::endl;
+	std::cout << "  --fs-backend SPEC - Filesystem backend for scan, copy and unlink. SPEC is" << std::endl;
+	std::cout << "                      \"" FSBACKEND_POSIX_STR "\" (default) or \"" FSBACKEND_SYNTHETIC_STR "[:KEY=VAL,...]\" for a" << std::endl;
+	std::cout << "                      simulated in-memory tree below each scan path. Keys:" << std::endl;
+	std::cout << "                      fanout, depth, files (per dir), size (per file in" << std::endl;
+	std::cout << "                      bytes or with suffix of \"--" ARG_FILTER_SIZE "\")," << std::endl;
+	std::cout << "                      latency and jitter (per call; suffixes: ns, us, ms, s)," << std::endl;
+	std::cout << "                      error-rate (0..1), errno (EACCES (default), EIO, ENOENT," << std::endl;
+	std::cout << "                      ESTALE, ETIMEDOUT) and seed. Copies to synthetic backend are" << std::endl;
+	std::cout << "                      discarded. (Example: " FSBACKEND_SYNTHETIC_STR ":fanout=10,depth=4,latency=2ms)" << std::endl;
+	std::cout << "  --gid NUM         - Filter based on numeric group ID." << std::endl;
+	std::cout << "  --godeep NUM      - Threshold to switch from breadth to depth search." << std::endl;
+	std::cout << "                      (Default: number of scan threads)" << std::endl;
+	std::cout << "  --group STR       - Filter based on group name or numeric group ID." << std::endl;
+	std::cout << "  --hash-in PATH    - Filter on regular files with a checksum that is contained in" << std::endl;
+	std::cout << "                      the given file. Each line contains a hex checksum and" << std::endl;
+	std::cout << "                      optionally the file size in bytes. Algorithm is detected" << std::endl;
+	std::cout << "                      by checksum length: \"" CHECKSUM_ALGO_SHA256_STR "\", \"" CHECKSUM_ALGO_XXH3_STR "\" or \"" CHECKSUM_ALGO_CRC32C_STR "\". If sizes" << std::endl;
+	std::cout << "                      are given for all checksums, then files of other sizes" << std::endl;
+	std::cout << "                      are skipped without reading them. The matching checksum" << std::endl;
+	std::cout << "                      is printed in \"hash_match\" of JSON output (not in plain" << std::endl;
+	std::cout << "                      text output, which only has the path). Xxh3 checksums" << std::endl;
+	std::cout << "                      may have the \"" CHECKSUM_XXH3_PREFIX "\" prefix." << std::endl;
+	std::cout << "  --histogram LIST  - Print histograms of matches instead of individual entries." << std::endl;
+	std::cout << "                      LIST is a comma-separated list of histogram types:" << std::endl;
+	std::cout << "                      \"" HISTOGRAM_TYPE_SIZE_STR "\" (bytes), \"" HISTOGRAM_TYPE_ATIME_STR "\"/\"" HISTOGRAM_TYPE_MTIME_STR "\" (age in days) or" << std::endl;
+	std::cout << "                      \"" HISTOGRAM_TYPE_DEPTH_STR "\" (dir levels). Buckets are log2-based by default." << std::endl;
+	std::cout << "                      Append \":BOUND:...\" to a type for user-defined lower" << std::endl;
+	std::cout << "                      bucket bounds. Size bounds take the suffixes of \"--" ARG_FILTER_SIZE "\"." << std::endl;
+	std::cout << "                      (Example: --histogram size:1M:1G,mtime:30:365)" << std::endl;
+	std::cout << "  --json            - Print entries in JSON format. Each file/dir is a" << std::endl;
+	std::cout << "                      separate JSON root object. Contained data depends on" << std::endl;
+	std::cout << "                      whether \"--" ARG_STAT_LONG "\" is given." << std::endl;
+	std::cout << "                      (Hint: Consider the \"jq\" tool to filter results.)" << std::endl;
+	std::cout << "  --magic LIST      - Filter on regular files with the given types, detected by" << std::endl;
+	std::cout << "                      signatures in the first " << (MAGIC_READ_LEN / 1024) << "KiB of the file contents." << std::endl;
+	std::cout << "                      LIST is a comma-separated list of types, e.g." << std::endl;
+	std::cout << "                      \"hdf5,netcdf\". \"" MAGIC_TYPE_ANY_STR "\" matches any known type. Detected" << std::endl;
+	std::cout << "                      type is printed in \"magic\" of JSON output. Known types:" << std::endl;
+
+	std::string magicTypesStr = MagicTypeDetector::getKnownTypesStr();
+
+	for(size_t lineStart = 0; lineStart < magicTypesStr.length(); )
+	{ // wrap list of known types to fit help text width
+		size_t lineLen = magicTypesStr.length() - lineStart;
+
+		if(lineLen > 56)
+			lineLen = magicTypesStr.rfind(',', lineStart + 56) + 1 - lineStart;
+
+		std::cout << "                      " << magicTypesStr.substr(lineStart, lineLen) <<
+			std::endl;
+
+		lineStart += lineLen;
 	}
 
+	std::cout << "  --latency         - Measure latency of each filesystem call (e.g. readdir," << std::endl;
+	std::cout << "                      stat, read) and print percentiles per call type in the" << std::endl;
+	std::cout << "                      summary." << std::endl;
+	std::cout << "  --limit NUM       - Terminate after NUM matches. Exactly NUM matches get" << std::endl;
+	std::cout << "                      printed, also with multiple threads." << std::endl;
+	std::cout << "  --maxdepth        - Max directory depth to scan. (Path arguments have" << std::endl;
+	std::cout << "                      depth 0.)" << std::endl;
+	std::cout << "  --max-entries NUM - Stop the scan after NUM discovered entries. Results are" << std::endl;
+	std::cout << "                      marked as partial in the summary." << std::endl;
+	std::cout << "  --metrics-file PATH - Periodically rewrite the given file with counters," << std::endl;
+	std::cout << "                      gauges and (with \"--" ARG_LATENCY_LONG "\") latency histograms in" << std::endl;
+	std::cout << "                      Prometheus text format, e.g. for the node_exporter" << std::endl;
+	std::cout << "                      textfile collector. The file gets replaced atomically." << std::endl;
+	std::cout << "  --metrics-interval DURATION - Rewrite interval for \"--" ARG_METRICSFILE_LONG "\"." << std::endl;
+	std::cout << "                      Suffixes: s, m, h, d. (Default: " << METRICS_INTERVAL_SECS_DEFAULT << "s)" << std::endl;
+	std::cout << "  --mount           - Alias for \"--xdev\"." << std::endl;
+	std::cout << "  --mtime NUM       - mtime filter based on number of days in the past." << std::endl;
+	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
+	std::cout << "  --name PATTERN    - Filter on name of file or current dir. Pattern may" << std::endl;
+	std::cout << "                      contain '*' & '?' as wildcards. This parameter can be" << std::endl;
+	std::cout << "                      given multiple times, in which case filenames matching" << std::endl;
+	std::cout << "                      any of the given patterns will pass." << std::endl;
+	std::cout << "                      the filter." << std::endl;
+	std::cout << "  --newer PATH      - Filter based on more recent mtime than given path." << std::endl;
+	std::cout << "  --noprint         - Do not print names of discovered files and dirs." << std::endl;
+	std::cout << "  --nosummary       - Disable summary output to stderr." << std::endl;
+	std::cout << "  --notimeupd       - Do not update atime/mtime of copied files." << std::endl;
+	std::cout << "  --path PATTERN    - Filter on path of discovered entries." << std::endl;
+	std::cout << "                      Pattern may contain '*' & '?' as wildcards." << std::endl;
+	std::cout << "  --print0          - Terminate printed entries with null instead of newline." << std::endl;
+	std::cout << "                      (Hint: This goes nicely with \"xargs -0\".)" << std::endl;
+	std::cout << "  --progress[=DURATION] - Print progress to stderr at the given interval." << std::endl;
+	std::cout << "                      Shows scan rates, queue depth and active threads." << std::endl;
+	std::cout << "                      Suffixes: s, m, h, d. (Default: " << PROGRESS_INTERVAL_SECS_DEFAULT << "s)" << std::endl;
+	std::cout << "                      (The interval must be given with \"=\", e.g. \"--" ARG_PROGRESS_LONG "=5s\"," << std::endl;
+	std::cout << "                      because a separate arg is taken as a scan path.)" << std::endl;
+	std::cout << "                      (Hint: Send SIGUSR1 to get a progress line on demand," << std::endl;
+	std::cout << "                      also without this option.)" << std::endl;
+	std::cout << "  --quit            - Terminate after first match. (Same as \"--" ARG_LIMIT_LONG " 1\".)" << std::endl;
+	std::cout << "  --report-hotdirs NUM - Print the NUM dirs with the longest scan time and the" << std::endl;
+	std::cout << "                      NUM dirs with the most entries at the end of the scan." << std::endl;
+	std::cout << "                      Scan time of a dir excludes its subdirs and includes" << std::endl;
+	std::cout << "                      the time for stat() of its entries, which is also shown" << std::endl;
+	std::cout << "                      separately." << std::endl;
+	std::cout << "  --size NUM        - Size filter." << std::endl;
+	std::cout << "                      +/- prefix to match greater or smaller values." << std::endl;
+	std::cout << "                      Default unit is 512-byte blocks." << std::endl;
+	std::cout << "                      'c' suffix to specify bytes instead of 512-byte blocks." << std::endl;
+	std::cout << "                      'k'/'M'/'G' suffix for KiB/MiB/GiB units." << std::endl;
+	std::cout << "  --stat            - Query attributes of all discovered files & dirs." << std::endl;
+	std::cout << "  --summary-json PATH - Write statistics, config, resource usage, thread" << std::endl;
+	std::cout << "                      utilization and phase timings as JSON to the given file." << std::endl;
+	std::cout << "                      (Independent of \"--" ARG_NOSUMMARY_LONG "\".)" << std::endl;
+	std::cout << "  -t, --threads NUM - Number of scan threads. (Default: 16)" << std::endl;
+	std::cout << "                      \"" THREADS_AUTO_STR "[:MIN-MAX]\" adapts the number of active threads at" << std::endl;
+	std::cout << "                      runtime to the latency and throughput of directory reads" << std::endl;
+	std::cout << "                      and stat calls, within the given bounds." << std::endl;
+	std::cout << "                      (Default bounds: " << AUTO_THREADS_MIN_DEFAULT << "-" << AUTO_THREADS_MAX_DEFAULT << ")" << std::endl;
+	std::cout << "  --time-limit DURATION - Stop the scan after the given time. Results are marked" << std::endl;
+	std::cout << "                      as partial in the summary. Suffixes: s, m, h, d." << std::endl;
+	std::cout << "  --top NUM         - Print only the top NUM matches at the end of the scan," << std::endl;
+	std::cout << "                      sorted by \"--" ARG_TOPBY_LONG "\". "
+		"Each thread only keeps its own top NUM" << std::endl;
+	std::cout << "                      candidates, so memory usage is independent of the number" << std::endl;
+	std::cout << "                      of matches." << std::endl;
+	std::cout << "  --trace PATH      - Write a timeline of dir scans, shared stack push/pop and" << std::endl;
+	std::cout << "                      copies per thread as Chrome trace event JSON to the given" << std::endl;
+	std::cout << "                      file, e.g. for ui.perfetto.dev. Each thread keeps only" << std::endl;
+	std::cout << "                      the newest " << TRACE_RINGBUF_NUM_EVENTS << " events." << std::endl;
+	std::cout << "  --trace-sample NUM - Record only every NUM-th event of each type for" << std::endl;
+	std::cout << "                      \"--" ARG_TRACE_LONG "\" to reduce overhead. (Default: 1)" << std::endl;
+	std::cout << "  --type TYPE       - Search type. 'f' for regular files, 'd' for directories." << std::endl;
+	std::cout << "  --uid NUM         - Filter based on numeric user ID." << std::endl;
+	std::cout << "  --unlink          - Delete discovered files, not dirs." << std::endl;
+	std::cout << "  --usage-by LIST   - Print number of entries and bytes per user, group or" << std::endl;
+	std::cout << "                      project instead of individual entries. LIST is a" << std::endl;
+	std::cout << "                      comma-separated list of \"" USAGEBY_TYPE_USER_STR "\", \"" USAGEBY_TYPE_GROUP_STR "\" and" << std::endl;
+	std::cout << "                      \"" USAGEBY_TYPE_PROJECT_STR "\". (Project names are taken from " PROJID_FILE_PATH ".)" << std::endl;
+	std::cout << "                      Bytes of hardlinked files are counted only once." << std::endl;
+	std::cout << "  --user STR        - Filter based on user name or numeric user ID." << std::endl;
+	std::cout << "  --verbose         - Enable verbose output." << std::endl;
+	std::cout << "  --version         - Print version and exit." << std::endl;
+	std::cout << "  --xdev            - Don't descend directories on other filesystems than the" << std::endl;
+	std::cout << "                      scan path that they belong to." << std::endl;
+	std::cout << std::endl;
+	std::cout << "Examples:" << std::endl;
+	std::cout << "  Find all files and dirs under /data/mydir:" << std::endl;
+	std::cout << "    $ " EXE_NAME " /data/mydir" << std::endl;
+	std::cout << std::endl;
+	std::cout << "  Find all regular files that haven't been accessed within the last 3 days:" << std::endl;
+	std::cout << "    $ " EXE_NAME " --atime +3 /data/mydir" << std::endl;
+	std::cout << std::endl;
+	std::cout << "  Find all regular files and send 0-terminated paths to xargs for" << std::endl;
+	std::cout << "  parallel \"ls -lh\":" << std::endl;
+	std::cout << "    $ " EXE_NAME " --type f --print0 /data/mydir | \\" << std::endl;
+	std::cout << "      xargs -P 16 -r -0 -n 10 \\" << std::endl;
+	std::cout << "      ls -lh" << std::endl;
+	std::cout << std::endl;
+	std::cout << "  Filter JSON output using jq and send 0-terminated paths to xargs for" << std::endl;
+	std::cout << "  parallel \"ls -lh\":" << std::endl;
+	std::cout << "    $ " EXE_NAME " --json /data/mydir | \\" << std::endl;
+	std::cout << "      jq -rj '.|select(.type==\"regfile\")|(.path + \"\\u0000\")' | \\" << std::endl;
+	std::cout << "      xargs -P 16 -r -0 -n 10 \\" << std::endl;
+	std::cout << "      ls -lh" << std::endl;
+	std::cout << std::endl;
+	std::cout << "  Find the 100 largest regular files:" << std::endl;
+	std::cout << "    $ " EXE_NAME " --type f --top 100 --by size --json /data/mydir" << std::endl;
+
+	exit(EXIT_FAILURE);
+}
+
+void printVersionAndExit()
+{
+	std::cout << EXE_NAME << std::endl;
+	std::cout << " * Version: " EXE_VERSION << std::endl;
+	std::cout << " * Build date: " __DATE__ << " " << __TIME__ << std::endl;
+
+	exit(EXIT_SUCCESS);
 }
 
 /**
- * Filter discovered files/dirs and kick off processing of entries that came through the filters,
- * such as printing to console, copying etc.
- *
- * @dirEntry does not have to be provided if config.printJSON==false. otherwise it only needs to be
- * 		provided if statBuf is not provided, but there are special cases where it can still be
- * 		NULL, e.g. because it's a user-given path argument.
- * @statBuf does not have to be provided if config.printJSON==false. otherwise it only needs to be
- * 		provided if dirEntry->d_type==DT_UNKNOWN or config.statAll==true, but there are special
- * 		cases where it can still be NULL, e.g. if the stat() call returned an error.
+ * Parse the suffix of the "--size" argument (if any) and return the bytes value without suffix.
  */
-void processDiscoveredEntry(const std::string& entryPath, const struct dirent* dirEntry,
-	const struct stat* statBuf)
+std::string parseSizeArgSuffix(std::string userVal)
 {
-	// filters
+	if(userVal.empty() )
+		return userVal;
 
-	if(!filterPrintEntryByType(entryPath, dirEntry, statBuf) )
-		return;
+	char userValSuffix = userVal[userVal.length() - 1];
 
-	if(!filterPrintEntryByName(entryPath, dirEntry, statBuf) )
-		return;
+	// no suffix => default is 512 byte blocks
+	if( (userValSuffix >= '0') && (userValSuffix <= '9') )
+		return std::to_string(std::stoull(userVal) * 512);
 
-	if(!filterPrintEntryByPath(entryPath, dirEntry, statBuf) )
-		return;
+	userVal.pop_back(); // remove suffix, we have userValSuffix as copy
 
-	if(!filterPrintEntryBySizeOrTime(entryPath, dirEntry, statBuf) )
-		return;
+	// see "find" man page for meaning of suffixes
+	switch(userValSuffix)
+	{
+		case 'b': return std::to_string(std::stoull(userVal) * 512);
+		case 'c': return userVal;
+		case 'w': return std::to_string(std::stoull(userVal) * 2);
+		case 'k': return std::to_string(std::stoull(userVal) * 1024);
+		case 'M': return std::to_string(std::stoull(userVal) * 1024 * 1024);
+		case 'G': return std::to_string(std::stoull(userVal) * 1024 * 1024 * 1024);
 
-	if(!filterPrintEntryByUIDAndGID(entryPath, dirEntry, statBuf) )
+		default:
+		{
+			fprintf(stderr, "Invalid suffix: %s\n", userVal.c_str() );
+
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/**
+ * Simplified way to call parseExactLessGreaterVal().
+ * Example: PARSE_EXACT_LESS_GREATER_VAL(optarg, atime, ATIME)
+ */
+#define _PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName) \
+	parseExactLessGreaterVal(userVal, \
+		config.filterSizeAndTime.lowercaseCfgName ## Exact, \
+		config.filterSizeAndTime.lowercaseCfgName ## Less, \
+		config.filterSizeAndTime.lowercaseCfgName ## Greater, \
+		FILTER_FLAG_ ## uppercaseCfgName ## _EXACT, \
+		FILTER_FLAG_ ## uppercaseCfgName ## _LESS, \
+		FILTER_FLAG_ ## uppercaseCfgName ## _GREATER)
+#define PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName) \
+	_PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName)
+
+/**
+ * Parse user-given value args (e.g. for size or mtime) that can be set to exact (no prefix),
+ * less ("-" prefix) or greater ("+" prefix) matches.
+ * {exaclt,less,greater}CfgFlag are the corresponding values for filterSizeAndTimeFlags.
+ */
+void parseExactLessGreaterVal(std::string userVal,
+	uint64_t& exactCfgVal, uint64_t& lessCfgVal, uint64_t& greaterCfgVal,
+	unsigned exactCfgFlag, unsigned lessCfgFlag, unsigned greaterCfgFlag)
+{
+	if(userVal.empty() )
 		return;
 
-	// print entry
+	config.statAll = true; // need stat() info for time/size filtering
 
-	printEntry(entryPath, dirEntry, statBuf);
+	// handle +/- prefix, set actualCfgValPtr and corresponding filter flag
 
-	// exec system command on entry
+	uint64_t* actualCfgValPtr;
 
-	execSystemCommand(entryPath);
+	if(userVal[0] == '-')
+	{ // match less than userVal for size and "less in the past" (so greater) for timestamps
+		userVal.erase(0, 1); // remove '-' char
 
-	// copy
+		if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
+		{ // size => '-' means "less"
+			actualCfgValPtr = &lessCfgVal;
+			config.filterSizeAndTime.filterSizeAndTimeFlags |= lessCfgFlag;
+		}
+		else
+		{ // time => '-' means "greater" (less in the past)
+			actualCfgValPtr = &greaterCfgVal;
+			config.filterSizeAndTime.filterSizeAndTimeFlags |= greaterCfgFlag;
+		}
+	}
+	else
+	if(userVal[0] == '+')
+	{ // match greater than userVal for size and "more in the past" (so less) for timestamps
+		userVal.erase(0, 1); // remove '+' char
 
-	copyEntry(entryPath, dirEntry, statBuf);
+		if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
+		{ // size => '+' means "greater"
+			actualCfgValPtr = &greaterCfgVal;
+			config.filterSizeAndTime.filterSizeAndTimeFlags |= greaterCfgFlag;
+		}
+		else
+		{ // time => '+' means "less" (further in the past)
+			actualCfgValPtr = &lessCfgVal;
+			config.filterSizeAndTime.filterSizeAndTimeFlags |= lessCfgFlag;
+		}
+	}
+	else
+	{ // match exact
+		actualCfgValPtr = &exactCfgVal;
+		config.filterSizeAndTime.filterSizeAndTimeFlags |= exactCfgFlag;
+	}
 
-	// unlink
+	// actualCfgValPtr is set, but we didn't assign the value yet at this point
 
-	unlinkEntry(entryPath, dirEntry, statBuf);
+	if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
+	{ // size can have a suffix
+		userVal = parseSizeArgSuffix(userVal);
+		*actualCfgValPtr = std::stoull(userVal);
+	}
+	else
+	{ // {a,c,m}time, so we have to substract user val times 24h from current time
+		const uint64_t secsPerDay = 60 * 60 * 24;
 
-	// note on quitAfterFirstMatch: we can't exit() here because of the other threads. and can't use
-	// kill(0, SIGTERM) because that would exit with error code. so recursive scan() checks this.
+		time_t nowT = time(NULL);
 
-	statistics.numFilterMatches++;
+		*actualCfgValPtr = nowT - (std::stoull(userVal) * secsPerDay);
+	}
 }
 
 /**
- * This is the main workhorse. It does a breadth scan while dir stack size is below
- * config.depthSearchStartThreshold, in which cases discovered dirs are put on stack so that other
- * threads can grab them. Otherwise it switches to recursive depth search.
+ * Parse a time duration argument with optional suffix "s" (seconds, default), "m" (minutes),
+ * "h" (hours) or "d" (days).
+ *
+ * @return duration in seconds.
  */
-void scan(std::string path, const unsigned short dirDepth)
+uint64_t parseDurationArg(std::string userVal, const char* argName)
 {
-	// stop in case of for quitAfterFirstMatch
-	if(config.quitAfterFirstMatch && statistics.numFilterMatches)
-		return;
-
-	DIR* dirStream = opendir(path.c_str() );
-	if(!dirStream)
-	{
-		statistics.numErrors++;
-
-		int errnoBackup = errno;
-		fprintf(stderr, "Failed to open dir: '%s'; Error: %s\n", path.c_str(), strerror(errno) );
-		if( (errnoBackup == EACCES) || (errnoBackup == ENOENT) )
-			return;
+	uint64_t multiplier = 1;
 
-		kill(0, SIGTERM);
-	}
-
-	/* loop over contents of this entire directory - potentially recursively descending into subdirs
-		along the way, depending on config and current global state */
-	for ( ; ; )
+	if(!userVal.empty() && !isdigit(userVal[userVal.length() - 1] ) )
 	{
-		errno = 0;
-		struct dirent* dirEntry = readdir(dirStream);
-		if(!dirEntry)
+		switch(userVal[userVal.length() - 1] )
 		{
-			if(errno)
-			{
-				fprintf(stderr, "Failed to read from dir: %s; Error: %s\n",
-					path.c_str(), strerror(errno) );
+			case 's': multiplier = 1; break;
+			case 'm': multiplier = 60; break;
+			case 'h': multiplier = 60 * 60; break;
+			case 'd': multiplier = 60 * 60 * 24; break;
 
-				statistics.numErrors++;
+			default:
+			{
+				fprintf(stderr, "Aborting because of invalid \"--%s\" suffix: %s\n",
+					argName, userVal.c_str() );
+				exit(EXIT_FAILURE);
 			}
-
-			closedir(dirStream);
-			return;
 		}
 
-		if(!strcmp(dirEntry->d_name, ".") || !strcmp(dirEntry->d_name, "..") )
-			continue;
+		userVal.pop_back();
+	}
 
-		struct stat statBuf;
-		int statErrno = -1; // "-1" to let clear that statBuf is not usable yet
+	if(userVal.empty() || (userVal.find_first_not_of("0123456789") != std::string::npos) )
+	{
+		fprintf(stderr, "Aborting because of invalid \"--%s\" duration: %s\n",
+			argName, userVal.c_str() );
+		exit(EXIT_FAILURE);
+	}
 
-		// if dentry type is unknown then we have to stat to know if this is a dir to descend into
-		if(config.statAll || (dirEntry->d_type == DT_UNKNOWN) )
-		{
-			statistics.numStatCalls++;
+	return std::stoull(userVal) * multiplier;
+}
 
-			int statRes = fstatat(dirfd(dirStream), dirEntry->d_name, &statBuf,
-				AT_SYMLINK_NOFOLLOW);
+/**
+ * Parse a latency argument with optional suffix "ns", "us", "ms" (default) or "s".
+ *
+ * @return latency in nanoseconds.
+ */
+uint64_t parseLatencyArg(std::string userVal, const char* argName)
+{
+	uint64_t multiplier = 1000 * 1000;
 
-			if(!statRes)
-				statErrno = 0; // success, so mark statBuf as usable
-			else
-			{ // stat failed
-				statErrno = errno;
+	const std::vector<std::pair<std::string, uint64_t> > suffixes =
+		{ {"ns", 1}, {"us", 1000}, {"ms", 1000 * 1000}, {"s", 1000 * 1000 * 1000} };
 
-				fprintf(stderr, "Failed to get attributes for path: %s; Error: %s\n",
-					path.c_str(), strerror(statErrno) );
-			}
+	for(const std::pair<std::string, uint64_t>& suffix : suffixes)
+	{
+		if( (userVal.length() > suffix.first.length() ) &&
+			!userVal.compare(userVal.length() - suffix.first.length(), std::string::npos,
+				suffix.first) )
+		{
+			multiplier = suffix.second;
+			userVal.resize(userVal.length() - suffix.first.length() );
+			break;
 		}
+	}
 
-		if(dirEntry->d_type == DT_UNKNOWN)
-			statistics.numUnknownFound++;
+	if(userVal.empty() || (userVal.find_first_not_of("0123456789") != std::string::npos) )
+	{
+		fprintf(stderr, "Aborting because of invalid \"%s\" latency: %s\n",
+			argName, userVal.c_str() );
+		exit(EXIT_FAILURE);
+	}
 
-		std::string entryPath(path + "/" + dirEntry->d_name);
+	return std::stoull(userVal) * multiplier;
+}
 
-		if(dirEntry->d_type == DT_DIR ||
-			( (dirEntry->d_type == DT_UNKNOWN) && !statErrno && S_ISDIR(statBuf.st_mode) ) )
-		{ // this entry is a directory
-			statistics.numDirsFound++;
+/**
+ * Parse the argument of "--fs-backend" and set the corresponding config values.
+ *
+ * Format is "posix" or "synthetic[:KEY=VAL,...]".
+ */
+void parseFsBackendArg(std::string userVal)
+{
+	if(userVal == FSBACKEND_POSIX_STR)
+	{
+		config.useSyntheticFs = false;
+		return;
+	}
+
+	if(userVal.compare(0, strlen(FSBACKEND_SYNTHETIC_STR), FSBACKEND_SYNTHETIC_STR) ||
+		( (userVal.length() > strlen(FSBACKEND_SYNTHETIC_STR) ) &&
+			(userVal[strlen(FSBACKEND_SYNTHETIC_STR)] != ':') ) )
+	{
+		fprintf(stderr, "Aborting because of invalid \"--" ARG_FSBACKEND_LONG "\" value: %s\n",
+			userVal.c_str() );
+		exit(EXIT_FAILURE);
+	}
 
-			checkACLs(entryPath.c_str(), true);
+	config.useSyntheticFs = true;
 
-			processDiscoveredEntry(entryPath, dirEntry, statErrno ? NULL : &statBuf);
+	SyntheticFsConfig& syntheticFs = config.syntheticFs;
+	std::stringstream paramsStream(userVal.substr(
+		std::min(userVal.length(), strlen(FSBACKEND_SYNTHETIC_STR ":") ) ) );
+	std::string paramStr;
 
-			const bool doDescendDepth = (dirDepth < config.maxDirDepth);
-			const bool doDescendMount = (config.filterMountID == (~0ULL) ) ? true :
-				(!statErrno && (config.filterMountID == statBuf.st_dev) );
+	while(std::getline(paramsStream, paramStr, ',') )
+	{
+		size_t separatorPos = paramStr.find('=');
+		std::string key = paramStr.substr(0, separatorPos);
+		std::string val = (separatorPos == std::string::npos) ?
+			"" : paramStr.substr(separatorPos + 1);
 
-			if(doDescendMount && doDescendDepth)
+		if(val.empty() )
+		{
+			fprintf(stderr, "Aborting because of missing value for \"--" ARG_FSBACKEND_LONG "\" "
+				"parameter: %s\n", paramStr.c_str() );
+			exit(EXIT_FAILURE);
+		}
+
+		try
+		{
+			if(key == "fanout")
+				syntheticFs.fanout = std::stoul(val);
+			else
+			if(key == "depth")
+				syntheticFs.depth = std::stoul(val);
+			else
+			if(key == "files")
+				syntheticFs.filesPerDir = std::stoull(val);
+			else
+			if(key == "size")
+				syntheticFs.fileSize = isdigit(val.back() ) ? // (plain number means bytes here)
+					std::stoull(val) : std::stoull(parseSizeArgSuffix(val) );
+			else
+			if(key == "latency")
+				syntheticFs.latencyNanoSecs = parseLatencyArg(val, "latency");
+			else
+			if(key == "jitter")
+				syntheticFs.jitterNanoSecs = parseLatencyArg(val, "jitter");
+			else
+			if(key == "error-rate")
+				syntheticFs.errorRate = std::stod(val);
+			else
+			if(key == "errno")
 			{
-				if(sharedStack.getSize() >= config.depthSearchStartThreshold)
-					scan(entryPath, dirDepth + 1);
-				else // breadth search, so just add dir to stack for later processing
-					sharedStack.push(entryPath, dirDepth + 1);
+				if(val == "EACCES")
+					syntheticFs.errorNum = EACCES;
+				else
+				if(val == "EIO")
+					syntheticFs.errorNum = EIO;
+				else
+				if(val == "ENOENT")
+					syntheticFs.errorNum = ENOENT;
+				else
+				if(val == "ESTALE")
+					syntheticFs.errorNum = ESTALE;
+				else
+				if(val == "ETIMEDOUT")
+					syntheticFs.errorNum = ETIMEDOUT;
+				else
+					throw std::invalid_argument(val);
 			}
+			else
+			if(key == "seed")
+				syntheticFs.seed = std::stoull(val);
+			else
+				throw std::invalid_argument(key);
 		}
-		else
-		{ // this entry is not a directory (or unknown with stat() error)
-			statistics.numFilesFound++;
-
-			checkACLs(entryPath.c_str(), false);
-
-			processDiscoveredEntry(entryPath, dirEntry, statErrno ? NULL : &statBuf);
+		catch(const std::logic_error& e)
+		{
+			fprintf(stderr, "Aborting because of invalid \"--" ARG_FSBACKEND_LONG "\" "
+				"parameter: %s\n", paramStr.c_str() );
+			exit(EXIT_FAILURE);
 		}
+	}
 
+	if( (syntheticFs.errorRate < 0) || (syntheticFs.errorRate > 1) )
+	{
+		fprintf(stderr, "Aborting because \"--" ARG_FSBACKEND_LONG "\" error-rate must be "
+			"between 0 and 1.\n");
+		exit(EXIT_FAILURE);
 	}
 }
 
 /**
- * Starting point for directory structure scan threads.
+ * Parse the "--threads" argument of the form "auto[:MIN-MAX]" and set the corresponding config
+ * values.
  */
-void threadStart()
+void parseAutoThreadsArg(std::string userVal)
 {
-	try
-	{
-		std::string dirPath;
-		unsigned short dirDepth;
+	config.autoThreads = true;
 
-		while(sharedStack.popWait(dirPath, dirDepth) )
-			scan(dirPath, dirDepth);
-	}
-	catch(ScanDoneException& e)
+	std::string boundsStr = userVal.substr(strlen(THREADS_AUTO_STR) );
+
+	if(!boundsStr.empty() )
 	{
-	}
-}
+		// expected format ":MIN-MAX" with decimal numbers that fit into unsigned
 
-/**
- * Print summary at end of run.
- */
-void printSummary()
-{
-	if(!config.printSummary)
-		return; // summary disabled
+		const char* minStr = boundsStr.c_str() + 1;
+		char* minEndPtr = NULL;
+		char* maxEndPtr = NULL;
 
-	std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
-	std::chrono::microseconds elapsedMicroSec =
-		std::chrono::duration_cast<std::chrono::microseconds>(endTime - state.startTime);
+		errno = 0;
 
-	uint64_t elapsedSec = elapsedMicroSec.count() / 1000000;
-	uint64_t elapsedMilliSecRemainder = (elapsedMicroSec.count() % 1000000) / 1000;
+		unsigned long minVal = isdigit(minStr[0]) ? strtoul(minStr, &minEndPtr, 10) : 0;
+		unsigned long maxVal = (minEndPtr && (*minEndPtr == '-') && isdigit(minEndPtr[1]) ) ?
+			strtoul(minEndPtr + 1, &maxEndPtr, 10) : 0;
 
-	uint64_t scanEntriesTotal = statistics.numDirsFound + statistics.numFilesFound;
-	uint64_t scanEntriesPerSec =
-		( (double)scanEntriesTotal / elapsedMicroSec.count() ) * 1000000;
-	uint64_t copyMiBTotal = statistics.numBytesCopied / (1024*1024);
-	uint64_t copyMiBPerSec = ( (double)copyMiBTotal / elapsedMicroSec.count() ) * 1000000;
+		if( (boundsStr[0] != ':') || !maxEndPtr || *maxEndPtr || errno ||
+			(minVal > UINT_MAX) || (maxVal > UINT_MAX) )
+		{
+			fprintf(stderr, "Aborting because of invalid \"--" ARG_THREADS_LONG "\" value: %s\n",
+				userVal.c_str() );
+			exit(EXIT_FAILURE);
+		}
 
+		config.autoThreadsMin = minVal;
+		config.autoThreadsMax = maxVal;
+	}
 
-	if(config.printVerbose)
+	if(!config.autoThreadsMin || (config.autoThreadsMin > config.autoThreadsMax) )
 	{
-		std::cerr << "CONFIG:" << std::endl;
-		std::cerr << "  * threads:       " << config.numThreads << std::endl;
-		std::cerr << "  * godeep:        " << config.depthSearchStartThreshold << std::endl;
-		std::cerr << "  * flags:         " <<
-			"stat: " << config.statAll << "; " <<
-			"aclcheck: " << config.checkACLs << std::endl;
+		fprintf(stderr, "Aborting because \"--" ARG_THREADS_LONG " " THREADS_AUTO_STR "\" min "
+			"must be at least 1 and not greater than max: %s\n", userVal.c_str() );
+		exit(EXIT_FAILURE);
 	}
 
+	config.numThreads = config.autoThreadsMax; // threads above the active limit just wait
+	config.recordSyscallLatency = true; // latency is the input of the controller
+}
 
-	try
-	{
-		std::cerr.imbue(std::locale("") );
-	}
-	catch(std::runtime_error& exception)
+/**
+ * Parse the argument of "--magic" and add the types to config.
+ */
+void parseMagicArg(std::string userVal)
+{
+	std::stringstream magicStream(userVal);
+	std::string typeStr;
+
+	while(std::getline(magicStream, typeStr, ',') )
 	{
-		/* static binaries from Alpine fail on Ubuntu with std::runtime_error
-			"locale::facet::_S_create_c_locale name not valid". however, this is just for nicer
-			number formatting, so not ciritical.*/
-	}
+		if( (typeStr != MAGIC_TYPE_ANY_STR) && !MagicTypeDetector::isKnownType(typeStr) )
+		{
+			fprintf(stderr, "Aborting because of unknown magic type: %s; Known types: %s\n",
+				typeStr.c_str(), MagicTypeDetector::getKnownTypesStr().c_str() );
+			exit(EXIT_FAILURE);
+		}
 
-	std::cerr << "STATISTICS:" << std::endl;
+		config.magicTypes.push_back(typeStr);
+	}
+}
 
-	std::cerr << "  * entries found: " <<
-			"files: " << statistics.numFilesFound << "; " <<
-			"dirs: " << statistics.numDirsFound << "; " <<
-			"filter matches: " << statistics.numFilterMatches << std::endl;
+/**
+ * Parse the argument of "--histogram" and add the histograms to config.
+ *
+ * Format is a comma-separated list of "TYPE[:BOUND:...]", where the optional bounds are the lower
+ * bounds of user-defined buckets instead of the default log2 buckets.
+ */
+void parseHistogramArg(std::string userVal)
+{
+	config.printEntriesDisabled = true; // histograms replace the output of individual entries
 
-	std::cerr << "  * special cases: " <<
-			"unknown type: " << statistics.numUnknownFound << "; " <<
-			"errors: " << statistics.numErrors << std::endl;
+	std::stringstream histogramsStream(userVal);
+	std::string histogramStr;
 
-	if(statistics.numStatCalls)
-		std::cerr << "  * stat calls:    " << statistics.numStatCalls << std::endl;
+	while(std::getline(histogramsStream, histogramStr, ',') )
+	{
+		std::stringstream histogramStream(histogramStr);
+		std::string typeStr;
+		std::string boundStr;
+		HistogramConfig histogramConfig;
 
-	if(config.checkACLs)
-		std::cerr << "  * ACLs found:    " <<
-			statistics.numAccessACLsFound << " access; " <<
-			statistics.numDefaultACLsFound << " default" << std::endl;
+		std::getline(histogramStream, typeStr, ':');
 
-	std::cerr << "  * scan speed:    " <<
-		scanEntriesPerSec << " entries/s; " <<
-		"runtime: " << elapsedSec << "." <<	std::setfill('0') << std::setw(3) <<
-			elapsedMilliSecRemainder << "s" << std::endl;
+		if(typeStr == HISTOGRAM_TYPE_SIZE_STR)
+			histogramConfig.type = HistogramType_SIZE;
+		else
+		if(typeStr == HISTOGRAM_TYPE_ATIME_STR)
+			histogramConfig.type = HistogramType_ATIME;
+		else
+		if(typeStr == HISTOGRAM_TYPE_MTIME_STR)
+			histogramConfig.type = HistogramType_MTIME;
+		else
+		if(typeStr == HISTOGRAM_TYPE_DEPTH_STR)
+			histogramConfig.type = HistogramType_DEPTH;
+		else
+		{
+			fprintf(stderr, "Aborting because of invalid histogram type: %s\n", typeStr.c_str() );
+			exit(EXIT_FAILURE);
+		}
 
-	if(!config.copyDestDir.empty() )
-		std::cerr << "  * copy speed:    " <<
-			copyMiBPerSec << " MiB/s; " <<
-			"total: " << copyMiBTotal << " MiB; " <<
-			"skipped files: " << statistics.numFilesNotCopied << std::endl;
-}
+		if(histogramConfig.type != HistogramType_DEPTH)
+			config.statAll = true; // need stat() info for size and timestamps
 
-void printUsageAndExit()
-{
-	std::cout << EXE_NAME " - Parallel search for files & dirs" << std::endl;
-	std::cout << std::endl;
-	std::cout << "VERSION: " EXE_VERSION << std::endl;
-	std::cout << std::endl;
-	std::cout << "USAGE: " EXE_NAME " [OPTIONS...] [PATHS...]" << std::endl;
-	std::cout << std::endl;
-	std::cout << "OPTIONS (in alphabetical order):" << std::endl;
-	std::cout << "  --atime NUM       - atime filter based on number of days in the past." << std::endl;
-	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
-	std::cout << "  --aclcheck        - Query ACLs of all discovered entries." << std::endl;
-	std::cout << "                      (Just for testing, does not change the result set.)" << std::endl;
-	std::cout << "  --copyto PATH     - Copy discovered files and dirs to this directory." << std::endl;
-	std::cout << "                      Only regular files, dirs and symlinks will be copied." << std::endl;
-	std::cout << "                      Hardlinks will not be preserved. Source and" << std::endl;
-	std::cout << "                      destination have to be dirs." << std::endl;
-	std::cout << "  --ctime NUM       - ctime filter based on number of days in the past." << std::endl;
-	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
-	std::cout << "  --exec CMD ARGs ; - Execute the given system command and arguments for each" << std::endl;
-	std::cout << "                      discovered file/dir. The string '{}' in any arg will get" << std::endl;
-	std::cout << "                      replaced by the current file/dir path. The argument ';'" << std::endl;
-	std::cout << "                      marks the end of the command line to run." << std::endl;
-	std::cout << "                      (Example: elfindo --exec ls -lhd '{}' \\; --type d)" << std::endl;
-	std::cout << "  --gid NUM         - Filter based on numeric group ID." << std::endl;
-	std::cout << "  --godeep NUM      - Threshold to switch from breadth to depth search." << std::endl;
-	std::cout << "                      (Default: number of scan threads)" << std::endl;
-	std::cout << "  --group STR       - Filter based on group name or numeric group ID." << std::endl;
-	std::cout << "  --json            - Print entries in JSON format. Each file/dir is a" << std::endl;
-	std::cout << "                      separate JSON root object. Contained data depends on" << std::endl;
-	std::cout << "                      whether \"--" ARG_STAT_LONG "\" is given." << std::endl;
-	std::cout << "                      (Hint: Consider the \"jq\" tool to filter results.)" << std::endl;
-	std::cout << "  --maxdepth        - Max directory depth to scan. (Path arguments have" << std::endl;
-	std::cout << "                      depth 0.)" << std::endl;
-	std::cout << "  --mount           - Alias for \"--xdev\"." << std::endl;
-	std::cout << "  --mtime NUM       - mtime filter based on number of days in the past." << std::endl;
-	std::cout << "                      +/- prefix to match older or more recent values." << std::endl;
-	std::cout << "  --name PATTERN    - Filter on name of file or current dir. Pattern may" << std::endl;
-	std::cout << "                      contain '*' & '?' as wildcards. This parameter can be" << std::endl;
-	std::cout << "                      given multiple times, in which case filenames matching" << std::endl;
-	std::cout << "                      any of the given patterns will pass." << std::endl;
-	std::cout << "                      the filter." << std::endl;
-	std::cout << "  --newer PATH      - Filter based on more recent mtime than given path." << std::endl;
-	std::cout << "  --noprint         - Do not print names of discovered files and dirs." << std::endl;
-	std::cout << "  --nosummary       - Disable summary output to stderr." << std::endl;
-	std::cout << "  --notimeupd       - Do not update atime/mtime of copied files." << std::endl;
-	std::cout << "  --path PATTERN    - Filter on path of discovered entries." << std::endl;
-	std::cout << "                      Pattern may contain '*' & '?' as wildcards." << std::endl;
-	std::cout << "  --print0          - Terminate printed entries with null instead of newline." << std::endl;
-	std::cout << "                      (Hint: This goes nicely with \"xargs -0\".)" << std::endl;
-	std::cout << "  --quit            - Terminate after first match. (Note: With multiple threads" << std::endl;
-	std::cout << "                      it's possible that more than one match gets printed." << std::endl;
-	std::cout << "                      Consider combining this with \"| head -n 1\".)" << std::endl;
-	std::cout << "  --size NUM        - Size filter." << std::endl;
-	std::cout << "                      +/- prefix to match greater or smaller values." << std::endl;
-	std::cout << "                      Default unit is 512-byte blocks." << std::endl;
-	std::cout << "                      'c' suffix to specify bytes instead of 512-byte blocks." << std::endl;
-	std::cout << "                      'k'/'M'/'G' suffix for KiB/MiB/GiB units." << std::endl;
-	std::cout << "  --stat            - Query attributes of all discovered files & dirs." << std::endl;
-	std::cout << "  -t, --threads NUM - Number of scan threads. (Default: 16)" << std::endl;
-	std::cout << "  --type TYPE       - Search type. 'f' for regular files, 'd' for directories." << std::endl;
-	std::cout << "  --uid NUM         - Filter based on numeric user ID." << std::endl;
-	std::cout << "  --unlink          - Delete discovered files, not dirs." << std::endl;
-	std::cout << "  --user STR        - Filter based on user name or numeric user ID." << std::endl;
-	std::cout << "  --verbose         - Enable verbose output." << std::endl;
-	std::cout << "  --version         - Print version and exit." << std::endl;
-	std::cout << "  --xdev            - Don't descend directories on other filesystems." << std::endl;
-	std::cout << std::endl;
-	std::cout << "Examples:" << std::endl;
-	std::cout << "  Find all files and dirs under /data/mydir:" << std::endl;
-	std::cout << "    $ " EXE_NAME " /data/mydir" << std::endl;
-	std::cout << std::endl;
-	std::cout << "  Find all regular files that haven't been accessed within the last 3 days:" << std::endl;
-	std::cout << "    $ " EXE_NAME " --atime +3 /data/mydir" << std::endl;
-	std::cout << std::endl;
-	std::cout << "  Find all regular files and send 0-terminated paths to xargs for" << std::endl;
-	std::cout << "  parallel \"ls -lh\":" << std::endl;
-	std::cout << "    $ " EXE_NAME " --type f --print0 /data/mydir | \\" << std::endl;
-	std::cout << "      xargs -P 16 -r -0 -n 10 \\" << std::endl;
-	std::cout << "      ls -lh" << std::endl;
-	std::cout << std::endl;
-	std::cout << "  Filter JSON output using jq and send 0-terminated paths to xargs for" << std::endl;
-	std::cout << "  parallel \"ls -lh\":" << std::endl;
-	std::cout << "    $ " EXE_NAME " --json /data/mydir | \\" << std::endl;
-	std::cout << "      jq -rj '.|select(.type==\"regfile\")|(.path + \"\\u0000\")' | \\" << std::endl;
-	std::cout << "      xargs -P 16 -r -0 -n 10 \\" << std::endl;
-	std::cout << "      ls -lh" << std::endl;
+		// parse optional user-defined bucket bounds
+		while(std::getline(histogramStream, boundStr, ':') )
+		{
+			// size bounds can have a suffix like in "--size"
+			uint64_t bound = (histogramConfig.type == HistogramType_SIZE) ?
+				std::stoull(parseSizeArgSuffix(boundStr) ) : std::stoull(boundStr);
+
+			if(!bound)
+			{ // (first bucket always starts at 0, so its upper bound would be -1)
+				fprintf(stderr, "Aborting because histogram bucket bounds must be greater than "
+					"0: %s\n", histogramStr.c_str() );
+				exit(EXIT_FAILURE);
+			}
 
-	exit(EXIT_FAILURE);
-}
+			if(!histogramConfig.bucketBounds.empty() &&
+				(bound <= histogramConfig.bucketBounds.back() ) )
+			{
+				fprintf(stderr, "Aborting because histogram bucket bounds are not in ascending "
+					"order: %s\n", histogramStr.c_str() );
+				exit(EXIT_FAILURE);
+			}
 
-void printVersionAndExit()
-{
-	std::cout << EXE_NAME << std::endl;
-	std::cout << " * Version: " EXE_VERSION << std::endl;
-	std::cout << " * Build date: " __DATE__ << " " << __TIME__ << std::endl;
+			histogramConfig.bucketBounds.push_back(bound);
+		}
 
-	exit(EXIT_SUCCESS);
+		config.histogramConfigVec.push_back(histogramConfig);
+	}
 }
 
 /**
- * Parse the suffix of the "--size" argument (if any) and return the bytes value without suffix.
+ * Parse the comma-separated argument of "--usage-by" and add the usage reports to config.
  */
-std::string parseSizeArgSuffix(std::string userVal)
+void parseUsageByArg(std::string userVal)
 {
-	if(userVal.empty() )
-		return userVal;
-
-	char userValSuffix = userVal[userVal.length() - 1];
-
-	// no suffix => default is 512 byte blocks
-	if( (userValSuffix >= '0') && (userValSuffix <= '9') )
-		return std::to_string(std::stoull(userVal) * 512);
+	config.printEntriesDisabled = true; // usage reports replace the output of individual entries
+	config.statAll = true; // need stat() info for owner and size
 
-	userVal.pop_back(); // remove suffix, we have userValSuffix as copy
+	std::stringstream usageByStream(userVal);
+	std::string typeStr;
 
-	// see "find" man page for meaning of suffixes
-	switch(userValSuffix)
+	while(std::getline(usageByStream, typeStr, ',') )
 	{
-		case 'b': return std::to_string(std::stoull(userVal) * 512);
-		case 'c': return userVal;
-		case 'w': return std::to_string(std::stoull(userVal) * 2);
-		case 'k': return std::to_string(std::stoull(userVal) * 1024);
-		case 'M': return std::to_string(std::stoull(userVal) * 1024 * 1024);
-		case 'G': return std::to_string(std::stoull(userVal) * 1024 * 1024 * 1024);
-
-		default:
+		if(typeStr == USAGEBY_TYPE_USER_STR)
+			config.usageByVec.push_back(UsageByType_USER);
+		else
+		if(typeStr == USAGEBY_TYPE_GROUP_STR)
+			config.usageByVec.push_back(UsageByType_GROUP);
+		else
+		if(typeStr == USAGEBY_TYPE_PROJECT_STR)
 		{
-			fprintf(stderr, "Invalid suffix: %s\n", userVal.c_str() );
+		#ifndef FS_IOC_FSGETXATTR
+			fprintf(stderr, "Aborting because project IDs are not supported on this platform\n");
+			exit(EXIT_FAILURE);
+		#endif // FS_IOC_FSGETXATTR
 
+			config.usageByVec.push_back(UsageByType_PROJECT);
+		}
+		else
+		{
+			fprintf(stderr, "Aborting because of invalid usage report type: %s\n",
+				typeStr.c_str() );
 			exit(EXIT_FAILURE);
 		}
 	}
 }
 
 /**
- * Simplified way to call parseExactLessGreaterVal().
- * Example: PARSE_EXACT_LESS_GREATER_VAL(optarg, atime, ATIME)
- */
-#define _PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName) \
-	parseExactLessGreaterVal(userVal, \
-		config.filterSizeAndTime.lowercaseCfgName ## Exact, \
-		config.filterSizeAndTime.lowercaseCfgName ## Less, \
-		config.filterSizeAndTime.lowercaseCfgName ## Greater, \
-		FILTER_FLAG_ ## uppercaseCfgName ## _EXACT, \
-		FILTER_FLAG_ ## uppercaseCfgName ## _LESS, \
-		FILTER_FLAG_ ## uppercaseCfgName ## _GREATER)
-#define PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName) \
-	_PARSE_EXACT_LESS_GREATER_VAL(userVal, lowercaseCfgName, uppercaseCfgName)
-
-/**
- * Parse user-given value args (e.g. for size or mtime) that can be set to exact (no prefix),
- * less ("-" prefix) or greater ("+" prefix) matches.
- * {exaclt,less,greater}CfgFlag are the corresponding values for filterSizeAndTimeFlags.
+ * Read checksums for "--hash-in" from the given file and add them to hashInDigestSet. Each line
+ * contains a hex checksum and optionally the file size in bytes, separated by whitespace. Empty
+ * lines and lines starting with '#' are ignored. The checksum algorithm is determined by the hex
+ * string length: 64 for sha256, 16 for xxh3 and 8 for crc32c. Xxh3 checksums may be prefixed with
+ * CHECKSUM_XXH3_PREFIX, as in "xxhsum" and "--checksum" output.
  */
-void parseExactLessGreaterVal(std::string userVal,
-	uint64_t& exactCfgVal, uint64_t& lessCfgVal, uint64_t& greaterCfgVal,
-	unsigned exactCfgFlag, unsigned lessCfgFlag, unsigned greaterCfgFlag)
+void parseHashInFile(const char* path)
 {
-	if(userVal.empty() )
-		return;
+	FILE* hashesFile = fopen(path, "r");
+	if(!hashesFile)
+	{
+		fprintf(stderr, "Failed to open file with checksums: %s; Error: %s\n",
+			path, strerror(errno) );
+		exit(EXIT_FAILURE);
+	}
 
-	config.statAll = true; // need stat() info for time/size filtering
+	char* lineBuf = NULL;
+	size_t lineBufSize = 0;
+	size_t lineNum = 0;
 
-	// handle +/- prefix, set actualCfgValPtr and corresponding filter flag
+	while(getline(&lineBuf, &lineBufSize, hashesFile) != -1)
+	{
+		lineNum++;
 
-	uint64_t* actualCfgValPtr;
+		std::istringstream lineStream(lineBuf);
+		std::string hexStr;
+		std::string sizeStr;
 
-	if(userVal[0] == '-')
-	{ // match less than userVal for size and "less in the past" (so greater) for timestamps
-		userVal.erase(0, 1); // remove '-' char
+		lineStream >> hexStr >> sizeStr;
 
-		if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
-		{ // size => '-' means "less"
-			actualCfgValPtr = &lessCfgVal;
-			config.filterSizeAndTime.filterSizeAndTimeFlags |= lessCfgFlag;
+		if(hexStr.empty() || (hexStr[0] == '#') )
+			continue;
+
+		bool hasXxh3Prefix = !hexStr.compare(0, strlen(CHECKSUM_XXH3_PREFIX),
+			CHECKSUM_XXH3_PREFIX);
+
+		if(hasXxh3Prefix)
+			hexStr.erase(0, strlen(CHECKSUM_XXH3_PREFIX) );
+
+		ChecksumAlgo algo =
+			(hexStr.length() == 2 * Sha256Hasher::DIGEST_LEN) ? ChecksumAlgo_SHA256 :
+			(hexStr.length() == 2 * sizeof(uint64_t) ) ? ChecksumAlgo_XXH3 :
+			(hexStr.length() == 2 * sizeof(uint32_t) ) ? ChecksumAlgo_CRC32C :
+			ChecksumAlgo_NONE;
+
+		if( (hexStr.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) ||
+			(hasXxh3Prefix && (algo != ChecksumAlgo_XXH3) ) )
+			algo = ChecksumAlgo_NONE;
+
+		if(!algo || (config.hashInAlgo && (algo != config.hashInAlgo) ) )
+		{
+			fprintf(stderr, "Aborting because of invalid or inconsistent checksum in file: %s; "
+				"Line: %zu\n", path, lineNum);
+			exit(EXIT_FAILURE);
 		}
-		else
-		{ // time => '-' means "greater" (less in the past)
-			actualCfgValPtr = &greaterCfgVal;
-			config.filterSizeAndTime.filterSizeAndTimeFlags |= greaterCfgFlag;
+
+		config.hashInAlgo = algo;
+
+		unsigned char digest[Sha256Hasher::DIGEST_LEN];
+
+		for(size_t i=0; i < hexStr.length() / 2; i++)
+			digest[i] = (unsigned char)std::stoul(hexStr.substr(i * 2, 2), NULL, 16);
+
+		hashInDigestSet.setKeyLen(hexStr.length() / 2);
+		hashInDigestSet.insert(digest);
+
+		if(sizeStr.empty() || (sizeStr.find_first_not_of("0123456789") != std::string::npos) )
+		{
+			hashInSizeSetDisabled = true;
+			continue;
 		}
+
+		if(hashInSizeSetDisabled)
+			continue; // no need to collect sizes anymore
+
+		uint64_t fileSize = std::stoull(sizeStr);
+		unsigned char sizeKey[sizeof(fileSize)];
+
+		memcpy(sizeKey, &fileSize, sizeof(fileSize) );
+
+		hashInSizeSet.setKeyLen(sizeof(fileSize) );
+		hashInSizeSet.insert(sizeKey);
 	}
-	else
-	if(userVal[0] == '+')
-	{ // match greater than userVal for size and "more in the past" (so less) for timestamps
-		userVal.erase(0, 1); // remove '+' char
 
-		if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
-		{ // size => '+' means "greater"
-			actualCfgValPtr = &greaterCfgVal;
-			config.filterSizeAndTime.filterSizeAndTimeFlags |= greaterCfgFlag;
-		}
-		else
-		{ // time => '+' means "less" (further in the past)
-			actualCfgValPtr = &lessCfgVal;
-			config.filterSizeAndTime.filterSizeAndTimeFlags |= lessCfgFlag;
-		}
+	free(lineBuf);
+	fclose(hashesFile);
+
+	if(hashInDigestSet.empty() )
+	{
+		fprintf(stderr, "Aborting because no checksums were found in file: %s\n", path);
+		exit(EXIT_FAILURE);
 	}
-	else
-	{ // match exact
-		actualCfgValPtr = &exactCfgVal;
-		config.filterSizeAndTime.filterSizeAndTimeFlags |= exactCfgFlag;
+
+	/* size prefilter can only be used if all sizes are known (also of previous "--hash-in" files,
+		so this stays disabled for all following files) */
+	if(hashInSizeSetDisabled)
+		hashInSizeSet = DigestHashSet();
+}
+
+/**
+ * Read literals for "--contains-any" from the given file (one literal per line) and add them to
+ * config.
+ */
+void parseContainsAnyFile(const char* path)
+{
+	FILE* literalsFile = fopen(path, "r");
+	if(!literalsFile)
+	{
+		fprintf(stderr, "Failed to open file with literals: %s; Error: %s\n",
+			path, strerror(errno) );
+		exit(EXIT_FAILURE);
 	}
 
-	// actualCfgValPtr is set, but we didn't assign the value yet at this point
+	char* lineBuf = NULL;
+	size_t lineBufSize = 0;
+	ssize_t lineLen;
+	const size_t oldNumLiterals = config.containsLiterals.size();
 
-	if(exactCfgFlag == FILTER_FLAG_SIZE_EXACT)
-	{ // size can have a suffix
-		userVal = parseSizeArgSuffix(userVal);
-		*actualCfgValPtr = std::stoull(userVal);
+	while( (lineLen = getline(&lineBuf, &lineBufSize, literalsFile) ) != -1)
+	{
+		if(lineLen && (lineBuf[lineLen - 1] == '\n') )
+			lineLen--;
+
+		if(lineLen)
+			config.containsLiterals.push_back(std::string(lineBuf, lineLen) );
 	}
-	else
-	{ // {a,c,m}time, so we have to substract user val times 24h from current time
-		const uint64_t secsPerDay = 60 * 60 * 24;
 
-		time_t nowT = time(NULL);
+	free(lineBuf);
+	fclose(literalsFile);
 
-		*actualCfgValPtr = nowT - (std::stoull(userVal) * secsPerDay);
+	// (no literals would make every entry match, like an empty "--contains" string)
+	if(config.containsLiterals.size() == oldNumLiterals)
+	{
+		fprintf(stderr, "Aborting because \"--" ARG_CONTAINSANY_LONG "\" file contains no "
+			"literals: %s\n", path);
+		exit(EXIT_FAILURE);
 	}
 }
 
@@ -1631,12 +8696,12 @@ void parseExecArguments(int& argc, char** argv)
  */
 void parseArguments(int argc, char** argv)
 {
-	bool needFilterByDevIDInit = false; // true for delayed filter by mount ID init
 
 	/* note: this removes the "exec" arg and all following up to the terminator from argv,
 	 	 because getopt_long_only() below can change order of arguments in argv */
 	parseExecArguments(argc, argv);
 
+	bool topSortKeyGiven = false; // to detect "--by" without "--top"
 
 	for( ; ; )
 	{
@@ -1656,18 +8721,35 @@ void parseArguments(int argc, char** argv)
 		static struct option long_options[] =
 		{
 				{ ARG_ACLCHECK_LONG, no_argument, 0, 0 },
+				{ ARG_BACKGROUND_LONG, no_argument, 0, 0 },
+				{ ARG_CHECKSUM_LONG, required_argument, 0, 0 },
+				{ ARG_CONTAINS_LONG, required_argument, 0, 0 },
+				{ ARG_CONTAINSANY_LONG, required_argument, 0, 0 },
 				{ ARG_COPYDEST_LONG, required_argument, 0, 0 },
+				{ ARG_DEVTHREADS_LONG, required_argument, 0, 0 },
+				{ ARG_DUPLICATES_LONG, no_argument, 0, 0 },
+				{ ARG_ESTIMATE_LONG, no_argument, 0, 0 },
+				{ ARG_ESTIMATETIME_LONG, required_argument, 0, 0 },
 				{ ARG_EXEC_LONG, no_argument, 0, 0 },
 				{ ARG_FILTER_ATIME, required_argument, 0, 0 },
 				{ ARG_FILTER_CTIME, required_argument, 0, 0 },
 				{ ARG_FILTER_MTIME, required_argument, 0, 0 },
 				{ ARG_FILTER_SIZE, required_argument, 0, 0 },
+				{ ARG_FSBACKEND_LONG, required_argument, 0, 0 },
 				{ ARG_GID_LONG, required_argument, 0, 0 },
 				{ ARG_GODEEP_LONG, required_argument, 0, 0 },
 				{ ARG_GROUP_LONG, required_argument, 0, 0 },
+				{ ARG_HASHIN_LONG, required_argument, 0, 0 },
 				{ ARG_HELP_LONG, no_argument, 0, ARG_HELP_SHORT },
+				{ ARG_HISTOGRAM_LONG, required_argument, 0, 0 },
 				{ ARG_JSON_LONG, no_argument, 0, 0 },
+				{ ARG_LATENCY_LONG, no_argument, 0, 0 },
+				{ ARG_LIMIT_LONG, required_argument, 0, 0 },
+				{ ARG_MAGIC_LONG, required_argument, 0, 0 },
 				{ ARG_MAXDEPTH_LONG, required_argument, 0, 0 },
+				{ ARG_MAXENTRIES_LONG, required_argument, 0, 0 },
+				{ ARG_METRICSFILE_LONG, required_argument, 0, 0 },
+				{ ARG_METRICSINTERVAL_LONG, required_argument, 0, 0 },
 				{ ARG_MOUNT_LONG, no_argument, 0, 0 },
 				{ ARG_NAME_LONG, required_argument, 0, 0 },
 				{ ARG_NEWER_LONG, required_argument, 0, 0 },
@@ -1678,12 +8760,21 @@ void parseArguments(int argc, char** argv)
 				{ ARG_NOTIMEUPD_LONG, no_argument, 0, 0 },
 				{ ARG_PATH_LONG, required_argument, 0, 0 },
 				{ ARG_PRINT0_LONG, no_argument, 0, 0 },
+				{ ARG_PROGRESS_LONG, optional_argument, 0, 0 },
 				{ ARG_QUITAFTER1_LONG, no_argument, 0, 0 },
+				{ ARG_REPORTHOTDIRS_LONG, required_argument, 0, 0 },
 				{ ARG_SEARCHTYPE_LONG, required_argument, 0, 0 },
 				{ ARG_STAT_LONG, no_argument, 0, 0 },
+				{ ARG_SUMMARYJSON_LONG, required_argument, 0, 0 },
 				{ ARG_THREADS_LONG, required_argument, 0, ARG_THREADS_SHORT },
+				{ ARG_TIMELIMIT_LONG, required_argument, 0, 0 },
+				{ ARG_TOP_LONG, required_argument, 0, 0 },
+				{ ARG_TRACE_LONG, required_argument, 0, 0 },
+				{ ARG_TRACESAMPLE_LONG, required_argument, 0, 0 },
+				{ ARG_TOPBY_LONG, required_argument, 0, 0 },
 				{ ARG_UID_LONG, required_argument, 0, 0 },
 				{ ARG_UNLINK_LONG, no_argument, 0, 0 },
+				{ ARG_USAGEBY_LONG, required_argument, 0, 0 },
 				{ ARG_USER_LONG, required_argument, 0, 0 },
 				{ ARG_VERBOSE_LONG, no_argument, 0, 0 },
 				{ ARG_VERSION_LONG, no_argument, 0, 0 },
@@ -1715,12 +8806,84 @@ void parseArguments(int argc, char** argv)
 				if(ARG_ACLCHECK_LONG == currentOptionName)
 					config.checkACLs = true;
 				else
+				if(ARG_BACKGROUND_LONG == currentOptionName)
+				{
+					config.background = true;
+					config.recordSyscallLatency = true; // latency is the input of the backoff
+				}
+				else
+				if(ARG_CHECKSUM_LONG == currentOptionName)
+				{
+					if(CHECKSUM_ALGO_SHA256_STR == std::string(optarg) )
+						config.checksumAlgo = ChecksumAlgo_SHA256;
+					else
+					if(CHECKSUM_ALGO_XXH3_STR == std::string(optarg) )
+						config.checksumAlgo = ChecksumAlgo_XXH3;
+					else
+					if(CHECKSUM_ALGO_CRC32C_STR == std::string(optarg) )
+						config.checksumAlgo = ChecksumAlgo_CRC32C;
+					else
+					{
+						fprintf(stderr, "Aborting because of invalid checksum algorithm: %s\n",
+							optarg);
+						exit(EXIT_FAILURE);
+					}
+
+					config.statAll = true; // to be able to rely on type in statBuf
+				}
+				else
+				if(ARG_CONTAINS_LONG == currentOptionName)
+				{
+					if(!strlen(optarg) )
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_CONTAINS_LONG "\" string is "
+							"empty\n");
+						exit(EXIT_FAILURE);
+					}
+
+					config.containsLiterals.push_back(optarg);
+				}
+				else
+				if(ARG_CONTAINSANY_LONG == currentOptionName)
+					parseContainsAnyFile(optarg);
+				else
 				if(ARG_COPYDEST_LONG == currentOptionName)
 				{
 					config.copyDestDir = optarg;
 					config.statAll = true; // to be able to rely on type in statBuf and for mtime
 				}
 				else
+				if(ARG_DEVTHREADS_LONG == currentOptionName)
+				{
+					if(DEV_THREADS_AUTO_STR == std::string(optarg) )
+						config.devThreadsAuto = true;
+					else
+						config.devThreads = std::atoi(optarg);
+
+					if(!config.devThreadsAuto && !config.devThreads)
+					{
+						fprintf(stderr, "Aborting because of invalid \"--" ARG_DEVTHREADS_LONG "\" "
+							"value: %s\n", optarg);
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
+				if(ARG_DUPLICATES_LONG == currentOptionName)
+				{
+					config.findDuplicates = true;
+					config.printEntriesDisabled = true; // duplicates replace output of entries
+					config.statAll = true; // need stat() info for type, size and hardlink detection
+				}
+				else
+				if(ARG_ESTIMATE_LONG == currentOptionName)
+					config.estimateOnly = true;
+				else
+				if(ARG_ESTIMATETIME_LONG == currentOptionName)
+				{
+					config.estimateOnly = true;
+					config.estimateTimeSecs = parseDurationArg(optarg, ARG_ESTIMATETIME_LONG);
+				}
+				else
 				if(ARG_EXEC_LONG == currentOptionName)
 				{
 					// error out if exec is still found here, because it means it existed twice
@@ -1734,7 +8897,7 @@ void parseArguments(int argc, char** argv)
 					PARSE_EXACT_LESS_GREATER_VAL(optarg, atime, ATIME);
 				else
 				if(ARG_FILTER_CTIME == currentOptionName)
-					PARSE_EXACT_LESS_GREATER_VAL(optarg, ctime, CTIME);
+					PARSE_EXACT_LESS_GREATER_VAL(optarg, ctime, CHANGETIME);
 				else
 				if(ARG_FILTER_MTIME == currentOptionName)
 					PARSE_EXACT_LESS_GREATER_VAL(optarg, mtime, MTIME);
@@ -1742,6 +8905,9 @@ void parseArguments(int argc, char** argv)
 				if(ARG_FILTER_SIZE == currentOptionName)
 					PARSE_EXACT_LESS_GREATER_VAL(optarg, size, SIZE);
 				else
+				if(ARG_FSBACKEND_LONG == currentOptionName)
+					parseFsBackendArg(optarg);
+				else
 				if(ARG_GID_LONG == currentOptionName)
 				{
 					config.filterGID = std::stoull(optarg);
@@ -1773,18 +8939,66 @@ void parseArguments(int argc, char** argv)
 					config.statAll = true; // we need statBuf for this filter
 				}
 				else
+				if(ARG_HASHIN_LONG == currentOptionName)
+				{
+					parseHashInFile(optarg);
+
+					config.statAll = true; // we need statBuf for type and size
+				}
+				else
+				if(ARG_HISTOGRAM_LONG == currentOptionName)
+					parseHistogramArg(optarg);
+				else
 				if(ARG_JSON_LONG == currentOptionName)
 					config.printJSON = true;
 				else
+				if(ARG_LATENCY_LONG == currentOptionName)
+				{
+					config.measureSyscallLatency = true;
+					config.recordSyscallLatency = true;
+				}
+				else
+				if(ARG_LIMIT_LONG == currentOptionName)
+				{
+					config.matchLimit = std::stoull(optarg);
+
+					if(!config.matchLimit)
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_LIMIT_LONG "\" must be "
+							"greater than 0\n");
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
+				if(ARG_MAGIC_LONG == currentOptionName)
+					parseMagicArg(optarg);
+				else
 				if(ARG_MAXDEPTH_LONG == currentOptionName)
 					config.maxDirDepth = std::atoi(optarg);
 				else
+				if(ARG_MAXENTRIES_LONG == currentOptionName)
+					config.maxEntries = std::stoull(optarg);
+				else
+				if(ARG_METRICSFILE_LONG == currentOptionName)
+					config.metricsFilePath = optarg;
+				else
+				if(ARG_METRICSINTERVAL_LONG == currentOptionName)
+				{
+					config.metricsIntervalSecs =
+						parseDurationArg(optarg, ARG_METRICSINTERVAL_LONG);
+
+					if(!config.metricsIntervalSecs)
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_METRICSINTERVAL_LONG "\" "
+							"must be at least 1 second\n");
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
 				if( (ARG_MOUNT_LONG == currentOptionName) ||
 					(ARG_XDEV_LONG == currentOptionName) )
 				{
-					/* we can't init dev ID here yet because we have not initialized the mount
-						mount points yet. */
-					needFilterByDevIDInit = true;
+					config.stayOnDevice = true;
 
 					config.statAll = true; // we need statBuf for this filter
 				}
@@ -1816,8 +9030,26 @@ void parseArguments(int argc, char** argv)
 				if(ARG_PRINT0_LONG == currentOptionName)
 					config.print0 = true;
 				else
+				if(ARG_PROGRESS_LONG == currentOptionName)
+				{
+					/* optional interval arg can only be given as "--progress=N", because a next
+						arg like "1d" could also be a scan path */
+					config.progressIntervalSecs = optarg ?
+						parseDurationArg(optarg, ARG_PROGRESS_LONG) : PROGRESS_INTERVAL_SECS_DEFAULT;
+
+					if(!config.progressIntervalSecs)
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_PROGRESS_LONG "\" interval "
+							"must be greater than 0\n");
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
 				if(ARG_QUITAFTER1_LONG == currentOptionName)
-					config.quitAfterFirstMatch = true;
+					config.matchLimit = 1;
+				else
+				if(ARG_REPORTHOTDIRS_LONG == currentOptionName)
+					config.hotDirsNum = std::stoul(optarg);
 				else
 				if(ARG_SEARCHTYPE_LONG == currentOptionName)
 					config.searchType = (strlen(optarg) ? optarg[0] : 0);
@@ -1825,6 +9057,65 @@ void parseArguments(int argc, char** argv)
 				if(ARG_STAT_LONG == currentOptionName)
 					config.statAll = true;
 				else
+				if(ARG_SUMMARYJSON_LONG == currentOptionName)
+				{
+					config.summaryJSONPath = optarg;
+					config.measureThreadTimes = true; // for thread utilization in summary
+				}
+				else
+				if(ARG_TIMELIMIT_LONG == currentOptionName)
+					config.timeLimitSecs = parseDurationArg(optarg, ARG_TIMELIMIT_LONG);
+				else
+				if(ARG_TOP_LONG == currentOptionName)
+				{
+					if(!isdigit(optarg[0] ) || !(config.topNum = std::stoul(optarg) ) )
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_TOP_LONG "\" must be "
+							"greater than 0: %s\n", optarg);
+						exit(EXIT_FAILURE);
+					}
+
+					config.statAll = true; // we need statBuf to rank entries
+				}
+				else
+				if(ARG_TRACE_LONG == currentOptionName)
+					config.traceFilePath = optarg;
+				else
+				if(ARG_TRACESAMPLE_LONG == currentOptionName)
+				{
+					config.traceSampleInterval = std::stoull(optarg);
+
+					if(!config.traceSampleInterval)
+					{
+						fprintf(stderr, "Aborting because \"--" ARG_TRACESAMPLE_LONG "\" must be "
+							"greater than 0\n");
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
+				if(ARG_TOPBY_LONG == currentOptionName)
+				{
+					topSortKeyGiven = true;
+
+					if(TOP_SORTKEY_SIZE_STR == std::string(optarg) )
+						config.topSortKey = TopSortKey_SIZE;
+					else
+					if(TOP_SORTKEY_BLOCKS_STR == std::string(optarg) )
+						config.topSortKey = TopSortKey_BLOCKS;
+					else
+					if(TOP_SORTKEY_MTIME_STR == std::string(optarg) )
+						config.topSortKey = TopSortKey_MTIME;
+					else
+					if(TOP_SORTKEY_ATIME_STR == std::string(optarg) )
+						config.topSortKey = TopSortKey_ATIME;
+					else
+					{
+						fprintf(stderr, "Aborting because of invalid sort key for \"--" ARG_TOP_LONG
+							"\": %s\n", optarg);
+						exit(EXIT_FAILURE);
+					}
+				}
+				else
 				if(ARG_UID_LONG == currentOptionName)
 				{
 					config.filterUID = std::stoull(optarg);
@@ -1838,6 +9129,9 @@ void parseArguments(int argc, char** argv)
 					config.statAll = true; // to be able to rely on type in statBuf for dir vs file
 				}
 				else
+				if(ARG_USAGEBY_LONG == currentOptionName)
+					parseUsageByArg(optarg);
+				else
 				if(ARG_USER_LONG == currentOptionName)
 				{
 					if(strlen(optarg) && isdigit(optarg[0]) )
@@ -1859,7 +9153,10 @@ void parseArguments(int argc, char** argv)
 				}
 				else
 				if(ARG_VERBOSE_LONG == currentOptionName)
+				{
 					config.printVerbose = true;
+					config.measureThreadTimes = true; // for thread utilization in summary
+				}
 				else
 				if(ARG_VERSION_LONG == currentOptionName)
 					config.printVersion = true;
@@ -1870,8 +9167,12 @@ void parseArguments(int argc, char** argv)
 			break;
 
 			case ARG_THREADS_SHORT:
-				config.numThreads = std::atoi(optarg);
-			break;
+			{
+				if(!strncmp(optarg, THREADS_AUTO_STR, strlen(THREADS_AUTO_STR) ) )
+					parseAutoThreadsArg(optarg);
+				else
+					config.numThreads = std::atoi(optarg);
+			} break;
 
 			case '?': // unknown (long or short) option
 				fprintf(stderr, "Aborting due to unrecognized option\n");
@@ -1904,7 +9205,8 @@ void parseArguments(int argc, char** argv)
 
 	// init config defaults
 	if(!config.depthSearchStartThreshold)
-		config.depthSearchStartThreshold = config.numThreads;
+		config.depthSearchStartThreshold = config.autoThreads ?
+			getAutoThreadsStartLimit() : config.numThreads; // (numThreads is max for auto)
 
 
 	// sanity check
@@ -1916,24 +9218,49 @@ void parseArguments(int argc, char** argv)
 		exit(EXIT_FAILURE);
 	}
 
-	/* delayed dev ID init to not descend into other mountpoints...
-		(init of this is here because we need to have scan paths initialized.) */
-	if(needFilterByDevIDInit)
+	if(config.topNum &&
+		(!config.copyDestDir.empty() || config.unlinkFiles || !config.exec.cmdLineStrVec.empty() ) )
 	{
-		struct stat statBuf;
+		fprintf(stderr, "\"--" ARG_TOP_LONG "\" can't be combined with \"--" ARG_COPYDEST_LONG "\", "
+			"\"--" ARG_UNLINK_LONG "\" or \"--" ARG_EXEC_LONG "\"\n");
+		exit(EXIT_FAILURE);
+	}
 
-		int statRes = stat(config.scanPaths.empty() ? "." : config.scanPaths.front().c_str(),
-			&statBuf);
+	if(config.topNum && (!config.histogramConfigVec.empty() || !config.usageByVec.empty() ||
+		config.findDuplicates) )
+	{ // (these replace the output of individual entries, so top entries would not be printed)
+		fprintf(stderr, "Aborting because \"--" ARG_TOP_LONG "\" can't be combined with "
+			"\"--" ARG_HISTOGRAM_LONG "\", \"--" ARG_USAGEBY_LONG "\" or "
+			"\"--" ARG_DUPLICATES_LONG "\"\n");
+		exit(EXIT_FAILURE);
+	}
 
-		if(statRes != 0)
-		{
-			fprintf(stderr, "Aborting because dev ID retrieval for scan path failed.\n");
-			exit(EXIT_FAILURE);
-		}
+	if(topSortKeyGiven && !config.topNum)
+	{
+		fprintf(stderr, "Aborting because \"--" ARG_TOPBY_LONG "\" can only be used together "
+			"with \"--" ARG_TOP_LONG "\"\n");
+		exit(EXIT_FAILURE);
+	}
 
-		config.filterMountID = statBuf.st_dev;
+	if(config.useSyntheticFs &&
+		(config.checksumAlgo || !config.containsLiterals.empty() || config.hashInAlgo ||
+		!config.magicTypes.empty() || config.findDuplicates || config.checkACLs ||
+		!config.exec.cmdLineStrVec.empty() ||
+		(std::find(config.usageByVec.begin(), config.usageByVec.end(), UsageByType_PROJECT) !=
+		config.usageByVec.end() ) ) )
+	{ // (these still use the real filesystem)
+		fprintf(stderr, "\"--" ARG_FSBACKEND_LONG " " FSBACKEND_SYNTHETIC_STR "\" can't be "
+			"combined with options that read file contents, \"--" ARG_ACLCHECK_LONG "\", "
+			"\"--" ARG_EXEC_LONG "\" or \"--" ARG_USAGEBY_LONG " " USAGEBY_TYPE_PROJECT_STR "\"\n");
+		exit(EXIT_FAILURE);
 	}
 
+	contentMatcher.setLiterals(config.containsLiterals);
+
+	if(config.useSyntheticFs)
+		fsBackend.reset(new SyntheticFileSystemBackend(config.syntheticFs,
+			config.scanPaths.empty() ? std::list<std::string>{"."} : config.scanPaths) );
+
 }
 
 int main(int argc, char** argv)
@@ -1948,6 +9275,9 @@ int main(int argc, char** argv)
 	if(config.scanPaths.empty() )
 		config.scanPaths.push_back("."); // if no paths given then scan current dir
 
+	if(config.estimateOnly)
+		return runEstimate() ? EXIT_SUCCESS : EXIT_FAILURE; // estimate replaces the full scan
+
 	const unsigned short currentDirDepth = 0;
 
 	// check entry type of user-given paths and add dirs to stack
@@ -1955,7 +9285,7 @@ int main(int argc, char** argv)
 	{
 		struct stat statBuf;
 
-		int statRes = lstat(currentPath.c_str(), &statBuf);
+		int statRes = fsBackend->lstatPath(currentPath.c_str(), &statBuf);
 
 		if(statRes)
 		{
@@ -1973,9 +9303,16 @@ int main(int argc, char** argv)
 			kill(0, SIGTERM);
 		}
 
+		// user-given paths count as entries, same as entries found by scan()
+		if(config.maxEntries && (state.numEntriesReserved++ >= config.maxEntries) )
+		{
+			cancelScan("max entries reached");
+			break;
+		}
+
 		if(S_ISDIR(statBuf.st_mode) )
 		{ // this entry is a directory
-			processDiscoveredEntry(currentPath, NULL, &statBuf);
+			processDiscoveredEntry(currentPath, NULL, &statBuf, currentDirDepth);
 
 			if(currentDirDepth < config.maxDirDepth)
 			{
@@ -1987,12 +9324,12 @@ int main(int argc, char** argv)
 					(currentPathTrimmed[currentPathTrimmed.length()-1] == '/') )
 					currentPathTrimmed.erase(currentPathTrimmed.length()-1, 1);
 
-				sharedStack.push(currentPathTrimmed, currentDirDepth + 1);
+				sharedStack.push(currentPathTrimmed, currentDirDepth + 1, statBuf.st_dev);
 			}
 		}
 		else
 		{ // this entry is not a directory
-			processDiscoveredEntry(currentPath, NULL, &statBuf);
+			processDiscoveredEntry(currentPath, NULL, &statBuf, currentDirDepth);
 		}
 	}
 
@@ -2000,6 +9337,38 @@ int main(int argc, char** argv)
 	if(config.numThreads == 1)
 		config.depthSearchStartThreshold = 0;
 
+	std::thread timeLimitThread;
+
+	if(config.timeLimitSecs)
+		timeLimitThread = std::thread(timeLimitThreadStart);
+
+	signal(SIGUSR1, progressSignalHandler);
+
+	std::thread progressThread(progressThreadStart);
+
+	std::thread metricsThread;
+
+	if(!config.metricsFilePath.empty() )
+		metricsThread = std::thread(metricsThreadStart);
+
+	std::thread concurrencyControlThread;
+
+	if(config.autoThreads)
+	{ // start with a moderate limit; the controller adapts it from there
+		sharedStack.setActiveThreadsLimit(getAutoThreadsStartLimit() );
+
+		concurrencyControlThread = std::thread(concurrencyControlThreadStart);
+	}
+	else
+	if(config.background)
+	{ // start with all threads to measure the latency baseline under our own load
+		sharedStack.setActiveThreadsLimit(config.numThreads);
+
+		concurrencyControlThread = std::thread(concurrencyControlThreadStart);
+	}
+
+	state.scanStartTime = std::chrono::steady_clock::now();
+
 	// start threads
 	for(unsigned i=0; i < config.numThreads; i++)
 		state.scanThreads.push(std::thread(threadStart) );
@@ -2011,8 +9380,47 @@ int main(int argc, char** argv)
 		state.scanThreads.pop();
 	}
 
+	state.scanEndTime = std::chrono::steady_clock::now();
+
+	{
+		std::unique_lock<std::mutex> lock(state.scanThreadsDoneMutex); // L O C K
+		state.scanThreadsDone = true;
+	}
+
+	state.scanThreadsDoneCondition.notify_all();
+
+	progressThread.join();
+
+	if(metricsThread.joinable() )
+		metricsThread.join();
+
+	if(concurrencyControlThread.joinable() )
+		concurrencyControlThread.join();
+
+	if(timeLimitThread.joinable() )
+		timeLimitThread.join();
+
+	printTopEntries();
+
+	printHistograms();
+
+	printUsageReports();
+
+	findAndPrintDuplicates();
+
+	printHotDirs();
+
 	printSummary();
 
+	if(!writeSummaryJSON() )
+		retVal = EXIT_FAILURE;
+
+	if(!writeTraceFile() )
+		retVal = EXIT_FAILURE;
+
+	if(!config.metricsFilePath.empty() && !writeMetricsFile() )
+		retVal = EXIT_FAILURE;
+
 	return retVal;
 }
 